@@ -0,0 +1,113 @@
+#ifndef __ADDRESS_INTERVAL_MAP_H__
+#define __ADDRESS_INTERVAL_MAP_H__
+
+/* A map from byte addresses to values, stored as address ranges.
+ *
+ * DMA operations touch every byte of buffers that can be megabytes long, and
+ * all of those bytes usually map to the same node. Instead of one entry per
+ * byte, AddressIntervalMap stores disjoint half-open ranges [start, end), each
+ * with a single value. Assigning or erasing a range splits the ranges it
+ * partially overlaps, and adjacent ranges with the same value are merged, so
+ * an operation on N bytes costs O(log n + k) for k overlapping ranges rather
+ * than O(N).
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+
+#include "typedefs.h"
+
+template <typename T>
+class AddressIntervalMap {
+ public:
+  // Return the value at @addr, or nullptr if it has not been assigned.
+  const T* find(Addr addr) const {
+    auto it = ranges.upper_bound(addr);
+    if (it == ranges.begin())
+      return nullptr;
+    --it;
+    if (addr >= it->second.end)
+      return nullptr;
+    return &it->second.value;
+  }
+
+  // Assign @value to every address in [start, end).
+  void assign(Addr start, Addr end, const T& value) {
+    if (start >= end)
+      return;
+    erase(start, end);
+    auto it = ranges.insert(std::make_pair(start, Range(end, value))).first;
+    // Merge with the range that ends right where this one starts.
+    if (it != ranges.begin()) {
+      auto prev = std::prev(it);
+      if (prev->second.end == start && prev->second.value == value) {
+        prev->second.end = end;
+        ranges.erase(it);
+        it = prev;
+      }
+    }
+    // Merge with the range that starts right where this one ends.
+    auto next = std::next(it);
+    if (next != ranges.end() && next->first == end &&
+        next->second.value == value) {
+      it->second.end = next->second.end;
+      ranges.erase(next);
+    }
+  }
+
+  // Remove every address in [start, end) from the map.
+  void erase(Addr start, Addr end) {
+    if (start >= end)
+      return;
+    split(start);
+    split(end);
+    ranges.erase(ranges.lower_bound(start), ranges.lower_bound(end));
+  }
+
+  // Call @func(range_start, range_end, value) on the part of every range that
+  // overlaps [start, end), in address order.
+  template <typename Func>
+  void for_each(Addr start, Addr end, Func func) const {
+    if (start >= end)
+      return;
+    auto it = ranges.upper_bound(start);
+    if (it != ranges.begin() && std::prev(it)->second.end > start)
+      --it;
+    for (; it != ranges.end() && it->first < end; ++it) {
+      Addr range_start = std::max(it->first, start);
+      Addr range_end = std::min(it->second.end, end);
+      func(range_start, range_end, it->second.value);
+    }
+  }
+
+  // The number of disjoint ranges stored.
+  size_t num_ranges() const { return ranges.size(); }
+  bool empty() const { return ranges.empty(); }
+  void clear() { ranges.clear(); }
+
+ private:
+  struct Range {
+    Range(Addr _end, const T& _value) : end(_end), value(_value) {}
+    Addr end;
+    T value;
+  };
+
+  // Ensure that no range crosses @addr, by splitting the one that does.
+  void split(Addr addr) {
+    auto it = ranges.upper_bound(addr);
+    if (it == ranges.begin())
+      return;
+    --it;
+    if (it->first < addr && addr < it->second.end) {
+      ranges.insert(
+          it, std::make_pair(addr, Range(it->second.end, it->second.value)));
+      it->second.end = addr;
+    }
+  }
+
+  // Disjoint ranges, keyed by their start address.
+  std::map<Addr, Range> ranges;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+/* A slab allocator for objects of a single type that are all freed together.
+ *
+ * A DDDG allocates one ExecNode per dynamic instruction and one memory access
+ * record per memory op, and frees them all at once when the program is
+ * cleared. Allocating each of them separately with new costs a malloc header
+ * per object and scatters the nodes across the heap. An Arena instead
+ * constructs objects in place in large slabs, and clear() destroys them all
+ * and releases the slabs in bulk.
+ *
+ * Objects are never moved, so pointers to them stay valid until clear().
+ * Single objects can also be destroyed early with destroy(), and their slots
+ * are reused by later calls to create(), so a user that retires objects as it
+ * goes keeps a bounded footprint.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template <typename T, size_t ObjectsPerSlab = 4096>
+class Arena {
+ public:
+  Arena() : num_objects(0) {}
+  ~Arena() { clear(); }
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Construct a new object with @args.
+  template <typename... Args>
+  T* create(Args&&... args) {
+    if (!free_slots.empty()) {
+      T* object = free_slots.back();
+      free_slots.pop_back();
+      return new (object) T(std::forward<Args>(args)...);
+    }
+    size_t slab = num_objects / ObjectsPerSlab;
+    if (slab == slabs.size())
+      slabs.emplace_back(new Storage[ObjectsPerSlab]);
+    void* addr = &slabs[slab][num_objects % ObjectsPerSlab];
+    T* object = new (addr) T(std::forward<Args>(args)...);
+    num_objects++;
+    return object;
+  }
+
+  // Destroy @object, which must have been created by this arena.
+  void destroy(T* object) {
+    object->~T();
+    free_slots.push_back(object);
+  }
+
+  size_t size() const { return num_objects - free_slots.size(); }
+
+  // Destroy all objects. The first slab is kept for reuse.
+  void clear() {
+    std::sort(free_slots.begin(), free_slots.end());
+    for (size_t i = 0; i < num_objects; i++) {
+      T* object = get(i);
+      if (!std::binary_search(free_slots.begin(), free_slots.end(), object))
+        object->~T();
+    }
+    free_slots.clear();
+    num_objects = 0;
+    if (slabs.size() > 1)
+      slabs.resize(1);
+  }
+
+ private:
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+  T* get(size_t i) {
+    return reinterpret_cast<T*>(&slabs[i / ObjectsPerSlab][i % ObjectsPerSlab]);
+  }
+
+  std::vector<std::unique_ptr<Storage[]>> slabs;
+  // Slots of destroyed objects, to be reused first.
+  std::vector<T*> free_slots;
+  // Slots used so far, including the free ones.
+  size_t num_objects;
+};
+
+#endif
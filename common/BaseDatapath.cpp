@@ -3,6 +3,9 @@
 
 #include "opcode_func.h"
 #include "BaseDatapath.h"
+#include "BinaryTrace.h"
+#include "TraceIndex.h"
+#include "TraceReader.h"
 #include "ExecNode.h"
 #include "DatabaseDeps.h"
 #include "graph_opts/all_graph_opts.h"
@@ -10,9 +13,16 @@
 using namespace SrcTypes;
 
 BaseDatapath::BaseDatapath(std::string& bench,
-                           std::string& trace_file_name,
+                           std::string& _trace_file_name,
                            std::string& config_file)
-    : benchName(bench), current_trace_off(0) {
+    : benchName(bench), consoleOut(&std::cout),
+      progressFileName("dddg_parse_progress.out"),
+      passes(program,
+             [this](const std::string& key) { return isConfigSet(key); }),
+      trace_file_name(_trace_file_name), current_trace_off(0),
+      peakLiveNodes(0), lateNodes(0), windowMisses(0), peakExecutingQueue(0),
+      scannedNodes(0), scannedCycles(0), numActivityArrays(0),
+      estimatedCycles({ 0, 0 }) {
   parse_config(benchName, config_file);
 
   use_db = false;
@@ -29,31 +39,68 @@ BaseDatapath::BaseDatapath(std::string& bench,
   /* Remove the old file. */
   if (access(file_name.c_str(), F_OK) != -1 && remove(file_name.c_str()) != 0)
     perror("Failed to delete the old summary file");
+  file_name = benchName + "_pass_profile";
+  if (access(file_name.c_str(), F_OK) != -1 && remove(file_name.c_str()) != 0)
+    perror("Failed to delete the old pass profile");
 
   struct stat st;
   stat(trace_file_name.c_str(), &st);
   trace_size = st.st_size;
   trace_file = gzopen(trace_file_name.c_str(), "r");
+  if (BinaryTraceReader::isBinaryTrace(trace_file)) {
+    binary_trace.reset(new BinaryTraceReader(trace_file, srcManager));
+    if (!binary_trace->readHeader()) {
+      std::cerr << "ERROR: Invalid binary trace " << trace_file_name
+                << std::endl;
+      exit(1);
+    }
+  } else {
+    text_trace.reset(new TraceLineReader(trace_file));
+  }
+  if (user_params.select_invocations &&
+      !selectInvocations(user_params.first_invocation,
+                         user_params.last_invocation)) {
+    exit(1);
+  }
 }
 
 BaseDatapath::~BaseDatapath() {
+  // The readers must be done with the trace file before it is closed.
+  text_trace.reset();
+  binary_trace.reset();
   gzclose(trace_file);
 }
 
 bool BaseDatapath::buildDddg() {
   DDDG* dddg;
-  dddg = new DDDG(this, &program, trace_file);
+  dddg = new DDDG(
+      this, &program, trace_file, text_trace.get(), binary_trace.get());
+  sampler.reset();
+  if (user_params.sampling) {
+    sampler.reset(new LoopSampler(program,
+                                  user_params.sampled_function,
+                                  user_params.sampled_label,
+                                  user_params.sampling_warmup,
+                                  user_params.sampling_window,
+                                  user_params.sampling_period));
+    dddg->set_node_callback(
+        [this](ExecNode* node, const std::vector<dddg_edge_t>& edges) {
+          addSampledNode(node, edges);
+        });
+  }
   /* Build initial DDDG. */
   current_trace_off = dddg->build_initial_dddg(current_trace_off, trace_size);
   updateUnrollingPipeliningWithLabelInfo(dddg->get_inline_labelmap());
   delete dddg;
+  program.resolveLoopConfigs(
+      user_params.unrolling, user_params.pipeline, srcManager);
 
   if (current_trace_off == DDDG::END_OF_TRACE)
     return false;
 
-  std::cout << "-------------------------------" << std::endl;
-  std::cout << "    Initializing BaseDatapath      " << std::endl;
-  std::cout << "-------------------------------" << std::endl;
+  console() << "-------------------------------" << std::endl;
+  console() << "    Initializing BaseDatapath      " << std::endl;
+  console() << "-------------------------------" << std::endl;
   numTotalNodes = program.nodes.size();
   beginNodeId = program.nodes.begin()->first;
   endNodeId = (--program.nodes.end())->first + 1;
@@ -64,6 +111,450 @@ bool BaseDatapath::buildDddg() {
   return true;
 }
 
+bool BaseDatapath::streamDddg() {
+  stream.reset(new StreamWindow(user_params.stream_window));
+  pendingRoots.clear();
+  executingQueue.clear();
+  readyToExecuteQueue.clear();
+  readyStoreQueue.clear();
+  peakExecutingQueue = 0;
+  scannedNodes = 0;
+  scannedCycles = 0;
+  num_cycles = 0;
+  numTotalNodes = 0;
+  numTotalEdges = 0;
+  executedNodes = 0;
+  totalConnectedNodes = 0;
+  firstUndoneNode = 0;
+  lateNodes = 0;
+  windowMisses = 0;
+
+  DDDG* dddg = new DDDG(
+      this, &program, trace_file, text_trace.get(), binary_trace.get());
+  dddg->set_node_callback(
+      [this](ExecNode* node, const std::vector<dddg_edge_t>& edges) {
+        addStreamedNode(node, edges);
+      });
+  current_trace_off = dddg->build_initial_dddg(current_trace_off, trace_size);
+  delete dddg;
+
+  if (current_trace_off == DDDG::END_OF_TRACE) {
+    stream.reset();
+    return false;
+  }
+
+  // Nothing else can be connected now, so finish the schedule.
+  decideStreamedRoots(true);
+  if (num_cycles == 0 || executedNodes != totalConnectedNodes) {
+    while (!step()) {
+    }
+  }
+  peakLiveNodes = stream->getPeakNodes();
+  writeQueueStats();
+  writeStreamingSummary();
+  stream.reset();
+  return true;
+}
+
+void BaseDatapath::addStreamedNode(ExecNode* node,
+                                   const std::vector<dddg_edge_t>& edges) {
+  unsigned node_id = node->get_node_id();
+  if (stream->empty())
+    firstUndoneNode = node_id;
+  StreamWindow::Entry& entry = stream->push(node, node_id);
+  numTotalNodes++;
+
+  // Only the parents that have not executed yet hold the node back. The
+  // others decide when it can start.
+  bool has_parents = false;
+  int num_parents = 0;
+  float ready_time = 0;
+  for (const dddg_edge_t& edge : edges) {
+    if (edge.source == node_id)
+      continue;
+    StreamWindow::Entry* parent = stream->find(edge.source);
+    if (!parent) {
+      // The parent has executed and been retired. Unless it was isolated, it
+      // still orders this node.
+      if (edge.source >= stream->getBaseId() ||
+          stream->wasIsolated(edge.source)) {
+        windowMisses++;
+        continue;
+      }
+      has_parents = true;
+      numTotalEdges++;
+      ready_time = std::max(ready_time, stream->getRetiredFinishTime());
+      continue;
+    }
+    if (parent->done && !parent->connected) {
+      windowMisses++;
+      continue;
+    }
+    has_parents = true;
+    numTotalEdges++;
+    parent->connected = true;
+    if (parent->done) {
+      ready_time = std::max(ready_time, parent->finish_time);
+    } else {
+      parent->children.push_back(std::make_pair(node, edge.par_id));
+      num_parents++;
+    }
+  }
+  initStreamedAddress(node, edges);
+
+  if (has_parents) {
+    entry.connected = true;
+    connectStreamedNode(node, num_parents, ready_time);
+  } else {
+    // Whether a root is connected is only known once it gets a child, or
+    // ages out of the window without one. DMA nodes always are.
+    entry.connected =
+        node->is_dma_load() || node->is_dma_store() || node->is_dma_fence();
+    entry.pending_root = true;
+    pendingRoots.push_back(node_id);
+  }
+  advanceStream();
+}
+
+void BaseDatapath::initStreamedAddress(ExecNode* node,
+                                       const std::vector<dddg_edge_t>& edges) {
+  int microop = node->get_microop();
+  if (node->is_dma_op()) {
+    bool found_src = false, found_dst = false;
+    for (const dddg_edge_t& edge : edges) {
+      StreamWindow::Entry* parent = stream->find(edge.source);
+      if (!parent || !parent->node->is_gep_op() ||
+          !(edge.par_id == 1 || edge.par_id == 2 ||
+            edge.par_id == MEMORY_EDGE))
+        continue;
+      DynamicVariable dynvar = parent->node->get_dynamic_variable();
+      dynvar = program.call_arg_map.lookup(dynvar);
+      if (node->is_dma_load() || node->is_dma_store()) {
+        DmaMemAccess* mem_access = node->get_dma_mem_access();
+        if (edge.par_id == 1) {
+          mem_access->dst_var = dynvar.get_variable();
+          found_dst = true;
+        } else if (edge.par_id == 2) {
+          mem_access->src_var = dynvar.get_variable();
+          found_src = true;
+        }
+        if (found_src && found_dst)
+          break;
+      } else if (node->is_set_ready_bits()) {
+        node->get_ready_bit_access()->array = dynvar.get_variable();
+      }
+    }
+    return;
+  }
+  if (microop == LLVM_IR_Alloca) {
+    stream->setAddressVar(node->get_node_id(), node->get_variable());
+    return;
+  }
+  if (microop != LLVM_IR_Load && microop != LLVM_IR_Store &&
+      microop != LLVM_IR_GetElementPtr)
+    return;
+  // The address comes from the first parent that computed one, and refers to
+  // the same array as the address of that parent.
+  unsigned address_parid = microop == LLVM_IR_Store ? 2 : 1;
+  Variable* array = nullptr;
+  for (const dddg_edge_t& edge : edges) {
+    if (edge.par_id != address_parid)
+      continue;
+    array = stream->getAddressVar(edge.source);
+    if (array)
+      break;
+  }
+  if (array && node->is_memory_op())
+    node->set_array_label(array->get_name());
+  if (!array) {
+    DynamicVariable dynvar = node->get_dynamic_variable();
+    dynvar = program.call_arg_map.lookup(dynvar);
+    array = dynvar.get_variable();
+  }
+  stream->setAddressVar(node->get_node_id(), array);
+}
+
+void BaseDatapath::decideStreamedRoots(bool end_of_trace) {
+  while (!pendingRoots.empty()) {
+    unsigned node_id = pendingRoots.front();
+    StreamWindow::Entry* root = stream->find(node_id);
+    if (!root->connected && !end_of_trace &&
+        node_id + stream->getSize() > stream->getNewestId())
+      break;
+    pendingRoots.pop_front();
+    root->pending_root = false;
+    if (root->connected)
+      connectStreamedNode(root->node, 0, 0);
+    else
+      root->done = true;
+  }
+}
+
+void BaseDatapath::connectStreamedNode(ExecNode* node,
+                                       int num_parents,
+                                       float ready_time) {
+  node->set_isolated(false);
+  totalConnectedNodes++;
+  initStreamedNode(node);
+  node->set_num_parents(num_parents);
+  node->set_time_before_execution(ready_time);
+  if (num_parents == 0) {
+    // The node could have started in an earlier cycle had it been parsed.
+    if (ready_time < num_cycles * user_params.cycle_time)
+      lateNodes++;
+    executingQueue.push_back(node);
+  }
+}
+
+void BaseDatapath::advanceStream() {
+  decideStreamedRoots(false);
+  unsigned newest_id = stream->getNewestId();
+  while (true) {
+    while (firstUndoneNode <= newest_id) {
+      StreamWindow::Entry* entry = stream->find(firstUndoneNode);
+      if (entry && !entry->done)
+        break;
+      firstUndoneNode++;
+    }
+    if (firstUndoneNode > newest_id ||
+        firstUndoneNode + stream->getSize() > newest_id)
+      break;
+    step();
+  }
+  while (!stream->empty() && stream->canRetireFront()) {
+    ExecNode* node = stream->popFront();
+    if (node)
+      program.freeNode(node);
+  }
+  program.nodes.compact();
+}
+
+void BaseDatapath::writeStreamingSummary() {
+  std::ostringstream summary;
+  summary << "===============================" << std::endl;
+  summary << "       Streaming Results       " << std::endl;
+  summary << "===============================" << std::endl;
+  summary << "Running : " << benchName << std::endl;
+  summary << "Cycle : " << num_cycles << " cycles" << std::endl;
+  summary << "Nodes : " << numTotalNodes << std::endl;
+  summary << "Connected Nodes : " << totalConnectedNodes << std::endl;
+  summary << "Edges : " << numTotalEdges << std::endl;
+  summary << "Window : " << stream->getSize() << " nodes" << std::endl;
+  summary << "Peak Live Nodes : " << peakLiveNodes << std::endl;
+  summary << "Late Nodes : " << lateNodes << std::endl;
+  summary << "Window Misses : " << windowMisses << std::endl;
+  summary << "===============================" << std::endl;
+  console() << summary.str();
+
+  std::string file_name = benchName + "_summary";
+  std::ofstream summary_file(file_name.c_str(),
+                             std::ofstream::out | std::ofstream::app);
+  summary_file << summary.str();
+}
+
+void BaseDatapath::addSampledNode(ExecNode* node,
+                                  const std::vector<dddg_edge_t>& edges) {
+  if (!sampler->keep(node)) {
+    program.freeNode(node);
+    program.nodes.compact();
+    return;
+  }
+  program.addToGraph(node);
+  // Edges from the iterations that were skipped are dropped, as if their
+  // values had been ready from the start.
+  for (const dddg_edge_t& edge : edges) {
+    if (program.nodes.get(edge.source))
+      program.addEdge(edge.source, edge.sink, edge.par_id);
+  }
+}
+
+void BaseDatapath::writeSamplingSummary(
+    const summary_data_t& summary,
+    const std::vector<float>& cycle_energy,
+    const std::vector<unsigned>& cycle_mem_accesses) {
+  float cycle_time = user_params.cycle_time;
+  // Only the total memory energy is known, so it is spread over the cycles by
+  // their share of the memory accesses.
+  double mem_energy = summary.avg_mem_dynamic_power * cycle_time * num_cycles;
+  uint64_t mem_accesses = 0;
+  for (unsigned accesses : cycle_mem_accesses)
+    mem_accesses += accesses;
+  // The dynamic energy of the cycles before each cycle.
+  std::vector<double> energy_before(num_cycles + 1, 0);
+  for (int cycle = 0; cycle < num_cycles; cycle++) {
+    double energy = cycle_energy[cycle];
+    if (mem_accesses > 0)
+      energy += mem_energy * cycle_mem_accesses[cycle] / mem_accesses;
+    energy_before[cycle + 1] = energy_before[cycle] + energy;
+  }
+
+  // A window takes the cycles from when all the nodes before it have
+  // completed to when all the nodes up to its last one have.
+  const std::vector<LoopSampler::Window>& windows = sampler->getWindows();
+  std::vector<double> window_cycles(windows.size(), 0);
+  std::vector<double> window_energy(windows.size(), 0);
+  std::vector<double> window_nodes(windows.size(), 0);
+  std::vector<double> window_mem_ops(windows.size(), 0);
+  double num_mem_ops = 0;
+  int last_cycle = -1;
+  int window_start = -1;
+  size_t window = 0;
+  bool in_window = false;
+  auto close_window = [&]() {
+    if (!in_window)
+      window_start = last_cycle;
+    window_cycles[window] = std::max(last_cycle - window_start, 0);
+    window_energy[window] =
+        energy_before[last_cycle + 1] - energy_before[window_start + 1];
+    in_window = false;
+    window++;
+  };
+  for (auto node_it = program.nodes.begin(); node_it != program.nodes.end();
+       ++node_it) {
+    unsigned node_id = node_it->first;
+    ExecNode* node = node_it->second;
+    while (window < windows.size() && node_id > windows[window].last_node)
+      close_window();
+    if (window < windows.size() && !in_window &&
+        node_id >= windows[window].first_node) {
+      in_window = true;
+      window_start = last_cycle;
+    }
+    if (node->is_isolated())
+      continue;
+    last_cycle = std::max(last_cycle, node->get_complete_execution_cycle());
+    if (node->is_memory_op())
+      num_mem_ops++;
+    if (in_window) {
+      window_nodes[window]++;
+      if (node->is_memory_op())
+        window_mem_ops[window]++;
+    }
+  }
+  while (window < windows.size())
+    close_window();
+
+  estimatedCycles = sampler->extrapolate(num_cycles, window_cycles);
+  LoopSampler::Estimate energy =
+      sampler->extrapolate(energy_before[num_cycles], window_energy);
+  LoopSampler::Estimate nodes =
+      sampler->extrapolate(totalConnectedNodes, window_nodes);
+  LoopSampler::Estimate mem_ops =
+      sampler->extrapolate(num_mem_ops, window_mem_ops);
+  // Leakage does not depend on how long the loop runs.
+  float leakage = summary.fu_leakage_power + summary.mem_leakage_power;
+  double cycles = estimatedCycles.value;
+  double avg_power = energy.value / (cycles * cycle_time) + leakage;
+  bool bounded = estimatedCycles.bound >= 0 && energy.bound >= 0;
+  double min_power = 0, max_power = 0;
+  if (bounded) {
+    double max_cycles = cycles + estimatedCycles.bound;
+    double min_cycles = std::max(cycles - estimatedCycles.bound, 1.0);
+    min_power = std::max(energy.value - energy.bound, 0.0) /
+                    (max_cycles * cycle_time) + leakage;
+    max_power = (energy.value + energy.bound) / (min_cycles * cycle_time) +
+                leakage;
+  }
+  auto write_estimate = [&](std::ostream& out,
+                            const LoopSampler::Estimate& estimate) {
+    out << (uint64_t)(estimate.value + 0.5);
+    if (estimate.bound >= 0)
+      out << " +/- " << (uint64_t)(estimate.bound + 0.5);
+  };
+
+  std::ostringstream results;
+  results << "===============================" << std::endl;
+  results << "       Sampling Results        " << std::endl;
+  results << "===============================" << std::endl;
+  results << "Running : " << benchName << std::endl;
+  results << "Sampled Loop : " << user_params.sampled_function->get_name()
+          << "/" << user_params.sampled_label->get_name() << std::endl;
+  results << "Loop Iterations : " << sampler->getIterations() << std::endl;
+  results << "Skipped Iterations : " << sampler->getSkippedIterations()
+          << std::endl;
+  results << "Skipped Nodes : " << sampler->getSkippedNodes() << std::endl;
+  results << "Sampled Windows : " << windows.size() << std::endl;
+  results << "Est. Cycle : ";
+  write_estimate(results, estimatedCycles);
+  results << " cycles" << std::endl;
+  results << "Est. Executed Nodes : ";
+  write_estimate(results, nodes);
+  results << std::endl;
+  results << "Est. Memory Accesses : ";
+  write_estimate(results, mem_ops);
+  results << std::endl;
+  results << "Est. Avg Power: " << avg_power << " mW";
+  if (bounded)
+    results << " (" << min_power << " to " << max_power << ")";
+  results << std::endl;
+  if (!bounded && sampler->getSkippedIterations() > 0)
+    results << "At least two windows are needed for confidence bounds."
+            << std::endl;
+  results << "===============================" << std::endl;
+  console() << results.str();
+
+  std::string file_name = benchName + "_summary";
+  std::ofstream summary_file(file_name.c_str(),
+                             std::ofstream::out | std::ofstream::app);
+  summary_file << results.str();
+}
+
+bool BaseDatapath::loadTraceIndex() {
+  if (trace_index)
+    return true;
+  if (binary_trace) {
+    std::cerr << "ERROR: Invocations can only be selected in text traces."
+              << std::endl;
+    return false;
+  }
+  std::unique_ptr<TraceIndex> index(new TraceIndex());
+  if (!index->loadOrBuild(trace_file_name))
+    return false;
+  trace_index = std::move(index);
+  return true;
+}
+
+void BaseDatapath::getSelectedInvocations(unsigned* first,
+                                          unsigned* last) const {
+  assert(trace_index && "The trace index has not been loaded!");
+  unsigned num_invocations = trace_index->getNumInvocations();
+  *first = 0;
+  *last = num_invocations > 0 ? num_invocations - 1 : 0;
+  if (user_params.select_invocations) {
+    *first = user_params.first_invocation;
+    *last = std::min(user_params.last_invocation, *last);
+  }
+}
+
+bool BaseDatapath::selectInvocations(unsigned first, unsigned last) {
+  if (!loadTraceIndex())
+    return false;
+  unsigned num_invocations = trace_index->getNumInvocations();
+  if (first > last || first >= num_invocations) {
+    std::cerr << "ERROR: Cannot select invocations " << first << " to " << last
+              << ", the trace only has " << num_invocations << "."
+              << std::endl;
+    return false;
+  }
+  last = std::min(last, num_invocations - 1);
+  console() << "Simulating invocations " << first << " to " << last << " of "
+            << num_invocations << "." << std::endl;
+
+  IndexedTraceStream* stream =
+      new IndexedTraceStream(*trace_index, trace_file_name);
+  uint64_t start = trace_index->getInvocation(first).offset;
+  // The labelmap is only parsed along with the invocation it appears in, so
+  // read it first if that invocation is skipped and it hasn't been read yet.
+  if (trace_index->getLabelmapEnd() <= start && program.labelmap.empty())
+    stream->addRange(trace_index->getLabelmapStart(),
+                     trace_index->getLabelmapEnd());
+  stream->addRange(start, trace_index->getInvocationEnd(last));
+  text_trace.reset(new TraceLineReader(trace_file));
+  text_trace->read_from(stream);
+  current_trace_off = trace_index->getInvocation(first).trace_off;
+  return true;
+}
+
 void BaseDatapath::updateUnrollingPipeliningWithLabelInfo(
     const inline_labelmap_t& inline_labelmap) {
   // The config file is parsed before the trace, so we don't have line number
@@ -110,6 +601,19 @@ void BaseDatapath::clearDatapath() {
   clearRegStats();
 }
 
+bool BaseDatapath::isConfigSet(const std::string& key) const {
+  if (key == "unrolling")
+    return !user_params.unrolling.empty();
+  if (key == "pipelining")
+    return !user_params.pipeline.empty();
+  if (key == "global_pipelining")
+    return user_params.global_pipelining;
+  if (key == "partition")
+    return !user_params.partition.empty();
+  assert(false && "Unknown configuration key!");
+  return false;
+}
+
 void BaseDatapath::initBaseAddress() {
   auto opt = getGraphOpt<BaseAddressInit>();
   opt->run();
@@ -194,77 +698,217 @@ void BaseDatapath::treeHeightReduction() {
 
 // called in the end of the whole flow
 void BaseDatapath::dumpStats() {
+  computeStats();
+  writeStats();
+}
+
+void BaseDatapath::computeStats() {
   rescheduleNodesWhenNeeded();
   computeRegStats();
-  writePerCycleActivity();
+  computePerCycleActivity();
+}
+
+void BaseDatapath::writeStats() {
+  writeQueueStats();
+  writeResults();
+  writePassProfile();
 #ifdef DEBUG
   dumpGraph(benchName);
   writeOtherStats();
 #endif
 }
 
+void BaseDatapath::writeQueueStats() {
+  console() << "  Peak executing queue: " << peakExecutingQueue << " nodes\n";
+  console() << "  Avg executing queue scan: "
+            << (scannedCycles ? (double)scannedNodes / scannedCycles : 0)
+            << " nodes/cycle" << std::endl;
+}
+
+void BaseDatapath::writePassProfile() {
+  std::string file_name = benchName + "_pass_profile";
+  std::ofstream profile(file_name.c_str(),
+                        std::ofstream::out | std::ofstream::app);
+  profile.seekp(0, std::ofstream::end);
+  passes.writeProfile(profile, profile.tellp() == 0);
+}
+
 /*
- * Write per cycle activity to bench_stats. The format is:
+ * Summarize the per cycle activity. With DEBUG, it is also written to
+ * bench_stats by writeResults(). The format is:
  * cycle_num,num-of-muls,num-of-adds,num-of-bitwise-ops,num-of-reg-reads,num-of-reg-writes
  * If it is called from ScratchpadDatapath, it also outputs per cycle memory
  * activity for each partitioned array.
  */
-void BaseDatapath::writePerCycleActivity() {
-  /* Activity per function in the code. Indexed by function names.  */
-  std::unordered_map<std::string, std::vector<funcActivity>> func_activity;
-  std::unordered_map<std::string, funcActivity> func_max_activity;
-  /* Activity per array. Indexed by array names.  */
-  std::unordered_map<std::string, std::vector<memActivity>> mem_activity;
-
-  std::vector<std::string> comp_partition_names;
-  std::vector<std::string> mem_partition_names;
-  registers.getRegisterNames(comp_partition_names);
-  getMemoryBlocks(mem_partition_names);
-
-  initPerCycleActivity(comp_partition_names,
-                       mem_partition_names,
-                       mem_activity,
-                       func_activity,
-                       func_max_activity,
-                       num_cycles);
-
-  updatePerCycleActivity(mem_activity, func_activity, func_max_activity);
-
-  outputPerCycleActivity(comp_partition_names,
-                         mem_partition_names,
-                         mem_activity,
-                         func_activity,
-                         func_max_activity);
-}
-
-void BaseDatapath::initPerCycleActivity(
-    std::vector<std::string>& comp_partition_names,
-    std::vector<std::string>& mem_partition_names,
-    std::unordered_map<std::string, std::vector<memActivity>>& mem_activity,
-    std::unordered_map<std::string, std::vector<funcActivity>>& func_activity,
-    std::unordered_map<std::string, funcActivity>& func_max_activity,
-    int num_cycles) {
-  for (auto it = comp_partition_names.begin(); it != comp_partition_names.end();
+void BaseDatapath::computePerCycleActivity() {
+  std::vector<funcActivity> func_max_activity(activityFunctions.size());
+  updatePerCycleActivity(func_max_activity);
+  summarizePerCycleActivity(func_max_activity);
+}
+
+void BaseDatapath::initPerCycleActivity() {
+  activityFunctions.assign(functionNames.begin(), functionNames.end());
+  functionSlots.clear();
+  for (unsigned slot = 0; slot < activityFunctions.size(); slot++) {
+    SrcTypes::Function* func =
+        srcManager.get<SrcTypes::Function>(activityFunctions[slot]);
+    if (!func)
+      continue;
+    if (functionSlots.size() <= func->get_index())
+      functionSlots.resize(func->get_index() + 1, -1);
+    functionSlots[func->get_index()] = slot;
+  }
+
+  // An array can be named in both lists, and then both use the same slot.
+  std::unordered_map<std::string, unsigned> array_slots;
+  compPartitionNames.clear();
+  memPartitionNames.clear();
+  registers.getRegisterNames(compPartitionNames);
+  getMemoryBlocks(memPartitionNames);
+  compPartitionSlots.clear();
+  for (auto it = compPartitionNames.begin(); it != compPartitionNames.end();
+       ++it) {
+    auto slot_it = array_slots.insert({ *it, array_slots.size() }).first;
+    compPartitionSlots.push_back(slot_it->second);
+  }
+  memPartitionSlots.clear();
+  for (auto it = memPartitionNames.begin(); it != memPartitionNames.end();
        ++it) {
-    mem_activity.insert(
-        { *it, std::vector<memActivity>(num_cycles, { 0, 0 }) });
+    auto slot_it = array_slots.insert({ *it, array_slots.size() }).first;
+    memPartitionSlots.push_back(slot_it->second);
   }
-  for (auto it = mem_partition_names.begin(); it != mem_partition_names.end();
+  numActivityArrays = array_slots.size();
+  for (auto node_it = program.nodes.begin(); node_it != program.nodes.end();
+       ++node_it) {
+    ExecNode* node = node_it->second;
+    if (node->is_isolated() || !(node->is_load_op() || node->is_store_op()))
+      continue;
+    auto slot_it = array_slots.find(node->get_array_label());
+    if (slot_it != array_slots.end())
+      node->set_activity_array(slot_it->second);
+  }
+
+  /* Nodes are assigned to regions in the order of their ids, and each
+   * boundary closes the region before it. A boundary whose node is gone, or
+   * that is not after the previous one, is never reached, and neither is any
+   * boundary after it. */
+  loopRegionBounds.clear();
+  for (auto it = program.loop_bounds.begin(); it != program.loop_bounds.end();
        ++it) {
-    mem_activity.insert(
-        { *it, std::vector<memActivity>(num_cycles, { 0, 0 }) });
+    if (program.nodes.find(it->node_id) == program.nodes.end() ||
+        (!loopRegionBounds.empty() && it->node_id <= loopRegionBounds.back()))
+      break;
+    loopRegionBounds.push_back(it->node_id);
+  }
+  loopRegionActivity.assign(loopRegionBounds.size() + 1, funcActivity());
+
+  funcCycleActivity.clear();
+  memCycleActivity.clear();
+}
+
+funcActivity& BaseDatapath::getFuncActivity(unsigned cycle,
+                                            unsigned function_slot) {
+  return funcCycleActivity[activityKey(cycle, function_slot)];
+}
+
+memActivity& BaseDatapath::getMemActivity(unsigned cycle,
+                                          unsigned array_slot) {
+  return memCycleActivity[activityKey(cycle, array_slot)];
+}
+
+funcActivity BaseDatapath::findFuncActivity(unsigned cycle,
+                                            unsigned function_slot) const {
+  auto it = funcCycleActivity.find(activityKey(cycle, function_slot));
+  if (it == funcCycleActivity.end())
+    return funcActivity();
+  return it->second;
+}
+
+funcActivity BaseDatapath::getCycleActivity(unsigned cycle) const {
+  funcActivity total;
+  for (unsigned slot = 0; slot < activityFunctions.size(); slot++) {
+    funcActivity activity = findFuncActivity(cycle, slot);
+    total.mul += activity.mul;
+    total.add += activity.add;
+    total.bit += activity.bit;
+    total.shifter += activity.shifter;
+    total.fp_sp_mul += activity.fp_sp_mul;
+    total.fp_dp_mul += activity.fp_dp_mul;
+    total.fp_sp_add += activity.fp_sp_add;
+    total.fp_dp_add += activity.fp_dp_add;
+    total.trig += activity.trig;
+  }
+  return total;
+}
+
+void BaseDatapath::countNodeActivity(ExecNode* node, int count) {
+  unsigned func_index = node->get_static_function()->get_index();
+  assert(func_index < functionSlots.size() && functionSlots[func_index] >= 0 &&
+         "Node of a function that is not accelerated!");
+  unsigned func_slot = functionSlots[func_index];
+  int node_level = node->get_start_execution_cycle();
+
+  if (node->is_multicycle_op()) {
+    for (int stage = 0;
+         node_level + stage < node->get_complete_execution_cycle();
+         stage++) {
+      funcActivity& fp_fu_activity =
+          getFuncActivity(node_level + stage, func_slot);
+      /* Activity for floating point functional units includes all their
+       * stages.*/
+      if (node->is_fp_add_op()) {
+        if (node->is_double_precision())
+          fp_fu_activity.fp_dp_add += count;
+        else
+          fp_fu_activity.fp_sp_add += count;
+      } else if (node->is_fp_mul_op()) {
+        if (node->is_double_precision())
+          fp_fu_activity.fp_dp_mul += count;
+        else
+          fp_fu_activity.fp_sp_mul += count;
+      } else if (node->is_trig_op()) {
+        fp_fu_activity.trig += count;
+      }
+    }
+    return;
+  }
+  if (node->is_memory_op()) {
+    int array_slot = node->get_activity_array();
+    if (array_slot < 0)
+      return;
+    memActivity& curr_mem_activity = getMemActivity(node_level, array_slot);
+    if (node->is_load_op())
+      curr_mem_activity.read += count;
+    else
+      curr_mem_activity.write += count;
+    return;
+  }
+
+  funcActivity& curr_fu_activity = getFuncActivity(node_level, func_slot);
+  funcActivity* region_activity = nullptr;
+  if (node->is_int_add_op() || node->is_shifter_op() || node->is_bit_op()) {
+    unsigned region = std::upper_bound(loopRegionBounds.begin(),
+                                       loopRegionBounds.end(),
+                                       node->get_node_id()) -
+                      loopRegionBounds.begin();
+    region_activity = &loopRegionActivity[region];
   }
-  for (auto it = functionNames.begin(); it != functionNames.end(); ++it) {
-    funcActivity tmp;
-    func_activity.insert({ *it, std::vector<funcActivity>(num_cycles, tmp) });
-    func_max_activity.insert({ *it, tmp });
+  if (node->is_int_mul_op()) {
+    curr_fu_activity.mul += count;
+  } else if (node->is_int_add_op()) {
+    curr_fu_activity.add += count;
+    region_activity->add += count;
+  } else if (node->is_shifter_op()) {
+    curr_fu_activity.shifter += count;
+    region_activity->shifter += count;
+  } else if (node->is_bit_op()) {
+    curr_fu_activity.bit += count;
+    region_activity->bit += count;
   }
 }
 
 void BaseDatapath::updatePerCycleActivity(
-    std::unordered_map<std::string, std::vector<memActivity>>& mem_activity,
-    std::unordered_map<std::string, std::vector<funcActivity>>& func_activity,
-    std::unordered_map<std::string, funcActivity>& func_max_activity) {
+    std::vector<funcActivity>& func_max_activity) {
   /* We use two ways to count the number of functional units in accelerators:
    * one assumes that functional units can be reused in the same region; the
    * other assumes no reuse of functional units. The advantage of reusing is
@@ -275,125 +919,39 @@ void BaseDatapath::updatePerCycleActivity(
    * leakage power and area of multipliers are relatively significant, and no
    * reuse for adders. This way of modeling is consistent with our observation
    * of accelerators generated with Vivado. */
-  unsigned num_adds_so_far = 0, num_bits_so_far = 0, num_shifters_so_far = 0;
-  auto bound_it = program.loop_bounds.begin();
-  for (auto node_it = program.nodes.begin(); node_it != program.nodes.end();
-       ++node_it) {
-    ExecNode* node = node_it->second;
-    // TODO: On every iteration, this could be a bottleneck.
-    std::string func_id = node->get_static_function()->get_name();
-    auto max_it = func_max_activity.find(func_id);
-    assert(max_it != func_max_activity.end());
-
-    if (node->get_node_id() == bound_it->node_id) {
-      if (max_it->second.add < num_adds_so_far)
-        max_it->second.add = num_adds_so_far;
-      if (max_it->second.bit < num_bits_so_far)
-        max_it->second.bit = num_bits_so_far;
-      if (max_it->second.shifter < num_shifters_so_far)
-        max_it->second.shifter = num_shifters_so_far;
-      num_adds_so_far = 0;
-      num_bits_so_far = 0;
-      num_shifters_so_far = 0;
-      bound_it++;
-    }
-    if (node->is_isolated())
-      continue;
-    int node_level = node->get_start_execution_cycle();
-    funcActivity& curr_fu_activity = func_activity.at(func_id).at(node_level);
-
-    if (node->is_multicycle_op()) {
-      for (int stage = 0;
-           node_level + stage < node->get_complete_execution_cycle();
-           stage++) {
-        funcActivity& fp_fu_activity =
-            func_activity.at(func_id).at(node_level + stage);
-        /* Activity for floating point functional units includes all their
-         * stages.*/
-        if (node->is_fp_add_op()) {
-          if (node->is_double_precision())
-            fp_fu_activity.fp_dp_add += 1;
-          else
-            fp_fu_activity.fp_sp_add += 1;
-        } else if (node->is_fp_mul_op()) {
-          if (node->is_double_precision())
-            fp_fu_activity.fp_dp_mul += 1;
-          else
-            fp_fu_activity.fp_sp_mul += 1;
-        } else if (node->is_trig_op()) {
-          fp_fu_activity.trig += 1;
-        }
-      }
-    } else if (node->is_int_mul_op()) {
-      curr_fu_activity.mul += 1;
-    } else if (node->is_int_add_op()) {
-      curr_fu_activity.add += 1;
-      num_adds_so_far += 1;
-    } else if (node->is_shifter_op()) {
-      curr_fu_activity.shifter += 1;
-      num_shifters_so_far += 1;
-    } else if (node->is_bit_op()) {
-      curr_fu_activity.bit += 1;
-      num_bits_so_far += 1;
-    } else if (node->is_load_op()) {
-      const std::string& array_label = node->get_array_label();
-      if (mem_activity.find(array_label) != mem_activity.end())
-        mem_activity.at(array_label).at(node_level).read += 1;
-    } else if (node->is_store_op()) {
-      const std::string& array_label = node->get_array_label();
-      if (mem_activity.find(array_label) != mem_activity.end())
-        mem_activity.at(array_label).at(node_level).write += 1;
-    }
+  for (unsigned region = 0; region < loopRegionBounds.size(); region++) {
+    // Each region counts towards the function of the boundary closing it.
+    ExecNode* bound_node = program.nodes.at(loopRegionBounds[region]);
+    unsigned func_index = bound_node->get_static_function()->get_index();
+    assert(func_index < functionSlots.size() && functionSlots[func_index] >= 0);
+    funcActivity& max_activity = func_max_activity[functionSlots[func_index]];
+    const funcActivity& region_activity = loopRegionActivity[region];
+    max_activity.add = std::max(max_activity.add, region_activity.add);
+    max_activity.bit = std::max(max_activity.bit, region_activity.bit);
+    max_activity.shifter =
+        std::max(max_activity.shifter, region_activity.shifter);
   }
-  for (auto it = functionNames.begin(); it != functionNames.end(); ++it) {
-    auto max_it = func_max_activity.find(*it);
-    assert(max_it != func_max_activity.end());
-    std::vector<funcActivity>& cycle_activity = func_activity.at(*it);
-    max_it->second.mul =
-        std::max_element(cycle_activity.begin(),
-                         cycle_activity.end(),
-                         [](const funcActivity& a, const funcActivity& b) {
-                           return (a.mul < b.mul);
-                         })->mul;
-    max_it->second.fp_sp_mul =
-        std::max_element(cycle_activity.begin(),
-                         cycle_activity.end(),
-                         [](const funcActivity& a, const funcActivity& b) {
-                           return (a.fp_sp_mul < b.fp_sp_mul);
-                         })->fp_sp_mul;
-    max_it->second.fp_dp_mul =
-        std::max_element(cycle_activity.begin(),
-                         cycle_activity.end(),
-                         [](const funcActivity& a, const funcActivity& b) {
-                           return (a.fp_dp_mul < b.fp_dp_mul);
-                         })->fp_dp_mul;
-    max_it->second.fp_sp_add =
-        std::max_element(cycle_activity.begin(),
-                         cycle_activity.end(),
-                         [](const funcActivity& a, const funcActivity& b) {
-                           return (a.fp_sp_add < b.fp_sp_add);
-                         })->fp_sp_add;
-    max_it->second.fp_dp_add =
-        std::max_element(cycle_activity.begin(),
-                         cycle_activity.end(),
-                         [](const funcActivity& a, const funcActivity& b) {
-                           return (a.fp_dp_add < b.fp_dp_add);
-                         })->fp_dp_add;
-    max_it->second.trig =
-        std::max_element(cycle_activity.begin(),
-                         cycle_activity.end(),
-                         [](const funcActivity& a, const funcActivity& b) {
-                           return (a.trig < b.trig);
-                         })->trig;
+  for (auto it = funcCycleActivity.begin(); it != funcCycleActivity.end();
+       ++it) {
+    if ((it->first >> 32) >= (unsigned)num_cycles)
+      continue;
+    const funcActivity& activity = it->second;
+    funcActivity& max_activity = func_max_activity[it->first & 0xffffffff];
+    max_activity.mul = std::max(max_activity.mul, activity.mul);
+    max_activity.fp_sp_mul =
+        std::max(max_activity.fp_sp_mul, activity.fp_sp_mul);
+    max_activity.fp_dp_mul =
+        std::max(max_activity.fp_dp_mul, activity.fp_dp_mul);
+    max_activity.fp_sp_add =
+        std::max(max_activity.fp_sp_add, activity.fp_sp_add);
+    max_activity.fp_dp_add =
+        std::max(max_activity.fp_dp_add, activity.fp_dp_add);
+    max_activity.trig = std::max(max_activity.trig, activity.trig);
   }
 }
 
-void BaseDatapath::outputPerCycleActivity(
-    std::vector<std::string>& comp_partition_names,
-    std::vector<std::string>& mem_partition_names,
-    std::unordered_map<std::string, std::vector<memActivity>>& mem_activity,
-    std::unordered_map<std::string, std::vector<funcActivity>>& func_activity,
-    std::unordered_map<std::string, funcActivity>& func_max_activity) {
+void BaseDatapath::summarizePerCycleActivity(
+    std::vector<funcActivity>& func_max_activity) {
   /*Set the constants*/
   float add_int_power, add_switch_power, add_leak_power, add_area;
   float mul_int_power, mul_switch_power, mul_leak_power, mul_area;
@@ -456,22 +1014,20 @@ void BaseDatapath::outputPerCycleActivity(
                                     &trig_leak_power,
                                     &trig_area);
 
-  std::string file_name;
 #ifdef DEBUG
-  file_name = benchName + "_stats";
-  std::ofstream stats;
-  stats.open(file_name.c_str(), std::ofstream::out | std::ofstream::app);
+  std::ostringstream& stats = cycleStats;
+  stats.str("");
   stats << "cycles," << num_cycles << "," << numTotalNodes << std::endl;
   stats << num_cycles << ",";
 
-  std::ofstream power_stats;
-  file_name += "_power";
-  power_stats.open(file_name.c_str(), std::ofstream::out | std::ofstream::app);
+  std::ostringstream& power_stats = cyclePowerStats;
+  power_stats.str("");
   power_stats << "cycles," << num_cycles << "," << numTotalNodes << std::endl;
   power_stats << num_cycles << ",";
 
   /*Start writing the second line*/
-  for (auto it = functionNames.begin(); it != functionNames.end(); ++it) {
+  for (auto it = activityFunctions.begin(); it != activityFunctions.end();
+       ++it) {
     stats << *it << "-fp-sp-mul," << *it << "-fp-dp-mul," << *it
           << "-fp-sp-add," << *it << "-fp-dp-add," << *it << "-mul," << *it
           << "-add," << *it << "-bit," << *it << "-shifter," << *it << "-trig,";
@@ -480,10 +1036,10 @@ void BaseDatapath::outputPerCycleActivity(
                 << *it << "-add," << *it << "-bit," << *it << "-shifter," << *it
                 << "-trig,";
   }
-  // TODO: mem_partition_names contains logical arrays, not completely
+  // TODO: memPartitionNames contains logical arrays, not completely
   // partitioned arrays.
   stats << "reg,";
-  for (auto it = mem_partition_names.begin(); it != mem_partition_names.end();
+  for (auto it = memPartitionNames.begin(); it != memPartitionNames.end();
        ++it) {
     stats << *it << "-read," << *it << "-write,";
   }
@@ -506,18 +1062,17 @@ void BaseDatapath::outputPerCycleActivity(
   int max_fp_sp_mul = 0, max_fp_dp_mul = 0;
   int max_fp_sp_add = 0, max_fp_dp_add = 0;
   int max_trig = 0;
-  for (auto it = functionNames.begin(); it != functionNames.end(); ++it) {
-    auto max_it = func_max_activity.find(*it);
-    assert(max_it != func_max_activity.end());
-    max_bit += max_it->second.bit;
-    max_add += max_it->second.add;
-    max_mul += max_it->second.mul;
-    max_shifter += max_it->second.shifter;
-    max_fp_sp_mul += max_it->second.fp_sp_mul;
-    max_fp_dp_mul += max_it->second.fp_dp_mul;
-    max_fp_sp_add += max_it->second.fp_sp_add;
-    max_fp_dp_add += max_it->second.fp_dp_add;
-    max_trig += max_it->second.trig;
+  for (auto it = func_max_activity.begin(); it != func_max_activity.end();
+       ++it) {
+    max_bit += it->bit;
+    max_add += it->add;
+    max_mul += it->mul;
+    max_shifter += it->shifter;
+    max_fp_sp_mul += it->fp_sp_mul;
+    max_fp_dp_mul += it->fp_dp_mul;
+    max_fp_sp_add += it->fp_sp_add;
+    max_fp_dp_add += it->fp_dp_add;
+    max_trig += it->trig;
   }
 
   float add_leakage_power = add_leak_power * max_add;
@@ -539,67 +1094,71 @@ void BaseDatapath::outputPerCycleActivity(
   /*Finish calculating the number of FUs and leakage power*/
 
   float fu_dynamic_energy = 0;
-
+  cycleEnergy.clear();
+  cycleMemAccesses.clear();
+
+  /* Only the cycles in which a slot was active have an entry for it. The
+   * entries are visited in (cycle, slot) order, which sums the energy in the
+   * same order as walking every slot of every cycle would, since idle slots
+   * add nothing. */
+  std::vector<std::pair<uint64_t, const funcActivity*>> func_entries;
+  func_entries.reserve(funcCycleActivity.size());
+  for (auto it = funcCycleActivity.begin(); it != funcCycleActivity.end(); ++it)
+    func_entries.push_back({ it->first, &it->second });
+  std::sort(func_entries.begin(), func_entries.end());
+  std::vector<std::pair<uint64_t, const memActivity*>> mem_entries;
+  mem_entries.reserve(memCycleActivity.size());
+  for (auto it = memCycleActivity.begin(); it != memCycleActivity.end(); ++it)
+    mem_entries.push_back({ it->first, &it->second });
+  std::sort(mem_entries.begin(), mem_entries.end());
+
+  // The completely partitioned arrays and the number of scratchpad arrays
+  // that use each array slot.
+  std::vector<std::vector<unsigned>> slot_comp_partitions(numActivityArrays);
+  for (unsigned i = 0; i < compPartitionNames.size(); i++)
+    slot_comp_partitions[compPartitionSlots[i]].push_back(i);
+  std::vector<unsigned> slot_mem_partitions(numActivityArrays, 0);
+  for (auto it = memPartitionSlots.begin(); it != memPartitionSlots.end(); ++it)
+    slot_mem_partitions[*it]++;
+
+  auto func_it = func_entries.begin();
+  auto mem_it = mem_entries.begin();
   /*Start writing per cycle activity */
   for (unsigned curr_level = 0; ((int)curr_level) < num_cycles; ++curr_level) {
 #ifdef DEBUG
     stats << curr_level << ",";
     power_stats << curr_level << ",";
+    std::vector<funcActivity> curr_func_row(activityFunctions.size());
+    std::vector<memActivity> curr_mem_row(numActivityArrays, { 0, 0 });
 #endif
     bool is_fu_idle = true;
+    float curr_cycle_energy = 0;
     // For FUs
-    for (auto it = functionNames.begin(); it != functionNames.end(); ++it) {
-      funcActivity& curr_activity = func_activity.at(*it).at(curr_level);
+    for (; func_it != func_entries.end() && (func_it->first >> 32) == curr_level;
+         ++func_it) {
+      const funcActivity& curr_activity = *func_it->second;
       is_fu_idle &= curr_activity.is_idle();
 #ifdef DEBUG
-      stats << curr_activity.fp_sp_mul << ","
-            << curr_activity.fp_dp_mul << ","
-            << curr_activity.fp_sp_add << ","
-            << curr_activity.fp_dp_add << ","
-            << curr_activity.mul << ","
-            << curr_activity.add << ","
-            << curr_activity.bit << ","
-            << curr_activity.shifter << ","
-            << curr_activity.trig << ",";
+      curr_func_row[func_it->first & 0xffffffff] = curr_activity;
 #endif
-      float curr_fp_sp_mul_dynamic_power =
-          (fp_sp_mul_switch_power + fp_sp_mul_int_power) *
-          curr_activity.fp_sp_mul;
-      float curr_fp_dp_mul_dynamic_power =
-          (fp_dp_mul_switch_power + fp_dp_mul_int_power) *
-          curr_activity.fp_dp_mul;
-      float curr_fp_sp_add_dynamic_power =
-          (fp_sp_add_switch_power + fp_sp_add_int_power) *
-          curr_activity.fp_sp_add;
-      float curr_fp_dp_add_dynamic_power =
-          (fp_dp_add_switch_power + fp_dp_add_int_power) *
-          curr_activity.fp_dp_add;
-      float curr_trig_dynamic_power =
-          (trig_switch_power + trig_int_power) *
-          curr_activity.trig;
-      float curr_mul_dynamic_power = (mul_switch_power + mul_int_power) *
-                                     curr_activity.mul;
-      float curr_add_dynamic_power = (add_switch_power + add_int_power) *
-                                     curr_activity.add;
-      float curr_bit_dynamic_power = (bit_switch_power + bit_int_power) *
-                                     curr_activity.bit;
-      float curr_shifter_dynamic_power =
-          (shifter_switch_power + shifter_int_power) *
-          curr_activity.shifter;
-      fu_dynamic_energy +=
-          (curr_fp_sp_mul_dynamic_power + curr_fp_dp_mul_dynamic_power +
-           curr_fp_sp_add_dynamic_power + curr_fp_dp_add_dynamic_power +
-           curr_trig_dynamic_power + curr_mul_dynamic_power +
-           curr_add_dynamic_power + curr_bit_dynamic_power +
-           curr_shifter_dynamic_power) *
+      float curr_fu_energy =
+          ((fp_sp_mul_switch_power + fp_sp_mul_int_power) *
+               curr_activity.fp_sp_mul +
+           (fp_dp_mul_switch_power + fp_dp_mul_int_power) *
+               curr_activity.fp_dp_mul +
+           (fp_sp_add_switch_power + fp_sp_add_int_power) *
+               curr_activity.fp_sp_add +
+           (fp_dp_add_switch_power + fp_dp_add_int_power) *
+               curr_activity.fp_dp_add +
+           (trig_switch_power + trig_int_power) * curr_activity.trig +
+           (mul_switch_power + mul_int_power) * curr_activity.mul +
+           (add_switch_power + add_int_power) * curr_activity.add +
+           (bit_switch_power + bit_int_power) * curr_activity.bit +
+           (shifter_switch_power + shifter_int_power) *
+               curr_activity.shifter) *
           cycleTime;
-#ifdef DEBUG
-      power_stats << curr_mul_dynamic_power + mul_leakage_power << ","
-                  << curr_add_dynamic_power + add_leakage_power << ","
-                  << curr_bit_dynamic_power + bit_leakage_power << ","
-                  << curr_shifter_dynamic_power + shifter_leakage_power << ","
-                  << curr_trig_dynamic_power << ",";
-#endif
+      fu_dynamic_energy += curr_fu_energy;
+      curr_cycle_energy += curr_fu_energy;
     }
     // For regs
     int curr_reg_reads = regStats.at(curr_level).reads;
@@ -607,25 +1166,52 @@ void BaseDatapath::outputPerCycleActivity(
     float curr_reg_dynamic_energy =
         (reg_int_power_per_bit + reg_switch_power_per_bit) *
         (curr_reg_reads + curr_reg_writes) * 32 * cycleTime;
-    for (auto it = comp_partition_names.begin();
-         it != comp_partition_names.end();
-         ++it) {
-      curr_reg_reads += mem_activity.at(*it).at(curr_level).read;
-      curr_reg_writes += mem_activity.at(*it).at(curr_level).write;
-      curr_reg_dynamic_energy += registers.getReadEnergy(*it) *
-                                     mem_activity.at(*it).at(curr_level).read +
-                                 registers.getWriteEnergy(*it) *
-                                     mem_activity.at(*it).at(curr_level).write;
+    unsigned curr_mem_accesses = 0;
+    for (; mem_it != mem_entries.end() && (mem_it->first >> 32) == curr_level;
+         ++mem_it) {
+      unsigned slot = mem_it->first & 0xffffffff;
+      const memActivity& activity = *mem_it->second;
+#ifdef DEBUG
+      curr_mem_row[slot] = activity;
+#endif
+      for (auto it = slot_comp_partitions[slot].begin();
+           it != slot_comp_partitions[slot].end();
+           ++it) {
+        curr_reg_reads += activity.read;
+        curr_reg_writes += activity.write;
+        curr_reg_dynamic_energy +=
+            registers.getReadEnergy(compPartitionNames[*it]) * activity.read +
+            registers.getWriteEnergy(compPartitionNames[*it]) * activity.write;
+      }
+      curr_mem_accesses +=
+          slot_mem_partitions[slot] * (activity.read + activity.write);
     }
     fu_dynamic_energy += curr_reg_dynamic_energy;
+    if (sampler) {
+      cycleEnergy.push_back(curr_cycle_energy + curr_reg_dynamic_energy);
+      cycleMemAccesses.push_back(curr_mem_accesses);
+    }
 
 #ifdef DEBUG
+    for (auto it = curr_func_row.begin(); it != curr_func_row.end(); ++it) {
+      stats << it->fp_sp_mul << "," << it->fp_dp_mul << "," << it->fp_sp_add
+            << "," << it->fp_dp_add << "," << it->mul << "," << it->add << ","
+            << it->bit << "," << it->shifter << "," << it->trig << ",";
+      power_stats
+          << (mul_switch_power + mul_int_power) * it->mul + mul_leakage_power
+          << ","
+          << (add_switch_power + add_int_power) * it->add + add_leakage_power
+          << ","
+          << (bit_switch_power + bit_int_power) * it->bit + bit_leakage_power
+          << ","
+          << (shifter_switch_power + shifter_int_power) * it->shifter +
+                 shifter_leakage_power
+          << "," << (trig_switch_power + trig_int_power) * it->trig << ",";
+    }
     stats << curr_reg_reads << "," << curr_reg_writes << ",";
-
-    for (auto it = mem_partition_names.begin(); it != mem_partition_names.end();
+    for (auto it = memPartitionSlots.begin(); it != memPartitionSlots.end();
          ++it) {
-      stats << mem_activity.at(*it).at(curr_level).read << ","
-            << mem_activity.at(*it).at(curr_level).write << ",";
+      stats << curr_mem_row[*it].read << "," << curr_mem_row[*it].write << ",";
     }
     stats << std::endl;
     power_stats << curr_reg_dynamic_energy / cycleTime + reg_leakage_power;
@@ -634,10 +1220,6 @@ void BaseDatapath::outputPerCycleActivity(
     if (is_fu_idle)
       idle_fu_cycles++;
   }
-#ifdef DEBUG
-  stats.close();
-  power_stats.close();
-#endif
 
   float avg_mem_power = 0, avg_mem_dynamic_power = 0, mem_leakage_power = 0;
 
@@ -658,7 +1240,7 @@ void BaseDatapath::outputPerCycleActivity(
   float total_area = mem_area + fu_area;
 
   // Summary output.
-  summary_data_t summary;
+  summary_data_t& summary = lastSummary;
   summary.benchName = benchName;
   summary.num_cycles = num_cycles;
   summary.idle_fu_cycles = idle_fu_cycles;
@@ -682,17 +1264,35 @@ void BaseDatapath::outputPerCycleActivity(
   summary.max_fp_sp_add = max_fp_sp_add;
   summary.max_fp_dp_add = max_fp_dp_add;
   summary.max_trig = max_trig;
+}
+
+void BaseDatapath::writeResults() {
+  std::string file_name;
+#ifdef DEBUG
+  file_name = benchName + "_stats";
+  std::ofstream stats(file_name.c_str(),
+                      std::ofstream::out | std::ofstream::app);
+  stats << cycleStats.str();
+  stats.close();
+  file_name += "_power";
+  std::ofstream power_stats(file_name.c_str(),
+                            std::ofstream::out | std::ofstream::app);
+  power_stats << cyclePowerStats.str();
+  power_stats.close();
+#endif
 
-  writeSummary(std::cout, summary);
+  writeSummary(console(), lastSummary);
   std::ofstream summary_file;
   file_name = benchName + "_summary";
   summary_file.open(file_name.c_str(), std::ofstream::out | std::ofstream::app);
-  writeSummary(summary_file, summary);
+  writeSummary(summary_file, lastSummary);
   summary_file.close();
+  if (sampler)
+    writeSamplingSummary(lastSummary, cycleEnergy, cycleMemAccesses);
 
 #ifdef USE_DB
   if (use_db)
-    writeSummaryToDatabase(summary);
+    writeSummaryToDatabase(lastSummary);
 #endif
 }
 
@@ -804,13 +1404,15 @@ void BaseDatapath::writeOtherStats() {
 // stepFunctions
 // multiple function, each function is a separate graph
 void BaseDatapath::prepareForScheduling() {
-  std::cout << "=============================================" << std::endl;
-  std::cout << "      Scheduling...            " << benchName << std::endl;
-  std::cout << "=============================================" << std::endl;
+  console() << "=============================================" << std::endl;
+  console() << "      Scheduling...            " << benchName << std::endl;
+  console() << "=============================================" << std::endl;
 
-  edgeToParid = get(boost::edge_name, program.graph);
+  // The graph is not modified from here on.
+  program.freezeGraph();
+  const FrozenGraph& graph = program.frozen_graph;
 
-  numTotalEdges = boost::num_edges(program.graph);
+  numTotalEdges = graph.numEdges();
   executedNodes = 0;
   totalConnectedNodes = 0;
   for (auto node_it = program.nodes.begin(); node_it != program.nodes.end();
@@ -819,19 +1421,26 @@ void BaseDatapath::prepareForScheduling() {
     if (!node->has_vertex())
       continue;
     Vertex node_vertex = node->get_vertex();
-    if (boost::degree(node_vertex, program.graph) != 0 || node->is_dma_load() ||
+    if (graph.degree(node_vertex) != 0 || node->is_dma_load() ||
         node->is_dma_store() || node->is_dma_fence()) {
-      node->set_num_parents(boost::in_degree(node_vertex, program.graph));
+      node->set_num_parents(graph.inDegree(node_vertex));
       node->set_isolated(false);
       totalConnectedNodes++;
     }
   }
-  std::cout << "  Total connected nodes: " << totalConnectedNodes << "\n";
-  std::cout << "  Total edges: " << numTotalEdges << "\n";
-  std::cout << "=============================================" << std::endl;
+  console() << "  Total connected nodes: " << totalConnectedNodes << "\n";
+  console() << "  Total edges: " << numTotalEdges << "\n";
+  console() << "  Full topological sorts: " << program.topo_order.getNumSorts()
+            << "\n";
+  console() << "=============================================" << std::endl;
 
   executingQueue.clear();
   readyToExecuteQueue.clear();
+  readyStoreQueue.clear();
+  peakExecutingQueue = 0;
+  scannedNodes = 0;
+  scannedCycles = 0;
+  initPerCycleActivity();
   initExecutingQueue();
 }
 
@@ -853,23 +1462,22 @@ void BaseDatapath::dumpGraph(std::string graph_name) {
   can lead to values that are produced way earlier than they are needed. For
   such case, we add an ALAP rescheduling pass to reorganize the graph without
   changing the critical path and memory nodes, but produce a more balanced
-  design.*/
+  design. The activity of the moved nodes moves with them.*/
 int BaseDatapath::rescheduleNodesWhenNeeded() {
-  std::vector<Vertex> topo_nodes;
-  boost::topological_sort(program.graph, std::back_inserter(topo_nodes));
+  const FrozenGraph& graph = program.frozen_graph;
+  const std::vector<Vertex>& topo_nodes = program.topo_order.get(graph);
+  // Indexed by vertex.
+  std::vector<int> earliest_child(graph.numVertices(), num_cycles);
   // bottom nodes first
-  std::map<unsigned, int> earliest_child;
-  for (auto node_id_pair : program.nodes) {
-    earliest_child[node_id_pair.first] = num_cycles;
-  }
-  for (auto vi = topo_nodes.begin(); vi != topo_nodes.end(); ++vi) {
-    unsigned node_id = program.atVertex(*vi);
-    ExecNode* node = program.nodes.at(node_id);
+  for (auto it = topo_nodes.rbegin(); it != topo_nodes.rend(); ++it) {
+    unsigned v = *it;
+    ExecNode* node = graph.node(v);
     if (node->is_isolated())
       continue;
     if (!node->is_memory_op() && !node->is_branch_op()) {
-      int new_cycle = earliest_child.at(node_id) - 1;
+      int new_cycle = earliest_child[v] - 1;
       if (new_cycle > node->get_complete_execution_cycle()) {
+        countNodeActivity(node, -1);
         node->set_complete_execution_cycle(new_cycle);
         if (node->is_fp_op()) {
           node->set_start_execution_cycle(
@@ -877,22 +1485,24 @@ int BaseDatapath::rescheduleNodesWhenNeeded() {
         } else {
           node->set_start_execution_cycle(new_cycle);
         }
+        countNodeActivity(node, 1);
       }
     }
 
-    in_edge_iter in_i, in_end;
-    for (boost::tie(in_i, in_end) = in_edges(*vi, program.graph); in_i != in_end;
-         ++in_i) {
-      int parent_id = program.atVertex(source(*in_i, program.graph));
-      if (earliest_child.at(parent_id) > node->get_start_execution_cycle())
-        earliest_child.at(parent_id) = node->get_start_execution_cycle();
+    FrozenGraph::EdgeRange parents = graph.inEdges(v);
+    for (unsigned i = 0; i < parents.size; i++) {
+      unsigned parent = parents.vertices[i];
+      if (earliest_child[parent] > node->get_start_execution_cycle())
+        earliest_child[parent] = node->get_start_execution_cycle();
     }
   }
   return num_cycles;
 }
 
 void BaseDatapath::computeRegStats() {
+  const FrozenGraph& graph = program.frozen_graph;
   regStats.assign(num_cycles, { 0, 0, 0 });
+  std::vector<int> children_levels;
   for (auto node_it = program.nodes.begin(); node_it != program.nodes.end();
        ++node_it) {
     ExecNode* node = node_it->second;
@@ -901,14 +1511,10 @@ void BaseDatapath::computeRegStats() {
     int node_level = node->get_complete_execution_cycle();
     int max_children_level = node_level;
 
-    Vertex node_vertex = node->get_vertex();
-    out_edge_iter out_edge_it, out_edge_end;
-    std::set<int> children_levels;
-    for (boost::tie(out_edge_it, out_edge_end) = out_edges(node_vertex, program.graph);
-         out_edge_it != out_edge_end;
-         ++out_edge_it) {
-      int child_id = program.atVertex(target(*out_edge_it, program.graph));
-      ExecNode* child_node = program.nodes.at(child_id);
+    FrozenGraph::EdgeRange children = graph.outEdges(node->get_vertex());
+    children_levels.clear();
+    for (unsigned i = 0; i < children.size; i++) {
+      ExecNode* child_node = graph.node(children.vertices[i]);
       if (child_node->is_control_op() || child_node->is_load_op())
         continue;
 
@@ -916,8 +1522,13 @@ void BaseDatapath::computeRegStats() {
       if (child_level > max_children_level)
         max_children_level = child_level;
       if (child_level > node_level && child_level != num_cycles - 1)
-        children_levels.insert(child_level);
+        children_levels.push_back(child_level);
     }
+    // Each level is counted once per node.
+    std::sort(children_levels.begin(), children_levels.end());
+    children_levels.erase(
+        std::unique(children_levels.begin(), children_levels.end()),
+        children_levels.end());
     for (auto it = children_levels.begin(); it != children_levels.end(); it++)
       regStats.at(*it).reads++;
 
@@ -927,15 +1538,16 @@ void BaseDatapath::computeRegStats() {
 }
 
 void BaseDatapath::copyToExecutingQueue() {
-  auto it = readyToExecuteQueue.begin();
-  while (it != readyToExecuteQueue.end()) {
-    ExecNode* node = *it;
-    if (node->is_store_op())
-      executingQueue.push_front(node);
-    else
-      executingQueue.push_back(node);
-    it = readyToExecuteQueue.erase(it);
+  if (!readyStoreQueue.empty()) {
+    readyStoreQueue.insert(
+        readyStoreQueue.end(), executingQueue.begin(), executingQueue.end());
+    executingQueue.swap(readyStoreQueue);
+    readyStoreQueue.clear();
   }
+  executingQueue.insert(executingQueue.end(),
+                        readyToExecuteQueue.begin(),
+                        readyToExecuteQueue.end());
+  readyToExecuteQueue.clear();
 }
 
 bool BaseDatapath::step() {
@@ -951,29 +1563,19 @@ void BaseDatapath::markNodeStarted(ExecNode* node) {
   node->set_start_execution_cycle(num_cycles);
 }
 
-// Marks a node as completed and advances the executing queue iterator.
-void BaseDatapath::markNodeCompleted(
-    std::list<ExecNode*>::iterator& executingQueuePos, int& advance_to) {
-  ExecNode* node = *executingQueuePos;
+// Marks a node as completed. The caller removes it from the executing queue.
+void BaseDatapath::markNodeCompleted(ExecNode* node) {
   executedNodes++;
   node->set_complete_execution_cycle(num_cycles);
-  executingQueue.erase(executingQueuePos);
+  // Streamed nodes are not kept until the end, so neither is their activity.
+  if (!stream)
+    countNodeActivity(node, 1);
   updateChildren(node);
-  executingQueuePos = executingQueue.begin();
-  std::advance(executingQueuePos, advance_to);
 }
 
 void BaseDatapath::updateChildren(ExecNode* node) {
-  if (!node->has_vertex())
-    return;
-  Vertex node_vertex = node->get_vertex();
-  out_edge_iter out_edge_it, out_edge_end;
-  for (boost::tie(out_edge_it, out_edge_end) = out_edges(node_vertex, program.graph);
-       out_edge_it != out_edge_end;
-       ++out_edge_it) {
-    Vertex child_vertex = target(*out_edge_it, program.graph);
-    ExecNode* child_node = program.nodeAtVertex(child_vertex);
-    int edge_parid = edgeToParid[*out_edge_it];
+  float finish_time = (num_cycles + 1) * user_params.cycle_time;
+  forEachChild(node, finish_time, [&](ExecNode* child_node, int edge_parid) {
     if (child_node->get_num_parents() > 0) {
       child_node->decr_num_parents();
       if (child_node->get_num_parents() == 0) {
@@ -990,15 +1592,12 @@ void BaseDatapath::updateChildren(ExecNode* node) {
              edge_parid != CONTROL_EDGE)) {
           executingQueue.push_back(child_node);
         } else {
-          if (child_node->is_store_op())
-            readyToExecuteQueue.push_front(child_node);
-          else
-            readyToExecuteQueue.push_back(child_node);
+          pushReady(child_node);
         }
         child_node->set_num_parents(-1);
       }
     }
-  }
+  });
 }
 
 void BaseDatapath::initExecutingQueue() {
@@ -1123,6 +1722,36 @@ void BaseDatapath::parse_config(std::string& bench,
       user_params.ready_mode = atoi(rest_line.c_str());
     } else if (!type.compare("scratchpad_ports")) {
       user_params.scratchpad_ports = atoi(rest_line.c_str());
+    } else if (!type.compare("invocations")) {
+      user_params.select_invocations = true;
+      sscanf(rest_line.c_str(),
+             "%u,%u\n",
+             &user_params.first_invocation,
+             &user_params.last_invocation);
+    } else if (!type.compare("parallel_invocations")) {
+      user_params.parallel_invocations = atoi(rest_line.c_str());
+    } else if (!type.compare("graph_opt_threads")) {
+      user_params.graph_opt_threads = atoi(rest_line.c_str());
+    } else if (!type.compare("stream_window")) {
+      user_params.stream_window = atoi(rest_line.c_str());
+    } else if (!type.compare("event_driven")) {
+      user_params.event_driven = atoi(rest_line.c_str());
+    } else if (!type.compare("sampling")) {
+      char function_name[256], label_or_line_num[64];
+      int num_fields = sscanf(rest_line.c_str(), "%[^,],%[^,],%u,%u,%u\n",
+                              function_name, label_or_line_num,
+                              &user_params.sampling_warmup,
+                              &user_params.sampling_window,
+                              &user_params.sampling_period);
+      if (num_fields != 5 || user_params.sampling_window == 0 ||
+          user_params.sampling_period == 0) {
+        std::cerr << "Invalid sampling directive: " << wholeline << std::endl;
+        exit(1);
+      }
+      user_params.sampling = true;
+      user_params.sampled_function =
+          srcManager.insert<Function>(function_name);
+      user_params.sampled_label = srcManager.insert<Label>(label_or_line_num);
     } else {
       std::cerr << "Invalid config type: " << wholeline << std::endl;
       exit(1);
@@ -16,10 +16,12 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
+#include <deque>
 #include <map>
 #include <memory>
 #include <list>
 #include <set>
+#include <sstream>
 #include <stdint.h>
 #include <unistd.h>
 
@@ -28,13 +30,16 @@
 #include "ExecNode.h"
 #include "typedefs.h"
 #include "DDDG.h"
+#include "PassManager.h"
 #include "file_func.h"
 #include "opcode_func.h"
 #include "generic_func.h"
+#include "LoopSampler.h"
 #include "Program.h"
 #include "Registers.h"
 #include "Scratchpad.h"
 #include "SourceManager.h"
+#include "StreamWindow.h"
 #include "DynamicEntity.h"
 #include "user_config.h"
 
@@ -65,7 +70,7 @@ struct funcActivity {
     trig = 0;
   }
 
-  bool is_idle() {
+  bool is_idle() const {
     return (mul == 0 && add == 0 && bit == 0 && shifter == 0 &&
             fp_sp_mul == 0 && fp_dp_mul == 0 && fp_dp_add == 0 && trig == 0);
   }
@@ -139,18 +144,56 @@ class BaseDatapath {
 
  public:
   BaseDatapath(std::string& bench,
-               std::string& trace_file_name,
+               std::string& _trace_file_name,
                std::string& _config_file);
   virtual ~BaseDatapath();
 
   //=----------- Program building functions ------------=//
 
-  // Build the program: the DDDG and exec node data.
+  // Build the program: the DDDG and exec node data. With the sampling
+  // directive, only the sampled iterations of the loop are built.
   //
   // Return true if the graph was built, false if not. False can happen if the
   // trace was empty.
   bool buildDddg();
 
+  /* Build and schedule the next invocation in one pass over the trace (the
+   * stream_window directive).
+   *
+   * Each node is scheduled as soon as it has been parsed, and freed once it
+   * has executed and is older than the window, so memory use depends on the
+   * window size rather than on the length of the trace. The graph
+   * optimizations are not applied. The schedule is that of the unoptimized
+   * graph, except that a node cannot start before it has been parsed, and an
+   * edge from a node that was already freed is dropped. Both are counted and
+   * reported with the results.
+   *
+   * Return false if there are no more invocations in the trace.
+   */
+  bool streamDddg();
+
+  /* Only build the DDDGs of top-level invocations @first to @last (inclusive,
+   * counting from 0) of a text trace.
+   *
+   * The invocations are found with the index saved next to the trace, which
+   * is built first if necessary, so the earlier invocations are not parsed.
+   * Their labelmap is still read. This must be called before buildDddg().
+   *
+   * Return false if the trace could not be indexed or has no such invocation.
+   */
+  bool selectInvocations(unsigned first, unsigned last);
+
+  /* Load the index of the top-level invocations in a text trace, building it
+   * first if necessary. Return false if the trace could not be indexed.
+   */
+  bool loadTraceIndex();
+
+  /* Return the invocations to simulate in @first and @last: those chosen with
+   * the invocations directive, or else all of them. The trace index must have
+   * been loaded.
+   */
+  void getSelectedInvocations(unsigned* first, unsigned* last) const;
+
   // Add a function to the list of functions.
   void addFunctionName(std::string func_name) {
     functionNames.insert(func_name);
@@ -206,21 +249,69 @@ class BaseDatapath {
   std::string getBenchName() { return benchName; }
   SrcTypes::SourceManager& get_source_manager() { return srcManager; }
   const Program& getProgram() const { return program; }
+  const std::vector<PassManager::PassProfile>& getPassProfile() const {
+    return passes.getProfile();
+  }
   Addr getBaseAddress(const std::string& label) {
     return user_params.partition.at(label).base_addr;
   }
 
+  //=------------ Console output functions --------------=//
+
+  // The stream progress messages are printed to: std::cout, or a buffer after
+  // bufferConsole().
+  std::ostream& console() { return *consoleOut; }
+  // Hold the console output back until flushConsole(), so that datapaths
+  // running on other threads don't interleave their messages.
+  void bufferConsole() { consoleOut = &consoleBuffer; }
+  // Print the held back console output to std::cout.
+  void flushConsole() {
+    std::cout << consoleBuffer.str() << std::flush;
+    consoleBuffer.str("");
+  }
+  // The file the progress of building the DDDG is written to.
+  const std::string& getProgressFileName() const { return progressFileName; }
+  void setProgressFileName(const std::string& file_name) {
+    progressFileName = file_name;
+  }
+
   //=----------- User configuration functions ------------=//
 
   bool isReadyMode() const { return user_params.ready_mode; }
+  bool isStreaming() const { return user_params.stream_window > 0; }
+  bool isSampling() const { return user_params.sampling; }
+  // Is the configuration directive @key ("unrolling", "pipelining",
+  // "global_pipelining" or "partition") set?
+  bool isConfigSet(const std::string& key) const;
+  unsigned getParallelInvocations() const {
+    return user_params.parallel_invocations;
+  }
 
   //=----------- Simulation/scheduling functions --------=//
 
   unsigned getCurrentCycle() { return num_cycles; }
+  // Statistics of the last streamed invocation.
+  size_t getPeakLiveNodes() const { return peakLiveNodes; }
+  unsigned getLateNodes() const { return lateNodes; }
+  unsigned getWindowMisses() const { return windowMisses; }
+  unsigned getTotalConnectedNodes() const { return totalConnectedNodes; }
+  size_t getPeakExecutingQueue() const { return peakExecutingQueue; }
+  uint64_t getScannedNodes() const { return scannedNodes; }
+  unsigned getScannedCycles() const { return scannedCycles; }
+  // The functional unit activity of all the functions in @cycle so far.
+  funcActivity getCycleActivity(unsigned cycle) const;
+  // The iterations sampled from the last invocation, or null if it was not
+  // sampled, and its extrapolated cycle count.
+  const LoopSampler* getSampler() const { return sampler.get(); }
+  LoopSampler::Estimate getEstimatedCycles() const { return estimatedCycles; }
   virtual void prepareForScheduling();
   virtual int rescheduleNodesWhenNeeded();
   void dumpGraph(std::string graph_name);
   void dumpStats();
+  // The two halves of dumpStats(). Computing the stats only touches this
+  // datapath, while writing them appends to the shared output files.
+  void computeStats();
+  void writeStats();
 
   //=------------ Clean up functions -----------=//
 
@@ -268,7 +359,8 @@ class BaseDatapath {
   // Create a graph optimization object.
   template <typename T>
   std::unique_ptr<T> getGraphOpt() {
-    return std::unique_ptr<T>(new T(program, srcManager, user_params));
+    return std::unique_ptr<T>(
+        new T(program, srcManager, user_params, console()));
   }
 
   //=------------- User configuration routines -------------=//
@@ -288,6 +380,64 @@ class BaseDatapath {
   // After marking a node as completed, update the state of its children.
   virtual void updateChildren(ExecNode* node);
 
+  /* Call @visit(child, edge type) for each child of @node, which has just
+   * completed. Its children may start at @finish_time (in ns). While a trace
+   * is streamed, these are the children parsed so far, and the node is
+   * marked as done in the window.
+   */
+  template <typename Visitor>
+  void forEachChild(ExecNode* node, float finish_time, Visitor visit) {
+    if (stream) {
+      StreamWindow::Entry* entry = stream->find(node->get_node_id());
+      entry->done = true;
+      entry->finish_time = finish_time;
+      for (auto& child : entry->children)
+        visit(child.first, child.second);
+      std::vector<std::pair<ExecNode*, uint8_t>>().swap(entry->children);
+      return;
+    }
+    if (!node->has_vertex())
+      return;
+    FrozenGraph::EdgeRange children =
+        program.frozen_graph.outEdges(node->get_vertex());
+    for (unsigned i = 0; i < children.size; i++)
+      visit(program.frozen_graph.node(children.vertices[i]), children.types[i]);
+  }
+
+  //=-------------- Streaming ----------------=/
+
+  // Schedule @node, which was just parsed and has the incoming @edges.
+  void addStreamedNode(ExecNode* node, const std::vector<dddg_edge_t>& edges);
+  // Set the array label and DMA operands of a streamed node from its parents,
+  // as BaseAddressInit and DmaBaseAddressInit do for the whole graph.
+  void initStreamedAddress(ExecNode* node,
+                           const std::vector<dddg_edge_t>& edges);
+  // Decide whether the roots that have aged past the window, or all of them
+  // at the end of the trace, are connected, and queue those that are.
+  void decideStreamedRoots(bool end_of_trace);
+  // Make @node part of the schedule once it is known to be connected.
+  void connectStreamedNode(ExecNode* node, int num_parents, float ready_time);
+  // Step while the oldest node that has not executed is older than the
+  // window, then free the nodes that are done with.
+  void advanceStream();
+  // Print the streaming results and append them to bench_summary.
+  void writeStreamingSummary();
+  // Prepare a connected streamed node for scheduling.
+  virtual void initStreamedNode(ExecNode* node) {}
+
+  //=-------------- Sampling ----------------=/
+
+  // Add @node, which was just parsed and has the incoming @edges, to the
+  // graph if its iteration is sampled, or free it otherwise.
+  void addSampledNode(ExecNode* node, const std::vector<dddg_edge_t>& edges);
+  /* Extrapolate the results to the whole loop and append them to
+   * bench_summary. @cycle_energy is the dynamic FU and register energy of each
+   * cycle and @cycle_mem_accesses the number of memory accesses in it.
+   */
+  void writeSamplingSummary(const summary_data_t& summary,
+                            const std::vector<float>& cycle_energy,
+                            const std::vector<unsigned>& cycle_mem_accesses);
+
   // Compute the number of registers needed at each cycle.
   void computeRegStats();
 
@@ -296,32 +446,60 @@ class BaseDatapath {
   void copyToExecutingQueue();
   void initExecutingQueue();
   virtual void markNodeStarted(ExecNode* node);
-  void markNodeCompleted(std::list<ExecNode*>::iterator& executingQueuePos,
-                         int& advance_to);
+  void markNodeCompleted(ExecNode* node);
+  // Queue @node to start in the next cycle. Stores then go ahead of all the
+  // nodes already executing, so they get the memory ports first.
+  void pushReady(ExecNode* node) {
+    if (node->is_store_op())
+      readyStoreQueue.push_back(node);
+    else
+      readyToExecuteQueue.push_back(node);
+  }
+  /* Visit each node in the executing queue in order, including the nodes
+   * queued while visiting it, and remove those for which @execute returns
+   * true. The nodes that stay keep their order.
+   */
+  template <typename Executor> void scanExecutingQueue(Executor execute) {
+    peakExecutingQueue = std::max(peakExecutingQueue, executingQueue.size());
+    size_t kept = 0;
+    for (size_t i = 0; i < executingQueue.size(); i++) {
+      // Executing a node can queue more nodes, so the queue may move.
+      ExecNode* node = executingQueue[i];
+      if (!execute(node))
+        executingQueue[kept++] = node;
+    }
+    scannedNodes += executingQueue.size();
+    scannedCycles++;
+    executingQueue.resize(kept);
+  }
+  // Print the executing queue statistics of the last schedule.
+  void writeQueueStats();
 
   // Stats output.
-  void writePerCycleActivity();
+  void computePerCycleActivity();
+  // Write the summary of the last invocation computed by computeStats().
+  void writeResults();
   void writeBaseAddress();
   // Writes microop, execution cycle, and isolated nodes.
   void writeOtherStats();
-  void initPerCycleActivity(
-      std::vector<std::string>& comp_partition_names,
-      std::vector<std::string>& mem_partition_names,
-      std::unordered_map<std::string, std::vector<memActivity>>& mem_activity,
-      std::unordered_map<std::string, std::vector<funcActivity>>& func_activity,
-      std::unordered_map<std::string, funcActivity>& func_max_activity,
-      int num_cycles);
-  void updatePerCycleActivity(
-      std::unordered_map<std::string, std::vector<memActivity>>& mem_activity,
-      std::unordered_map<std::string, std::vector<funcActivity>>& func_activity,
-      std::unordered_map<std::string, funcActivity>& func_max_activity);
-  void outputPerCycleActivity(
-      std::vector<std::string>& comp_partition_names,
-      std::vector<std::string>& mem_partition_names,
-      std::unordered_map<std::string, std::vector<memActivity>>& mem_activity,
-      std::unordered_map<std::string, std::vector<funcActivity>>& func_activity,
-      std::unordered_map<std::string, funcActivity>& func_max_activity);
+  // Assign slots in the per cycle activity to the functions and arrays, and
+  // start counting from an empty schedule.
+  void initPerCycleActivity();
+  // Add the activity of @node, in the cycles it is scheduled in, @count times
+  // to the per cycle activity. A negative count takes it out again.
+  void countNodeActivity(ExecNode* node, int count);
+  static uint64_t activityKey(unsigned cycle, unsigned slot) {
+    return ((uint64_t)cycle << 32) | slot;
+  }
+  funcActivity& getFuncActivity(unsigned cycle, unsigned function_slot);
+  memActivity& getMemActivity(unsigned cycle, unsigned array_slot);
+  // The activity of a function in a cycle, which is zero if it has no entry.
+  funcActivity findFuncActivity(unsigned cycle, unsigned function_slot) const;
+  void updatePerCycleActivity(std::vector<funcActivity>& func_max_activity);
+  void summarizePerCycleActivity(std::vector<funcActivity>& func_max_activity);
   void writeSummary(std::ostream& outfile, summary_data_t& summary);
+  // Append the graph optimization profile to bench_pass_profile.
+  void writePassProfile();
 
 #ifdef USE_DB
   /* Gets the experiment id for experiment_name. If this is a new
@@ -349,12 +527,20 @@ class BaseDatapath {
   std::string benchName;
   int num_cycles;
 
+  // Where console() prints to, and the buffer for bufferConsole().
+  std::ostream* consoleOut;
+  std::ostringstream consoleBuffer;
+  std::string progressFileName;
+
   // The accelerated program description.
   Program program;
 
   // All options that can be specified by the user are contained here.
   UserConfigParams user_params;
 
+  // The graph optimizations, registered by the child class.
+  PassManager passes;
+
   SrcTypes::SourceManager srcManager;
 
   /* True if the summarized results should be stored to a database, false
@@ -365,9 +551,6 @@ class BaseDatapath {
    * into databases, this is required. */
   std::string experiment_name;
 
-  // The final set of edge weights after all graph optimizations have been run.
-  EdgeNameMap edgeToParid;
-
   // Graph node and edge attributes.
   unsigned numTotalNodes;
   unsigned numTotalEdges;
@@ -380,19 +563,85 @@ class BaseDatapath {
   Registers registers;
 
   std::vector<regEntry> regStats;
+
+  // The results of the last invocation, and the dynamic energy and memory
+  // accesses of each of its cycles, to extrapolate the sampled iterations
+  // from.
+  summary_data_t lastSummary;
+  std::vector<float> cycleEnergy;
+  std::vector<unsigned> cycleMemAccesses;
+  // The per cycle activity and power of the last invocation, only written
+  // with DEBUG. Kept in all builds so the layout does not depend on it.
+  std::ostringstream cycleStats;
+  std::ostringstream cyclePowerStats;
+
+  // Activity per cycle, counted as nodes complete, keyed by
+  // activityKey(cycle, function or array slot). Only the cycles in which a
+  // function or an array was active have an entry for its slot.
+  std::unordered_map<uint64_t, funcActivity> funcCycleActivity;
+  std::unordered_map<uint64_t, memActivity> memCycleActivity;
+  // The accelerated functions, in slot order.
+  std::vector<std::string> activityFunctions;
+  // Slot of each function, indexed by SrcTypes::Function::get_index(), or -1.
+  std::vector<int> functionSlots;
+  // Completely partitioned and scratchpad arrays, and the slot of each.
+  std::vector<std::string> compPartitionNames;
+  std::vector<std::string> memPartitionNames;
+  std::vector<unsigned> compPartitionSlots;
+  std::vector<unsigned> memPartitionSlots;
+  unsigned numActivityArrays;
+  // Ids of the loop boundary nodes that split the integer adders, bitwise
+  // operators and shifters into regions, and the number of each executed in
+  // every region.
+  std::vector<unsigned> loopRegionBounds;
+  std::vector<funcActivity> loopRegionActivity;
   std::unordered_set<std::string> functionNames;
   std::vector<DynLoopBound> loopBound;
 
   unsigned totalConnectedNodes;
   unsigned executedNodes;
 
-  std::list<ExecNode*> executingQueue;
-  std::list<ExecNode*> readyToExecuteQueue;
+  // The nodes that can execute in the current cycle, in the order they are
+  // tried.
+  std::vector<ExecNode*> executingQueue;
+  // The nodes that can execute from the next cycle on, other than stores, and
+  // the stores, each in the order they became ready.
+  std::vector<ExecNode*> readyToExecuteQueue;
+  std::vector<ExecNode*> readyStoreQueue;
+  // The longest the executing queue has been at the start of a cycle, the
+  // nodes visited over all cycles, and the number of cycles scanned.
+  size_t peakExecutingQueue;
+  uint64_t scannedNodes;
+  unsigned scannedCycles;
 
   // Dynamic trace file name.
+  std::string trace_file_name;
   gzFile trace_file;
+  // Pipelined line reader for text traces. Null if the trace is binary.
+  std::unique_ptr<TraceLineReader> text_trace;
+  // Decoder for binary traces. Null if the trace is in the text format.
+  std::unique_ptr<BinaryTraceReader> binary_trace;
+  // Index of the invocations in the trace, if only some are simulated.
+  std::unique_ptr<TraceIndex> trace_index;
   size_t current_trace_off;
   size_t trace_size;
+
+  // The window of nodes while a trace is streamed, or null.
+  std::unique_ptr<StreamWindow> stream;
+  // Ids of the streamed roots not yet known to be connected or isolated.
+  std::deque<unsigned> pendingRoots;
+  // Id of the oldest streamed node that might not be done yet.
+  unsigned firstUndoneNode;
+  // The most streamed nodes in memory at once.
+  size_t peakLiveNodes;
+  // Streamed nodes that became ready only once they were parsed.
+  unsigned lateNodes;
+  // Edges dropped because their source had already left the window.
+  unsigned windowMisses;
+
+  // Chooses the iterations to simulate with the sampling directive, or null.
+  std::unique_ptr<LoopSampler> sampler;
+  LoopSampler::Estimate estimatedCycles;
 };
 
 #endif
@@ -0,0 +1,419 @@
+#include <cstring>
+
+#include "BinaryTrace.h"
+
+using namespace SrcTypes;
+using namespace BinaryTrace;
+
+// Records are accumulated in memory and written out in chunks of this size.
+static const size_t kWriteChunkSize = 1 << 16;
+static const size_t kReadChunkSize = 1 << 16;
+
+//=---------------------------- BinaryTraceWriter ----------------------------=//
+
+BinaryTraceWriter::BinaryTraceWriter(gzFile _trace_file)
+    : trace_file(_trace_file), prev_node_id(-1), num_records(0) {
+  buffer.reserve(kWriteChunkSize * 2);
+}
+
+BinaryTraceWriter::~BinaryTraceWriter() { flush(); }
+
+void BinaryTraceWriter::flush() {
+  if (buffer.empty())
+    return;
+  if (gzwrite(trace_file, buffer.data(), buffer.size()) !=
+      (int)buffer.size()) {
+    std::cerr << "ERROR: Failed to write the binary trace." << std::endl;
+    exit(1);
+  }
+  buffer.clear();
+}
+
+void BinaryTraceWriter::putVarint(uint64_t value) {
+  while (value >= 0x80) {
+    putByte((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  putByte((uint8_t)value);
+}
+
+void BinaryTraceWriter::putSignedVarint(int64_t value) {
+  putVarint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+void BinaryTraceWriter::putBytes(const void* data, size_t len) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  buffer.insert(buffer.end(), bytes, bytes + len);
+}
+
+unsigned BinaryTraceWriter::intern(const std::string& str) {
+  auto it = string_ids.find(str);
+  if (it != string_ids.end())
+    return it->second;
+  unsigned id = string_ids.size();
+  string_ids[str] = id;
+  putByte(StringDef);
+  putVarint(str.size());
+  putBytes(str.data(), str.size());
+  return id;
+}
+
+void BinaryTraceWriter::writeHeader() {
+  putBytes(kMagic, sizeof(kMagic));
+  putVarint(kVersion);
+}
+
+void BinaryTraceWriter::writeLabelMapEntry(
+    const std::string& function,
+    const std::string& label,
+    int line_num,
+    const std::vector<std::string>& callers) {
+  // Strings must be defined before the record that uses them.
+  unsigned function_id = intern(function);
+  unsigned label_id = intern(label);
+  std::vector<unsigned> caller_ids;
+  for (auto& caller : callers)
+    caller_ids.push_back(intern(caller));
+
+  putByte(LabelMapEntry);
+  putVarint(function_id);
+  putVarint(label_id);
+  putSignedVarint(line_num);
+  putVarint(caller_ids.size());
+  for (unsigned id : caller_ids)
+    putVarint(id);
+  num_records++;
+}
+
+void BinaryTraceWriter::writeEntryDecl(const std::string& function,
+                                       int num_parameters) {
+  unsigned function_id = intern(function);
+  putByte(EntryDecl);
+  putVarint(function_id);
+  putVarint(num_parameters);
+  num_records++;
+}
+
+void BinaryTraceWriter::writeInstruction(int line_num,
+                                         const std::string& function,
+                                         const std::string& bblock,
+                                         const std::string& inst,
+                                         int microop,
+                                         long node_id) {
+  unsigned function_id = intern(function);
+  unsigned bblock_id = intern(bblock);
+  unsigned inst_id = intern(inst);
+  putByte(InstructionLine);
+  putSignedVarint(line_num);
+  putVarint(function_id);
+  putVarint(bblock_id);
+  putVarint(inst_id);
+  putByte((uint8_t)microop);
+  putSignedVarint(node_id - prev_node_id);
+  prev_node_id = node_id;
+  num_records++;
+  if (buffer.size() >= kWriteChunkSize)
+    flush();
+}
+
+void BinaryTraceWriter::writeOperand(unsigned size,
+                                     Value& value,
+                                     bool is_reg,
+                                     const std::string& label,
+                                     const std::string* prev_bblock) {
+  uint8_t flags = (uint8_t)value.getType() & kValueTypeMask;
+  if (is_reg)
+    flags |= kIsRegFlag;
+  if (prev_bblock)
+    flags |= kHasPrevBBlockFlag;
+  putByte(flags);
+  putVarint(size);
+  putVarint(intern(label));
+  if (prev_bblock)
+    putVarint(intern(*prev_bblock));
+
+  switch (value.getType()) {
+    case Value::Integer:
+      putSignedVarint((int64_t)value.getScalar());
+      break;
+    case Value::Ptr:
+      putVarint(value.getScalar());
+      break;
+    case Value::Float: {
+      // Store exactly as many bytes as the value has.
+      uint64_t bits = value.getScalar();
+      putBytes(&bits, value.getSize());
+      break;
+    }
+    case Value::Vector: {
+      uint8_t* bytes = value.getVector();
+      putBytes(bytes, value.getSize());
+      delete[] bytes;
+      break;
+    }
+    default:
+      assert(false && "Unknown value type!");
+  }
+}
+
+void BinaryTraceWriter::writeParameter(int param_tag,
+                                       unsigned size,
+                                       Value& value,
+                                       bool is_reg,
+                                       const std::string& label,
+                                       const std::string* prev_bblock) {
+  // The operand interns its strings before any of its bytes are written, so
+  // the string definitions must come before the record type.
+  intern(label);
+  if (prev_bblock)
+    intern(*prev_bblock);
+  putByte(ParameterLine);
+  putVarint(param_tag);
+  writeOperand(size, value, is_reg, label, prev_bblock);
+  num_records++;
+}
+
+void BinaryTraceWriter::writeResult(unsigned size,
+                                    Value& value,
+                                    bool is_reg,
+                                    const std::string& label) {
+  intern(label);
+  putByte(ResultLine);
+  writeOperand(size, value, is_reg, label, nullptr);
+  num_records++;
+}
+
+void BinaryTraceWriter::writeForward(unsigned size,
+                                     bool is_reg,
+                                     const std::string& label) {
+  unsigned label_id = intern(label);
+  putByte(ForwardLine);
+  putVarint(size);
+  putByte(is_reg ? kIsRegFlag : 0);
+  putVarint(label_id);
+  num_records++;
+}
+
+void BinaryTraceWriter::writeEndOfInvocation() {
+  putByte(EndOfInvocation);
+  num_records++;
+  flush();
+}
+
+//=---------------------------- BinaryTraceReader ----------------------------=//
+
+BinaryTraceReader::BinaryTraceReader(gzFile& _trace_file,
+                                     SourceManager& _srcManager)
+    : trace_file(_trace_file), srcManager(_srcManager), buf_pos(0),
+      buf_len(0), prev_node_id(-1) {
+  buffer.resize(kReadChunkSize);
+}
+
+bool BinaryTraceReader::isBinaryTrace(gzFile& trace_file) {
+  char magic[sizeof(kMagic)];
+  int bytes_read = gzread(trace_file, magic, sizeof(magic));
+  gzrewind(trace_file);
+  return bytes_read == sizeof(magic) &&
+         memcmp(magic, kMagic, sizeof(magic)) == 0;
+}
+
+bool BinaryTraceReader::refill() {
+  int bytes_read = gzread(trace_file, buffer.data(), buffer.size());
+  buf_pos = 0;
+  buf_len = bytes_read > 0 ? bytes_read : 0;
+  return buf_len > 0;
+}
+
+void BinaryTraceReader::readError(const char* what) {
+  std::cerr << "ERROR: Corrupted binary trace (" << what << ")." << std::endl;
+  exit(1);
+}
+
+uint64_t BinaryTraceReader::getVarint() {
+  uint64_t value = 0;
+  unsigned shift = 0;
+  uint8_t byte;
+  do {
+    if (!getByte(byte))
+      readError("truncated varint");
+    value |= (uint64_t)(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return value;
+}
+
+void BinaryTraceReader::getBytes(void* data, size_t len) {
+  uint8_t* dst = (uint8_t*)data;
+  while (len > 0) {
+    if (buf_pos == buf_len && !refill())
+      readError("truncated record");
+    size_t chunk = std::min(len, buf_len - buf_pos);
+    memcpy(dst, &buffer[buf_pos], chunk);
+    buf_pos += chunk;
+    dst += chunk;
+    len -= chunk;
+  }
+}
+
+bool BinaryTraceReader::readHeader() {
+  char magic[sizeof(kMagic)];
+  for (unsigned i = 0; i < sizeof(magic); i++) {
+    uint8_t byte;
+    if (!getByte(byte))
+      return false;
+    magic[i] = byte;
+  }
+  if (memcmp(magic, kMagic, sizeof(magic)) != 0)
+    return false;
+  unsigned version = getVarint();
+  if (version != kVersion) {
+    std::cerr << "ERROR: Unsupported binary trace version " << version
+              << " (expected " << kVersion << ")." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void BinaryTraceReader::readOperand(BinaryTraceRecord& record) {
+  uint8_t flags;
+  if (!getByte(flags))
+    readError("truncated operand");
+  record.value_type = (Value::Type)(flags & kValueTypeMask);
+  record.is_reg = flags & kIsRegFlag;
+  record.has_prev_bblock = flags & kHasPrevBBlockFlag;
+  record.size = getVarint();
+  record.label = getVarint();
+  if (record.has_prev_bblock)
+    record.prev_bblock = getVarint();
+
+  unsigned num_bytes = record.size / 8;
+  switch (record.value_type) {
+    case Value::Integer:
+      record.value_bits = (uint64_t)getSignedVarint();
+      break;
+    case Value::Ptr:
+      record.value_bits = getVarint();
+      break;
+    case Value::Float:
+      record.value_bits = 0;
+      getBytes(&record.value_bits, num_bytes);
+      break;
+    case Value::Vector:
+      record.vector_value.resize(num_bytes);
+      getBytes(record.vector_value.data(), num_bytes);
+      break;
+    default:
+      readError("unknown value type");
+  }
+}
+
+bool BinaryTraceReader::next(BinaryTraceRecord& record) {
+  uint8_t type;
+  while (getByte(type)) {
+    record.type = (RecordType)type;
+    switch (record.type) {
+      case StringDef: {
+        size_t len = getVarint();
+        strings.emplace_back(len, '\0');
+        getBytes(&strings.back()[0], len);
+        functions.push_back(nullptr);
+        instructions.push_back(nullptr);
+        labels.push_back(nullptr);
+        bblocks.push_back(std::make_pair(nullptr, 0));
+        continue;
+      }
+      case LabelMapEntry: {
+        record.function = getVarint();
+        record.label = getVarint();
+        record.line_num = getSignedVarint();
+        unsigned num_callers = getVarint();
+        record.callers.resize(num_callers);
+        for (unsigned i = 0; i < num_callers; i++)
+          record.callers[i] = getVarint();
+        return true;
+      }
+      case EntryDecl:
+        record.function = getVarint();
+        record.size = getVarint();
+        return true;
+      case InstructionLine:
+        record.line_num = getSignedVarint();
+        record.function = getVarint();
+        record.bblock = getVarint();
+        record.inst = getVarint();
+        if (!getByte(record.microop))
+          readError("truncated instruction");
+        record.node_id = prev_node_id + getSignedVarint();
+        prev_node_id = record.node_id;
+        return true;
+      case ParameterLine:
+        record.param_tag = getVarint();
+        readOperand(record);
+        return true;
+      case ResultLine:
+        readOperand(record);
+        return true;
+      case ForwardLine: {
+        record.size = getVarint();
+        uint8_t flags;
+        if (!getByte(flags))
+          readError("truncated forward");
+        record.is_reg = flags & kIsRegFlag;
+        record.label = getVarint();
+        return true;
+      }
+      case EndOfInvocation:
+        return true;
+      default:
+        readError("unknown record type");
+    }
+  }
+  record.type = EndOfTrace;
+  return false;
+}
+
+Function* BinaryTraceReader::getFunction(unsigned id) {
+  Function*& func = functions.at(id);
+  if (!func)
+    func = srcManager.insert<Function>(strings[id]);
+  return func;
+}
+
+Instruction* BinaryTraceReader::getInstruction(unsigned id) {
+  SrcTypes::Instruction*& inst = instructions.at(id);
+  if (!inst)
+    inst = srcManager.insert<SrcTypes::Instruction>(strings[id]);
+  return inst;
+}
+
+Label* BinaryTraceReader::getLabel(unsigned id) {
+  Label*& label = labels.at(id);
+  if (!label)
+    label = srcManager.insert<Label>(strings[id]);
+  return label;
+}
+
+BasicBlock* BinaryTraceReader::getBasicBlock(unsigned id,
+                                             unsigned* loop_depth) {
+  std::pair<BasicBlock*, unsigned>& entry = bblocks.at(id);
+  if (!entry.first) {
+    const std::string& bblockid = strings[id];
+    size_t colon = bblockid.find(':');
+    unsigned depth = 0;
+    if (colon != std::string::npos)
+      depth = strtoul(bblockid.c_str() + colon + 1, NULL, 10);
+    entry.first = srcManager.insert<BasicBlock>(bblockid.substr(0, colon));
+    entry.second = depth;
+  }
+  *loop_depth = entry.second;
+  return entry.first;
+}
+
+Value BinaryTraceReader::getValue(BinaryTraceRecord& record) {
+  if (record.value_type == Value::Vector) {
+    uint8_t* bytes = new uint8_t[record.vector_value.size()];
+    memcpy(bytes, record.vector_value.data(), record.vector_value.size());
+    return Value(record.size, bytes);
+  }
+  return Value(record.value_type, record.size, record.value_bits);
+}
@@ -0,0 +1,218 @@
+#ifndef __BINARY_TRACE_H__
+#define __BINARY_TRACE_H__
+
+/* A compact binary encoding of the LLVM-Tracer dynamic trace.
+ *
+ * Parsing the text trace is dominated by sscanf and by looking up the same
+ * function, basic block, instruction and register names over and over again.
+ * The binary format carries exactly the same information as a stream of typed
+ * records:
+ *
+ *  - All integers are LEB128 varints (signed ones are zigzag encoded), and the
+ *    dynamic node id of an instruction is stored as a delta from the previous
+ *    one, so a typical instruction record is only a handful of bytes.
+ *  - Every name is interned in a string table the first time it is used. The
+ *    definition is emitted inline as a StringDef record, and all subsequent
+ *    records refer to the name by its id. Ids are assigned sequentially in
+ *    order of definition.
+ *  - Operand values are stored with their type already resolved (integer,
+ *    float, pointer or vector), so the reader never has to inspect the value
+ *    string again.
+ *  - The end of each top level invocation is marked explicitly, exactly where
+ *    the text parser would stop reading.
+ *
+ * The file starts with the 8-byte magic string followed by the format version
+ * as a varint. It may be gzip compressed or stored uncompressed; both are read
+ * through zlib. Use trace_converter to produce a binary trace from a text one.
+ */
+
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "DDDG.h"
+#include "SourceManager.h"
+
+namespace BinaryTrace {
+
+const char kMagic[8] = { 'A', 'L', 'D', 'N', 'B', 'T', 'R', 'C' };
+const unsigned kVersion = 1;
+
+enum RecordType : uint8_t {
+  // Not stored in the trace; returned when there are no more records.
+  EndOfTrace = 0,
+  // Defines the next string id: varint length, followed by the bytes.
+  StringDef = 1,
+  // function, label, zigzag line number, varint num callers, caller ids.
+  LabelMapEntry = 2,
+  // function, varint number of parameters.
+  EntryDecl = 3,
+  // zigzag line number, function, basic block, instruction, microop byte,
+  // zigzag node id delta.
+  InstructionLine = 4,
+  // varint parameter tag, followed by an operand.
+  ParameterLine = 5,
+  // An operand.
+  ResultLine = 6,
+  // varint size, flags byte, label. The forwarded value is not stored.
+  ForwardLine = 7,
+  // End of a top level invocation.
+  EndOfInvocation = 8,
+};
+
+// Layout of the flags byte that starts every operand. An operand is encoded as
+// flags, varint size in bits, label, [prev basic block], value.
+const uint8_t kValueTypeMask = 0x3;
+const uint8_t kIsRegFlag = 0x4;
+const uint8_t kHasPrevBBlockFlag = 0x8;
+
+};  // namespace BinaryTrace
+
+// One decoded record. Names are left as string table ids; use the reader to
+// resolve them.
+struct BinaryTraceRecord {
+  BinaryTrace::RecordType type;
+
+  // Instruction, EntryDecl and LabelMapEntry records.
+  int line_num;
+  unsigned function;
+  unsigned bblock;
+  unsigned inst;
+  uint8_t microop;
+  long node_id;
+  std::vector<unsigned> callers;
+
+  // Parameter, Result and Forward records.
+  int param_tag;
+  unsigned size;
+  bool is_reg;
+  unsigned label;
+  bool has_prev_bblock;
+  unsigned prev_bblock;
+  Value::Type value_type;
+  uint64_t value_bits;
+  std::vector<uint8_t> vector_value;
+};
+
+// Encodes a binary trace. Used by the trace converter.
+class BinaryTraceWriter {
+ public:
+  BinaryTraceWriter(gzFile _trace_file);
+  ~BinaryTraceWriter();
+
+  void writeHeader();
+  void writeLabelMapEntry(const std::string& function,
+                          const std::string& label,
+                          int line_num,
+                          const std::vector<std::string>& callers);
+  void writeEntryDecl(const std::string& function, int num_parameters);
+  void writeInstruction(int line_num,
+                        const std::string& function,
+                        const std::string& bblock,
+                        const std::string& inst,
+                        int microop,
+                        long node_id);
+  // @prev_bblock is only stored for PHI parameters; pass nullptr otherwise.
+  void writeParameter(int param_tag,
+                      unsigned size,
+                      Value& value,
+                      bool is_reg,
+                      const std::string& label,
+                      const std::string* prev_bblock);
+  void writeResult(unsigned size,
+                   Value& value,
+                   bool is_reg,
+                   const std::string& label);
+  void writeForward(unsigned size, bool is_reg, const std::string& label);
+  void writeEndOfInvocation();
+
+  // Write out any buffered records.
+  void flush();
+
+  unsigned long getNumRecords() const { return num_records; }
+  unsigned long getNumStrings() const { return string_ids.size(); }
+
+ private:
+  unsigned intern(const std::string& str);
+  void writeOperand(unsigned size,
+                    Value& value,
+                    bool is_reg,
+                    const std::string& label,
+                    const std::string* prev_bblock);
+  void putByte(uint8_t byte) { buffer.push_back(byte); }
+  void putVarint(uint64_t value);
+  void putSignedVarint(int64_t value);
+  void putBytes(const void* data, size_t len);
+
+  gzFile trace_file;
+  std::vector<uint8_t> buffer;
+  std::unordered_map<std::string, unsigned> string_ids;
+  long prev_node_id;
+  unsigned long num_records;
+};
+
+// Decodes a binary trace.
+//
+// The string table and the resolved source entities live in the reader, so a
+// single reader must be used for all invocations in a trace. Names are only
+// looked up in the SourceManager the first time a string id is used as a
+// function, basic block, instruction, etc.
+class BinaryTraceReader {
+ public:
+  BinaryTraceReader(gzFile& _trace_file, SrcTypes::SourceManager& _srcManager);
+
+  // Returns true if @trace_file starts with the binary trace magic. The file
+  // is rewound to the beginning either way.
+  static bool isBinaryTrace(gzFile& trace_file);
+
+  // Read and validate the header. Returns false if this is not a binary trace
+  // or the version is not supported.
+  bool readHeader();
+
+  // Decode the next record into @record. String definitions are consumed
+  // transparently. Returns false at the end of the trace.
+  bool next(BinaryTraceRecord& record);
+
+  const std::string& getString(unsigned id) const { return strings.at(id); }
+  SrcTypes::Function* getFunction(unsigned id);
+  SrcTypes::Instruction* getInstruction(unsigned id);
+  SrcTypes::Label* getLabel(unsigned id);
+  // Basic block ids are stored as "name:loop_depth".
+  SrcTypes::BasicBlock* getBasicBlock(unsigned id, unsigned* loop_depth);
+  // Build a Value for the operand of @record.
+  Value getValue(BinaryTraceRecord& record);
+
+ private:
+  bool refill();
+  bool getByte(uint8_t& byte) {
+    if (buf_pos == buf_len && !refill())
+      return false;
+    byte = buffer[buf_pos++];
+    return true;
+  }
+  uint64_t getVarint();
+  int64_t getSignedVarint() {
+    uint64_t v = getVarint();
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+  }
+  void getBytes(void* data, size_t len);
+  void readOperand(BinaryTraceRecord& record);
+  void readError(const char* what);
+
+  gzFile& trace_file;
+  SrcTypes::SourceManager& srcManager;
+
+  std::vector<uint8_t> buffer;
+  size_t buf_pos;
+  size_t buf_len;
+  long prev_node_id;
+
+  std::vector<std::string> strings;
+  // Source entities resolved from the string table, indexed by string id.
+  std::vector<SrcTypes::Function*> functions;
+  std::vector<SrcTypes::Instruction*> instructions;
+  std::vector<SrcTypes::Label*> labels;
+  std::vector<std::pair<SrcTypes::BasicBlock*, unsigned>> bblocks;
+};
+
+#endif
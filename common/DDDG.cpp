@@ -1,30 +1,26 @@
+#include <algorithm>
 #include <cstring>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 
 #include <boost/tokenizer.hpp>
 
 #include "BaseDatapath.h"
+#include "BinaryTrace.h"
 #include "DDDG.h"
 #include "DynamicEntity.h"
 #include "ExecNode.h"
 #include "ProgressTracker.h"
 #include "SourceManager.h"
+#include "TraceReader.h"
 
 using namespace SrcTypes;
 
-static const char kHexTable[16] = {
-  '0', '1', '2', '3', '4', '5', '6', '7',
-  '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
-};
-
 static uint8_t nibbleVal(char nib) {
-  for (uint8_t i = 0; i < 16; i++) {
-    if (nib == kHexTable[i])
-      return i;
-  }
-  assert("Invalid character!\n");
-  return 0;
+  int val = TraceLineTokenizer::hex_digit(nib);
+  assert(val >= 0 && "Invalid character!");
+  return val;
 }
 
 uint8_t* hexStrToBytes(const char* str, unsigned size) {
@@ -81,9 +77,13 @@ char* bytesToHexStr(uint8_t* data, int size, bool separate32) {
 
 // TODO: Eventual goal is to remove datapath as an argument entirely and rely
 // only on Program.
-DDDG::DDDG(BaseDatapath* _datapath, Program* _program, gzFile& _trace_file)
+DDDG::DDDG(BaseDatapath* _datapath,
+           Program* _program,
+           gzFile& _trace_file,
+           TraceLineReader* _text_trace,
+           BinaryTraceReader* _binary_trace)
     : datapath(_datapath), program(_program), trace_file(_trace_file),
-      srcManager(_datapath->get_source_manager()) {
+      text_trace(_text_trace), binary_trace(_binary_trace), srcManager(_datapath->get_source_manager()) {
   num_of_reg_dep = 0;
   num_of_mem_dep = 0;
   num_of_ctrl_dep = 0;
@@ -95,7 +95,10 @@ DDDG::DDDG(BaseDatapath* _datapath, Program* _program, gzFile& _trace_file)
   curr_bblock = "-1";
   current_loop_depth = 0;
   callee_function = nullptr;
-  last_ret = nullptr;
+  curr_activation = nullptr;
+  curr_node = nullptr;
+  last_ret = -1;
+  num_of_streamed_edges = 0;
 }
 
 int DDDG::num_edges() {
@@ -107,29 +110,59 @@ int DDDG::num_of_register_dependency() { return num_of_reg_dep; }
 int DDDG::num_of_memory_dependency() { return num_of_mem_dep; }
 int DDDG::num_of_control_dependency() { return num_of_ctrl_dep; }
 
-void DDDG::output_dddg() {
-  for (auto it = register_edge_table.begin(); it != register_edge_table.end();
-       ++it) {
-    program->addEdge(it->first, it->second.sink_node, it->second.par_id);
-  }
+static bool edge_less(const dddg_edge_t& a, const dddg_edge_t& b) {
+  return a.source < b.source || (a.source == b.source && a.sink < b.sink);
+}
 
-  for (auto source_it = memory_edge_table.begin();
-       source_it != memory_edge_table.end();
-       ++source_it) {
-    unsigned source = source_it->first;
-    std::set<unsigned>& sink_list = source_it->second;
-    for (unsigned sink_node : sink_list)
-      program->addEdge(source, sink_node, MEMORY_EDGE);
-  }
+static bool edge_same_nodes(const dddg_edge_t& a, const dddg_edge_t& b) {
+  return a.source == b.source && a.sink == b.sink;
+}
+
+// Sort @edges by their nodes and keep the first edge between each pair of
+// nodes.
+static void sort_and_uniquify(std::vector<dddg_edge_t>& edges) {
+  std::stable_sort(edges.begin(), edges.end(), edge_less);
+  edges.erase(std::unique(edges.begin(), edges.end(), edge_same_nodes),
+              edges.end());
+}
+
+void DDDG::collect_edges(std::vector<dddg_edge_t>& edges) {
+  sort_and_uniquify(memory_edges);
+  num_of_mem_dep += memory_edges.size();
+  sort_and_uniquify(control_edges);
+  num_of_ctrl_dep += control_edges.size();
+
+  // The graph holds at most one edge between two nodes. Register edges take
+  // precedence over memory edges, and memory edges over control edges. When
+  // several operands of a node read the same register, the last one wins.
+  edges.clear();
+  edges.reserve(register_edges.size() + memory_edges.size() +
+                control_edges.size());
+  edges.insert(edges.end(), register_edges.rbegin(), register_edges.rend());
+  edges.insert(edges.end(), memory_edges.begin(), memory_edges.end());
+  edges.insert(edges.end(), control_edges.begin(), control_edges.end());
+  sort_and_uniquify(edges);
+  register_edges.clear();
+  memory_edges.clear();
+  control_edges.clear();
+}
+
+void DDDG::stream_node() {
+  collect_edges(streamed_edges);
+  num_of_streamed_edges += streamed_edges.size();
+  node_callback(curr_node, streamed_edges);
+}
 
-  for (auto source_it = control_edge_table.begin();
-       source_it != control_edge_table.end();
-       ++source_it) {
-    unsigned source = source_it->first;
-    std::set<unsigned>& sink_list = source_it->second;
-    for (unsigned sink_node : sink_list)
-      program->addEdge(source, sink_node, CONTROL_EDGE);
+void DDDG::output_dddg() {
+  if (node_callback) {
+    // Only the last node is left.
+    if (curr_node)
+      stream_node();
+    return;
   }
+  std::vector<dddg_edge_t> edges;
+  collect_edges(edges);
+  program->buildGraph(edges);
 }
 
 void DDDG::handle_ready_bit_dependency(Addr start_addr,
@@ -137,58 +170,31 @@ void DDDG::handle_ready_bit_dependency(Addr start_addr,
                                        unsigned sink_node) {
   std::set<unsigned> ready_bit_nodes;
   // Find the last node that updated the full/empty state for this address.
-  for (Addr addr = start_addr; addr < start_addr + size; addr++) {
-    auto it = ready_bits_last_changed.find(addr);
-    if (it != ready_bits_last_changed.end()) {
-      ready_bit_nodes.insert(it->second);
-      // This dependency only lasts until the next DMA operation that changes
-      // or depends on this ready bit.
-      ready_bits_last_changed.erase(it);
-    }
-  }
+  ready_bits_last_changed.for_each(
+      start_addr, start_addr + size, [&](Addr, Addr, unsigned node_id) {
+        ready_bit_nodes.insert(node_id);
+      });
+  // This dependency only lasts until the next DMA operation that changes or
+  // depends on this ready bit.
+  ready_bits_last_changed.erase(start_addr, start_addr + size);
   // Add the dependence.
-  for (unsigned source_inst : ready_bit_nodes) {
-    if (memory_edge_table.find(source_inst) == memory_edge_table.end())
-      memory_edge_table[source_inst] = std::set<unsigned>();
-    std::set<unsigned>& sink_list = memory_edge_table[source_inst];
-    auto result = sink_list.insert(sink_node);
-    if (result.second)
-      num_of_mem_dep++;
-  }
+  for (unsigned source_inst : ready_bit_nodes)
+    memory_edges.push_back({ source_inst, sink_node, (uint8_t)MEMORY_EDGE });
 }
 
 void DDDG::handle_post_write_dependency(Addr start_addr,
                                         size_t size,
                                         unsigned sink_node) {
-  Addr addr = start_addr;
-  while (addr < start_addr + size) {
-    // Get the last node to write to this address.
-    auto addr_it = address_last_written.find(addr);
-    if (addr_it != address_last_written.end()) {
-      unsigned source_inst = addr_it->second;
-
-      if (memory_edge_table.find(source_inst) == memory_edge_table.end())
-        memory_edge_table[source_inst] = std::set<unsigned>();
-      std::set<unsigned>& sink_list = memory_edge_table[source_inst];
-
-      // No need to check if the node already exists - if it does, an insertion
-      // will not happen, and insertion would require searching for the place
-      // to place the new entry anyways.
-      auto result = sink_list.insert(sink_node);
-      if (result.second)
-        num_of_mem_dep++;
-    }
-    addr++;
-  }
+  // Get the last nodes to write to this address range.
+  address_last_written.for_each(
+      start_addr, start_addr + size, [&](Addr, Addr, unsigned source_inst) {
+        memory_edges.push_back(
+            { source_inst, sink_node, (uint8_t)MEMORY_EDGE });
+      });
 }
 
 void DDDG::insert_control_dependence(unsigned source_node, unsigned dest_node) {
-  if (control_edge_table.find(source_node) == control_edge_table.end())
-    control_edge_table[source_node] = std::set<unsigned>();
-  std::set<unsigned>& dest_nodes = control_edge_table[source_node];
-  auto result = dest_nodes.insert(dest_node);
-  if (result.second)
-    num_of_ctrl_dep++;
+  control_edges.push_back({ source_node, dest_node, CONTROL_EDGE });
 }
 
 // Find the original array corresponding to this array in the current function.
@@ -211,14 +217,46 @@ Variable* DDDG::get_array_real_var(Variable* var) {
   return real_var;
 }
 
+void DDDG::push_activation(const DynamicFunction& func) {
+  if (callee_activation.function && callee_activation.function == func) {
+    active_method.push_back(std::move(callee_activation));
+    callee_activation = activation_t();
+  } else {
+    active_method.push_back({ func, {} });
+  }
+}
+
+unsigned DDDG::register_number(Function* func, Variable* var) {
+  if (func->get_index() >= register_numbers.size())
+    register_numbers.resize(func->get_index() + 1);
+  function_registers_t& registers = register_numbers[func->get_index()];
+  if (var->get_index() >= registers.numbers.size())
+    registers.numbers.resize(var->get_index() + 1, NO_REGISTER);
+  unsigned& number = registers.numbers[var->get_index()];
+  if (number == NO_REGISTER)
+    number = registers.count++;
+  return number;
+}
+
+unsigned& DDDG::last_writer(activation_t& activation, Variable* var) {
+  Function* func = activation.function.get_function();
+  unsigned number = register_number(func, var);
+  // Make room for all the registers the function has so far at once.
+  if (number >= activation.last_written.size()) {
+    activation.last_written.resize(register_numbers[func->get_index()].count,
+                                   NO_NODE);
+  }
+  return activation.last_written[number];
+}
+
 MemAccess* DDDG::create_mem_access(Value& value) {
   if (value.getType() == Value::Vector) {
-    VectorMemAccess* mem_access = new VectorMemAccess();
+    VectorMemAccess* mem_access = program->createVectorMemAccess();
     mem_access->set_value(value.getVector());
     mem_access->size = value.getSize();
     return mem_access;
   } else {
-    ScalarMemAccess* mem_access = new ScalarMemAccess();
+    ScalarMemAccess* mem_access = program->createScalarMemAccess();
     mem_access->set_value(value.getScalar());
     mem_access->is_float = value.getType() == Value::Float;
     mem_access->size = value.getSize();
@@ -240,62 +278,93 @@ void DDDG::parse_labelmap_line(const std::string& line) {
   function_name[255] = '\0';
   Function* function = srcManager.insert<Function>(function_name);
   Label* label = srcManager.insert<Label>(label_name);
-  UniqueLabel unique_label(function, label, line_number);
-  program->labelmap.insert(std::make_pair(line_number, unique_label));
+  std::vector<Function*> caller_funcs;
   if (num_matches == 4) {
     boost::char_separator<char> sep(" ");
     std::string temp(callers);
     boost::tokenizer<boost::char_separator<char>> tok(temp, sep);
-    for (auto it = tok.begin(); it != tok.end(); ++it) {
-      std::string caller_name = *it;
-      Function* caller_func = srcManager.insert<Function>(caller_name);
-      UniqueLabel inlined_label(caller_func, label, line_number);
-      program->labelmap.insert(std::make_pair(line_number, inlined_label));
-      // Add the inlined labels to another map so that we can associate any
-      // unrolling/pipelining directives declared on the original labels with
-      // them.
-      inline_labelmap[inlined_label] = unique_label;
-    }
+    for (auto it = tok.begin(); it != tok.end(); ++it)
+      caller_funcs.push_back(srcManager.insert<Function>(*it));
   }
+  handle_labelmap_entry(function, label, line_number, caller_funcs);
 }
 
-void DDDG::parse_instruction_line(const std::string& line) {
-  char curr_static_function[256];
-  char instid[256], bblockid[256], bblockname[256];
-  int line_num;
-  int microop;
-  sscanf(line.c_str(),
-         "%d,%[^,],%[^,],%[^,],%d,%lu\n",
-         &line_num,
-         curr_static_function,
-         bblockid,
-         instid,
-         &microop,
-         &current_node_id);
+void DDDG::handle_labelmap_entry(Function* function,
+                                 Label* label,
+                                 int line_number,
+                                 const std::vector<Function*>& callers) {
+  UniqueLabel unique_label(function, label, line_number);
+  program->labelmap.insert(std::make_pair(line_number, unique_label));
+  for (Function* caller_func : callers) {
+    UniqueLabel inlined_label(caller_func, label, line_number);
+    program->labelmap.insert(std::make_pair(line_number, inlined_label));
+    // Add the inlined labels to another map so that we can associate any
+    // unrolling/pipelining directives declared on the original labels with
+    // them.
+    inline_labelmap[inlined_label] = unique_label;
+  }
+}
+
+void DDDG::parse_instruction_line(TraceLineTokenizer& line) {
+  int line_num = line.next_int();
+  char* curr_static_function = line.next_field();
+  size_t bblockid_len;
+  char* bblockid = line.next_field(&bblockid_len);
+  char* instid = line.next_field();
+  int microop = line.next_int();
+  long node_id = line.next_int();
+
+  // Update the current loop depth.
+  unsigned loop_depth = current_loop_depth;
+  char* colon = (char*)memchr(bblockid, ':', bblockid_len);
+  size_t bblockname_len = colon ? colon - bblockid : bblockid_len;
+  if (colon)
+    loop_depth = TraceLineTokenizer::parse_int(colon + 1);
 
+  Function* curr_function =
+      srcManager.insert<Function>(curr_static_function);
+  Instruction* curr_inst = srcManager.insert<Instruction>(instid);
+  BasicBlock* basicblock = srcManager.insert<BasicBlock>(
+      std::string(bblockid, bblockname_len));
+  handle_instruction(line_num,
+                     curr_function,
+                     basicblock,
+                     bblockid,
+                     loop_depth,
+                     curr_inst,
+                     microop,
+                     node_id);
+}
+
+void DDDG::handle_instruction(int line_num,
+                              Function* curr_function,
+                              BasicBlock* basicblock,
+                              const std::string& bblockid,
+                              unsigned loop_depth,
+                              Instruction* curr_inst,
+                              int microop,
+                              long node_id) {
+  // All the edges of the previous node have been found.
+  if (node_callback && curr_node)
+    stream_node();
   num_of_instructions++;
+  current_node_id = node_id;
   prev_microop = curr_microop;
   curr_microop = (uint8_t)microop;
-  curr_instid = instid;
-
-  // Update the current loop depth.
-  sscanf(bblockid, "%[^:]:%u", bblockname, &current_loop_depth);
+  current_loop_depth = loop_depth;
   // If the loop depth is greater than 1000 within this function, we've
   // probably done something wrong.
   assert(current_loop_depth < 1000 &&
          "Loop depth is much higher than expected!");
 
-  Function* curr_function =
-      srcManager.insert<Function>(curr_static_function);
-  Instruction* curr_inst = srcManager.insert<Instruction>(curr_instid);
-  BasicBlock* basicblock = srcManager.insert<BasicBlock>(bblockname);
-  curr_node = program->insertNode(current_node_id, microop);
+  // The vertices are added along with the edges by output_dddg().
+  curr_node = program->insertNode(current_node_id, microop, false);
   curr_node->set_line_num(line_num);
   curr_node->set_static_inst(curr_inst);
   curr_node->set_static_function(curr_function);
   curr_node->set_basic_block(basicblock);
   curr_node->set_loop_depth(current_loop_depth);
-  datapath->addFunctionName(curr_static_function);
+  datapath->addFunctionName(curr_function->get_name());
 
   int func_invocation_count = 0;
   bool curr_func_found = false;
@@ -308,39 +377,43 @@ void DDDG::parse_instruction_line(const std::string& line) {
     for (auto node_id : nodes_since_last_ret)
       insert_control_dependence(node_id, current_node_id);
     nodes_since_last_ret.clear();
-    if (last_ret && last_ret != curr_node)
-      insert_control_dependence(last_ret->get_node_id(), current_node_id);
-    last_ret = curr_node;
+    if (last_ret != -1)
+      insert_control_dependence(last_ret, current_node_id);
+    last_ret = current_node_id;
   } else if (!curr_node->is_dma_op()) {
     nodes_since_last_ret.push_back(current_node_id);
   }
 
   if (!active_method.empty()) {
-    Function* prev_function = active_method.top().get_function();
+    Function* prev_function = active_method.back().function.get_function();
     unsigned prev_counts = prev_function->get_invocations();
     if (curr_function == prev_function) {
       // calling itself
       if (prev_microop == LLVM_IR_Call && callee_function == curr_function) {
         curr_function->increment_invocations();
         func_invocation_count = curr_function->get_invocations();
-        active_method.push(DynamicFunction(curr_function));
-        curr_dynamic_function = active_method.top();
+        push_activation(DynamicFunction(curr_function));
       } else {
         func_invocation_count = prev_counts;
-        curr_dynamic_function = active_method.top();
       }
       curr_func_found = true;
     }
-    if (microop == LLVM_IR_Ret)
-      active_method.pop();
+    if (microop == LLVM_IR_Ret) {
+      returned_activation = std::move(active_method.back());
+      active_method.pop_back();
+    }
   }
   if (!curr_func_found) {
     // This would only be true on a call.
     curr_function->increment_invocations();
     func_invocation_count = curr_function->get_invocations();
-    active_method.push(DynamicFunction(curr_function));
-    curr_dynamic_function = active_method.top();
+    push_activation(DynamicFunction(curr_function));
   }
+  if (curr_func_found && microop == LLVM_IR_Ret)
+    curr_activation = &returned_activation;
+  else
+    curr_activation = &active_method.back();
+  curr_dynamic_function = curr_activation->function;
   if (microop == LLVM_IR_PHI && prev_microop != LLVM_IR_PHI)
     prev_bblock = curr_bblock;
   if (microop == LLVM_IR_DMAFence) {
@@ -364,33 +437,29 @@ void DDDG::parse_instruction_line(const std::string& line) {
   func_caller_args.clear();
 }
 
-void DDDG::parse_parameter(const std::string& line, int param_tag) {
-  int size, is_reg;
-  char char_value[256];
-  char label[256], prev_bbid[256];
+void DDDG::parse_parameter(TraceLineTokenizer& line, int param_tag) {
+  int size = line.next_int();
+  char* char_value = line.next_field();
+  int is_reg = line.next_int();
+  char* label = line.next_field();
   if (curr_microop == LLVM_IR_PHI) {
-    sscanf(line.c_str(),
-           "%d,%[^,],%d,%[^,],%[^,],\n",
-           &size,
-           char_value,
-           &is_reg,
-           label,
-           prev_bbid);
+    char* prev_bbid = line.next_field();
     if (prev_bblock.compare(prev_bbid) != 0) {
       return;
     }
-  } else {
-    sscanf(line.c_str(),
-           "%d,%[^,],%d,%[^,],\n",
-           &size,
-           char_value,
-           &is_reg,
-           label);
   }
   Value value(char_value, size);
+  handle_parameter(param_tag, size, value, is_reg, label);
+}
+
+void DDDG::handle_parameter(int param_tag,
+                            unsigned size,
+                            Value& value,
+                            bool is_reg,
+                            const std::string& label) {
   if (curr_microop == LLVM_IR_EntryDecl) {
     if (value.getType() == Value::Ptr)
-      datapath->addEntryArrayDecl(std::string(label), value);
+      datapath->addEntryArrayDecl(label, value);
     return;
   }
   if (!last_parameter) {
@@ -400,14 +469,19 @@ void DDDG::parse_parameter(const std::string& line, int param_tag) {
     if (callee_function) {
       callee_dynamic_function = DynamicFunction(
           callee_function, callee_function->get_invocations() + 1);
+      if (!callee_activation.function ||
+          !(callee_activation.function == callee_dynamic_function)) {
+        callee_activation.function = callee_dynamic_function;
+        callee_activation.last_written.clear();
+      }
     }
   }
   last_parameter = true;
   if (is_reg) {
     Variable* variable = srcManager.insert<Variable>(label);
     DynamicVariable unique_reg_ref(curr_dynamic_function, variable);
-    auto reg_it = register_last_written.find(unique_reg_ref);
-    bool found_reg_entry = reg_it != register_last_written.end();
+    unsigned& reg_writer = last_writer(*curr_activation, variable);
+    bool found_reg_entry = reg_writer != NO_NODE;
     if (curr_microop == LLVM_IR_Call && param_tag != num_of_parameters) {
       // The first parameter on a call function block is the name of the
       // function itself, not an argument to the function.
@@ -416,19 +490,19 @@ void DDDG::parse_parameter(const std::string& line, int param_tag) {
       // argument.  The second element in the pair is the id of the last node
       // to write to this register, if such a node exists.
       func_caller_args.push_back(std::make_pair(
-          unique_reg_ref, found_reg_entry ? reg_it->second : current_node_id));
+          unique_reg_ref, found_reg_entry ? reg_writer : current_node_id));
     }
     // Find the instruction that writes the register
     if (found_reg_entry) {
       /*Find the last instruction that writes to the register*/
-      reg_edge_t tmp_edge = { (unsigned)current_node_id, param_tag };
-      register_edge_table.insert(std::make_pair(reg_it->second, tmp_edge));
+      register_edges.push_back({ reg_writer, (unsigned)current_node_id,
+                                 (uint8_t)param_tag });
       num_of_reg_dep++;
     } else if ((curr_microop == LLVM_IR_Store && param_tag == 2) ||
                (curr_microop == LLVM_IR_Load && param_tag == 1)) {
       /*For the load/store op without a gep instruction before, assuming the
        *load/store op performs a gep which writes to the label register*/
-      register_last_written[unique_reg_ref] = current_node_id;
+      reg_writer = current_node_id;
     }
   }
   if (curr_microop == LLVM_IR_Load || curr_microop == LLVM_IR_Store ||
@@ -457,21 +531,21 @@ void DDDG::parse_parameter(const std::string& line, int param_tag) {
       Addr mem_address = parameter_value_per_inst[0];
       unsigned mem_size = parameter_size_per_inst.back() / BYTE;
 
-      auto addr_it = address_last_written.find(mem_address);
-      if (addr_it != address_last_written.end()) {
+      const unsigned* last_writer = address_last_written.find(mem_address);
+      if (last_writer) {
         // Check if the last node to write was a DMA load. If so, we must obey
         // this memory ordering, because DMA loads are variable-latency
         // operations.
-        int last_node_to_write = addr_it->second;
-        if (program->nodes.at(last_node_to_write)->is_dma_load())
+        // A streamed node may have been retired already, in which case it
+        // has completed and needs no ordering.
+        ExecNode* writer = program->nodes.get(*last_writer);
+        if (writer && writer->is_dma_load())
           handle_post_write_dependency(
               mem_address, mem_size, current_node_id);
-        // Now we can overwrite the last written node id.
-        addr_it->second = current_node_id;
-      } else {
-        address_last_written.insert(
-            std::make_pair(mem_address, current_node_id));
       }
+      // Now we can overwrite the last written node id.
+      address_last_written.assign(
+          mem_address, mem_address + 1, current_node_id);
 
       // The label is the name of the register that holds the address.
       const std::string& reg_name = parameter_label_per_inst[0];
@@ -497,21 +571,24 @@ void DDDG::parse_parameter(const std::string& line, int param_tag) {
   }
 }
 
-void DDDG::parse_result(const std::string& line) {
-  int size, is_reg;
-  char char_value[256];
-  char label[256];
-
-  sscanf(line.c_str(), "%d,%[^,],%d,%[^,],\n", &size, char_value, &is_reg, label);
+void DDDG::parse_result(TraceLineTokenizer& line) {
+  int size = line.next_int();
+  char* char_value = line.next_field();
+  int is_reg = line.next_int();
+  char* label = line.next_field();
   Value value(char_value, size);
-  std::string label_str(label);
+  handle_result(size, value, is_reg, label);
+}
 
+void DDDG::handle_result(unsigned size,
+                         Value& value,
+                         bool is_reg,
+                         const std::string& label_str) {
   if (curr_node->is_fp_op() && (size == 64))
     curr_node->set_double_precision(true);
   assert(is_reg);
   Variable* var = srcManager.insert<Variable>(label_str);
-  DynamicVariable unique_reg_ref(curr_dynamic_function, var);
-  register_last_written[unique_reg_ref] = current_node_id;
+  last_writer(*curr_activation, var) = current_node_id;
 
   if (curr_microop == LLVM_IR_Alloca) {
     curr_node->set_variable(srcManager.get<Variable>(label_str));
@@ -570,7 +647,8 @@ void DDDG::parse_result(const std::string& line) {
 
     src_var = get_array_real_var(src_var);
     dst_var = get_array_real_var(dst_var);
-    mem_access = new DmaMemAccess(dst_addr, src_addr, size, src_var, dst_var);
+    mem_access = program->createDmaMemAccess(
+        dst_addr, src_addr, size, src_var, dst_var);
     curr_node->set_dma_mem_access(mem_access);
     if (curr_microop == LLVM_IR_DMALoad) {
       /* If we're using full/empty bits, then we want loads and stores to
@@ -581,15 +659,8 @@ void DDDG::parse_result(const std::string& line) {
       if (!datapath->isReadyMode()) {
         // For dmaLoad (which is a STORE from the accelerator's perspective),
         // enforce RAW and WAW dependencies on subsequent nodes.
-        for (Addr addr = dst_addr; addr < dst_addr + size; addr += 1) {
-          // TODO: Storing an entry for every byte in this range is very inefficient...
-          auto addr_it = address_last_written.find(addr);
-          if (addr_it != address_last_written.end())
-            addr_it->second = current_node_id;
-          else
-            address_last_written.insert(
-                std::make_pair(addr, current_node_id));
-        }
+        address_last_written.assign(
+            dst_addr, dst_addr + size, current_node_id);
       } else {
         // DMALoads also change ready bits.
         handle_ready_bit_dependency(dst_addr, size, current_node_id);
@@ -603,35 +674,37 @@ void DDDG::parse_result(const std::string& line) {
     Addr start_addr = parameter_value_per_inst[1];
     size_t size = parameter_value_per_inst[2];
     unsigned value = parameter_value_per_inst[3];
-    for (Addr addr = start_addr; addr < start_addr + size; addr++) {
-      // Changing ready bits can be viewed as a store; this means we can use
-      // the existing dependence infrastructure to handle the dependence
-      // between ready bit changes and loads and stores.
-      address_last_written[addr] = current_node_id;
-      ready_bits_last_changed[addr] = current_node_id;
-    }
+    // Changing ready bits can be viewed as a store; this means we can use the
+    // existing dependence infrastructure to handle the dependence between
+    // ready bit changes and loads and stores.
+    address_last_written.assign(start_addr, start_addr + size, current_node_id);
+    ready_bits_last_changed.assign(
+        start_addr, start_addr + size, current_node_id);
     Variable* var = srcManager.get<Variable>(parameter_label_per_inst[1]);
     var = get_array_real_var(var);
     ReadyBitAccess* access =
-        new ReadyBitAccess(start_addr, size, var, value);
+        program->createReadyBitAccess(start_addr, size, var, value);
     curr_node->set_mem_access(access);
   }
 }
 
-void DDDG::parse_forward(const std::string& line) {
-  int size, is_reg;
-  char label_buf[256];
+void DDDG::parse_forward(TraceLineTokenizer& line) {
+  line.skip_field();  // Size.
+  line.skip_field();  // Value.
+  int is_reg = line.next_int();
+  char* label = line.next_field();
+  handle_forward(is_reg, label);
+}
 
+void DDDG::handle_forward(bool is_reg, const std::string& label) {
   // DMA and trig operations are not actually treated as called functions by
   // Aladdin, so there is no need to add any register name mappings.
   if (curr_node->is_dma_op() || curr_node->is_trig_op())
     return;
-
-  sscanf(line.c_str(), "%d,%*[^,],%d,%[^,],\n", &size, &is_reg, label_buf);
   assert(is_reg);
 
   assert(curr_node->is_call_op());
-  Variable* var = srcManager.insert<Variable>(label_buf);
+  Variable* var = srcManager.insert<Variable>(label);
   DynamicVariable unique_reg_ref(callee_dynamic_function, var);
   // Create a mapping between registers in caller and callee functions.
   SrcTypes::DynamicVariable caller_arg;
@@ -642,152 +715,220 @@ void DDDG::parse_forward(const std::string& line) {
     func_caller_args.pop_front();
   }
   if (caller_arg) {
-    register_last_written[unique_reg_ref] = last_node_to_modify;
+    last_writer(callee_activation, var) = last_node_to_modify;
   } else {
-    register_last_written[unique_reg_ref] = current_node_id;
+    last_writer(callee_activation, var) = current_node_id;
   }
 }
 
-void DDDG::parse_entry_declaration(const std::string& line) {
+void DDDG::parse_entry_declaration(TraceLineTokenizer& line) {
+  line.skip_field();  // Function name.
+  int num_parameters = line.next_int();
+  handle_entry_declaration(num_parameters);
+}
+
+void DDDG::handle_entry_declaration(int num_parameters) {
   curr_microop = LLVM_IR_EntryDecl;
-  char curr_static_function[256];
-  num_of_parameters = 0;
-  sscanf(line.c_str(), "entry,%s,%d\n", curr_static_function, &num_of_parameters);
-}
-
-std::string DDDG::parse_function_name(const std::string& line) {
-  char curr_static_function[256];
-  char instid[256], bblockid[256];
-  int line_num;
-  int microop;
-  int dyn_inst_count;
-  sscanf(line.c_str(),
-         "%d,%[^,],%[^,],%[^,],%d,%d\n",
-         &line_num,
-         curr_static_function,
-         bblockid,
-         instid,
-         &microop,
-         &dyn_inst_count);
-  return curr_static_function;
-}
-
-bool DDDG::is_function_returned(const std::string& line, std::string target_function) {
-  char curr_static_function[256];
-  char instid[256], bblockid[256];
-  int line_num;
-  int microop;
-  int dyn_inst_count;
-  sscanf(line.c_str(),
-         "%d,%[^,],%[^,],%[^,],%d,%d\n",
-         &line_num,
-         curr_static_function,
-         bblockid,
-         instid,
-         &microop,
-         &dyn_inst_count);
-  if (microop == LLVM_IR_Ret &&
-      (!target_function.compare(curr_static_function)))
-    return true;
-  return false;
+  num_of_parameters = num_parameters;
 }
 
 size_t DDDG::build_initial_dddg(size_t trace_off, size_t trace_size) {
-
-  std::cout << "-------------------------------" << std::endl;
-  std::cout << "      Generating DDDG          " << std::endl;
-  std::cout << "-------------------------------" << std::endl;
+  std::ostream& console = datapath->console();
+  console << "-------------------------------" << std::endl;
+  console << "      Generating DDDG          " << std::endl;
+  console << "-------------------------------" << std::endl;
 
   long current_trace_off = trace_off;
   // Bigger traces would benefit from having a finer progress report.
   float increment = trace_size > 5e8 ? 0.01 : 0.05;
   // The total progress is the amount of the trace parsed.
-  ProgressTracker trace_progress(
-      "dddg_parse_progress.out", &current_trace_off, trace_size, increment);
+  ProgressTracker trace_progress(datapath->getProgressFileName(),
+                                 &current_trace_off,
+                                 trace_size,
+                                 increment);
   trace_progress.add_stat("nodes", &num_of_instructions);
   trace_progress.add_stat("bytes", &current_trace_off);
 
-  char buffer[256];
-  std::string first_function;
+  trace_progress.start_epoch();
+  bool seen_first_line =
+      binary_trace ? read_binary_trace(trace_progress, current_trace_off)
+                   : read_text_trace(trace_progress, current_trace_off);
+
+  if (seen_first_line) {
+    struct timeval edges_start, edges_end;
+    gettimeofday(&edges_start, NULL);
+    output_dddg();
+    gettimeofday(&edges_end, NULL);
+
+    console << "-------------------------------" << std::endl;
+    if (node_callback) {
+      console << "Num of Nodes: " << num_nodes() << std::endl;
+      console << "Num of Edges: " << num_of_streamed_edges << std::endl;
+    } else {
+      console << "Num of Nodes: " << program->getNumNodes() << std::endl;
+      console << "Num of Edges: " << program->getNumEdges() << std::endl;
+    }
+    console << "Num of Reg Edges: " << num_of_register_dependency()
+            << std::endl;
+    console << "Num of MEM Edges: " << num_of_memory_dependency()
+            << std::endl;
+    console << "Num of Control Edges: " << num_of_control_dependency()
+            << std::endl;
+    console << "Edge construction: "
+            << (edges_end.tv_sec - edges_start.tv_sec) +
+                   (edges_end.tv_usec - edges_start.tv_usec) * 1e-6
+            << " s" << std::endl;
+    if (text_trace)
+      text_trace->print_stats(console);
+    console << "-------------------------------" << std::endl;
+    return static_cast<size_t>(current_trace_off);
+  } else {
+    // The trace (or whatever was left) was empty.
+    console << "-------------------------------" << std::endl;
+    console << "Reached end of trace." << std::endl;
+    console << "-------------------------------" << std::endl;
+    return END_OF_TRACE;
+  }
+}
+
+bool DDDG::read_text_trace(ProgressTracker& trace_progress,
+                           long& current_trace_off) {
+  char* buffer;
+  size_t len;
+  Function* first_function = nullptr;
   bool seen_first_line = false;
   bool first_function_returned = false;
   bool in_labelmap_section = false;
   bool labelmap_parsed_or_not_present = false;
-  trace_progress.start_epoch();
-  while (trace_file && !gzeof(trace_file)) {
-    if (gzgets(trace_file, buffer, sizeof(buffer)) == NULL) {
-      continue;
-    }
-    current_trace_off = gzoffset(trace_file);
+  while ((buffer = text_trace->getline(&len)) != NULL) {
+    current_trace_off = text_trace->get_trace_offset();
     if (trace_progress.at_epoch_end()) {
       trace_progress.start_new_epoch();
     }
-    std::string wholeline(buffer);
 
     /* Scan for labelmap section if it has not yet been parsed. */
     if (!labelmap_parsed_or_not_present) {
       if (!in_labelmap_section) {
-        if (wholeline.find("%%%% LABEL MAP START %%%%") != std::string::npos) {
+        if (strstr(buffer, "%%%% LABEL MAP START %%%%") != NULL) {
           in_labelmap_section = true;
           continue;
         }
       } else {
-        if (wholeline.find("%%%% LABEL MAP END %%%%") != std::string::npos) {
+        if (strstr(buffer, "%%%% LABEL MAP END %%%%") != NULL) {
           labelmap_parsed_or_not_present = true;
           in_labelmap_section = false;
           continue;
         }
-        parse_labelmap_line(wholeline);
+        parse_labelmap_line(std::string(buffer, len));
       }
     }
-    size_t pos_end_tag = wholeline.find(",");
 
-    if (pos_end_tag == std::string::npos) {
+    if (memchr(buffer, ',', len) == NULL) {
       if (first_function_returned)
         break;
       continue;
     }
     // So that we skip that check if we don't have a labelmap.
     labelmap_parsed_or_not_present = true;
-    std::string tag = wholeline.substr(0, pos_end_tag);
-    std::string line_left = wholeline.substr(pos_end_tag + 1);
-    if (tag.compare("0") == 0) {
+    TraceLineTokenizer line(buffer, len);
+    const char* tag = line.next_field();
+    if (strcmp(tag, "0") == 0) {
+      parse_instruction_line(line);
+      Function* curr_function = curr_node->get_static_function();
       if (!seen_first_line) {
         seen_first_line = true;
-        first_function = parse_function_name(line_left);
+        first_function = curr_function;
       }
-      first_function_returned = is_function_returned(line_left, first_function);
-      parse_instruction_line(line_left);
-    } else if (tag.compare("r") == 0) {
-      parse_result(line_left);
-    } else if (tag.compare("f") == 0) {
-      parse_forward(line_left);
-    } else if (tag.compare("entry") == 0) {
-      parse_entry_declaration(line_left);
+      first_function_returned =
+          curr_microop == LLVM_IR_Ret && curr_function == first_function;
+    } else if (strcmp(tag, "r") == 0) {
+      parse_result(line);
+    } else if (strcmp(tag, "f") == 0) {
+      parse_forward(line);
+    } else if (strcmp(tag, "entry") == 0) {
+      parse_entry_declaration(line);
     } else {
-      parse_parameter(line_left, atoi(tag.c_str()));
+      parse_parameter(line, TraceLineTokenizer::parse_int(tag));
     }
   }
+  return seen_first_line;
+}
 
-  if (seen_first_line) {
-    output_dddg();
-
-    std::cout << "-------------------------------" << std::endl;
-    std::cout << "Num of Nodes: " << program->getNumNodes() << std::endl;
-    std::cout << "Num of Edges: " << program->getNumEdges() << std::endl;
-    std::cout << "Num of Reg Edges: " << num_of_register_dependency()
-              << std::endl;
-    std::cout << "Num of MEM Edges: " << num_of_memory_dependency()
-              << std::endl;
-    std::cout << "Num of Control Edges: " << num_of_control_dependency()
-              << std::endl;
-    std::cout << "-------------------------------" << std::endl;
-    return static_cast<size_t>(current_trace_off);
-  } else {
-    // The trace (or whatever was left) was empty.
-    std::cout << "-------------------------------" << std::endl;
-    std::cout << "Reached end of trace." << std::endl;
-    std::cout << "-------------------------------" << std::endl;
-    return END_OF_TRACE;
+bool DDDG::read_binary_trace(ProgressTracker& trace_progress,
+                             long& current_trace_off) {
+  BinaryTraceRecord record;
+  Function* first_function = nullptr;
+  std::vector<Function*> callers;
+  while (binary_trace->next(record)) {
+    if (record.type == BinaryTrace::EndOfInvocation) {
+      // An invocation without any instructions (e.g. only a labelmap) does
+      // not end the DDDG, just like blank lines in a text trace.
+      if (first_function)
+        break;
+      continue;
+    }
+    switch (record.type) {
+      case BinaryTrace::LabelMapEntry:
+        callers.clear();
+        for (unsigned caller : record.callers)
+          callers.push_back(binary_trace->getFunction(caller));
+        handle_labelmap_entry(binary_trace->getFunction(record.function),
+                              binary_trace->getLabel(record.label),
+                              record.line_num,
+                              callers);
+        break;
+      case BinaryTrace::EntryDecl:
+        handle_entry_declaration(record.size);
+        break;
+      case BinaryTrace::InstructionLine: {
+        unsigned loop_depth;
+        BasicBlock* basicblock =
+            binary_trace->getBasicBlock(record.bblock, &loop_depth);
+        Function* curr_function = binary_trace->getFunction(record.function);
+        if (!first_function)
+          first_function = curr_function;
+        handle_instruction(record.line_num,
+                           curr_function,
+                           basicblock,
+                           binary_trace->getString(record.bblock),
+                           loop_depth,
+                           binary_trace->getInstruction(record.inst),
+                           record.microop,
+                           record.node_id);
+        // Only check for progress once per instruction.
+        current_trace_off = gzoffset(trace_file);
+        if (trace_progress.at_epoch_end())
+          trace_progress.start_new_epoch();
+        break;
+      }
+      case BinaryTrace::ParameterLine: {
+        if (curr_microop == LLVM_IR_PHI &&
+            (!record.has_prev_bblock ||
+             prev_bblock != binary_trace->getString(record.prev_bblock)))
+          break;
+        Value value = binary_trace->getValue(record);
+        handle_parameter(record.param_tag,
+                         record.size,
+                         value,
+                         record.is_reg,
+                         binary_trace->getString(record.label));
+        break;
+      }
+      case BinaryTrace::ResultLine: {
+        Value value = binary_trace->getValue(record);
+        handle_result(record.size,
+                      value,
+                      record.is_reg,
+                      binary_trace->getString(record.label));
+        break;
+      }
+      case BinaryTrace::ForwardLine:
+        handle_forward(record.is_reg, binary_trace->getString(record.label));
+        break;
+      default:
+        break;
+    }
   }
+  current_trace_off = gzoffset(trace_file);
+  return first_function != nullptr;
 }
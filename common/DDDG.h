@@ -2,20 +2,23 @@
 #define __DDDG_H__
 
 #include <deque>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
-#include <stack>
 #include <string>
+#include <vector>
 #include <zlib.h>
 #include <stdlib.h>
 #include <sstream>
 
+#include "AddressIntervalMap.h"
 #include "ExecNode.h"
 #include "file_func.h"
 #include "Program.h"
 #include "opcode_func.h"
 #include "SourceManager.h"
+#include "TraceTokenizer.h"
 
 #define MEMORY_EDGE (-1)
 #define REGISTER_EDGE 5
@@ -23,19 +26,21 @@
 #define CONTROL_EDGE 11
 #define PIPE_EDGE 12
 
-struct reg_edge_t {
-  unsigned sink_node;
-  int par_id;
+// An edge found while parsing the trace, between two node ids.
+struct dddg_edge_t {
+  unsigned source;
+  unsigned sink;
+  uint8_t par_id;
 };
 
 // data structure used to track dependency
 typedef std::unordered_map<std::string, unsigned int> string_to_uint;
-typedef std::unordered_map<Addr, unsigned int> uint_to_uint;
-typedef std::unordered_multimap<unsigned int, reg_edge_t>
-    multi_uint_to_reg_edge;
-typedef std::map<unsigned int, std::set<unsigned int>> map_uint_to_set;
 
 class BaseDatapath;
+class BinaryTraceReader;
+class ProgressTracker;
+class TraceIndex;
+class TraceLineReader;
 
 class FP2BitsConverter {
   public:
@@ -138,36 +143,58 @@ char* bytesToHexStr(uint8_t* data, int size, bool separate32=false);
 // appropriate type and simplifies generic manipulation of the value.
 class Value {
  public:
+  // Supported value types.
+  enum Type {
+    Integer,
+    Float,
+    Vector,
+    Ptr,
+    NumValueTypes,
+  };
+
   Value(Value&& other)
       : vector_buf(std::move(other.vector_buf)), data(other.data),
         type(other.type), size(other.size) {}
 
   Value(char* value_buf, unsigned _size) : size(_size / 8), vector_buf() {
+    data.bits = 0;
     createValue(value_buf);
   }
 
+  // Construct a value whose type is already known, e.g. when reading a binary
+  // trace. As above, @_size is in bits.
+  Value(Type _type, unsigned _size, uint64_t bits)
+      : vector_buf(), type(_type), size(_size / 8) {
+    data.bits = bits;
+  }
+
+  // Construct a vector value that takes ownership of @vector_data.
+  Value(unsigned _size, uint8_t* vector_data)
+      : vector_buf(vector_data), type(Vector), size(_size / 8) {
+    data.bits = 0;
+  }
+
   ~Value() {}
 
   void createValue(char* value_buf) {
-    const std::string value_str(value_buf);
     if (size > 8) {
       type = Vector;
       vector_buf = std::unique_ptr<uint8_t>(hexStrToBytes(value_buf, size));
-    } else if (value_str.find('.') != std::string::npos) {
+    } else if (strchr(value_buf, '.')) {
       type = Float;
       if (size == 4) {
-        data.fp = (float)strtod(value_str.c_str(), NULL);
+        data.fp = (float)strtod(value_buf, NULL);
       } else if (size == 8) {
-        data.dp = strtod(value_str.c_str(), NULL);
+        data.dp = strtod(value_buf, NULL);
       } else {
         assert(false && "Floating point value must be 32-bit or 64-bit!");
       }
-    } else if (value_str.substr(0, 2) == "0x") {
+    } else if (strncmp(value_buf, "0x", 2) == 0) {
       type = Ptr;
-      data.ptr = (void*)strtol(value_str.c_str(), NULL, 16);
+      data.bits = TraceLineTokenizer::parse_hex(value_buf);
     } else {
       type = Integer;
-      data.integer = (long long)strtol(value_str.c_str(), NULL, 10);
+      data.integer = TraceLineTokenizer::parse_int(value_buf);
     }
   }
 
@@ -183,15 +210,6 @@ class Value {
     return data.ptr == ptr;
   }
 
-  // Supported value types.
-  enum Type {
-    Integer,
-    Float,
-    Vector,
-    Ptr,
-    NumValueTypes,
-  };
-
   // The only data accessors we want to expose are scalar or vector. Even if
   // the type is Ptr, as far as we are concerned, we just need the raw value of
   // the pointer. Only when the data is actually of type Vector do we return a
@@ -233,12 +251,42 @@ class Value {
   unsigned size;  // In bytes.
 };
 
+// Marks a register that has not been written, and a variable that has not
+// been given a register number.
+const unsigned NO_NODE = std::numeric_limits<unsigned>::max();
+const unsigned NO_REGISTER = std::numeric_limits<unsigned>::max();
+
+// A dynamic function invocation and the last node to write each of its
+// registers, indexed by register number.
+struct activation_t {
+  SrcTypes::DynamicFunction function;
+  std::vector<unsigned> last_written;
+};
+
+// The register numbers of the variables of a function, indexed by variable
+// index (NO_REGISTER if none was assigned yet), and the number of registers
+// assigned so far.
+struct function_registers_t {
+  std::vector<unsigned> numbers;
+  unsigned count = 0;
+};
+
 class DDDG {
  public:
   // Indicates that we have reached the end of the trace.
   static const size_t END_OF_TRACE = std::numeric_limits<size_t>::max();
 
-  DDDG(BaseDatapath* _datapath, Program* program, gzFile& _trace_file);
+  // Receives a node once it has been parsed, together with all of its
+  // incoming edges, sorted by source node. There is at most one edge from each
+  // source.
+  typedef std::function<void(ExecNode*, const std::vector<dddg_edge_t>&)>
+      NodeCallback;
+
+  DDDG(BaseDatapath* _datapath,
+       Program* program,
+       gzFile& _trace_file,
+       TraceLineReader* _text_trace,
+       BinaryTraceReader* _binary_trace = nullptr);
   int num_edges();
   int num_nodes();
   int num_of_register_dependency();
@@ -248,16 +296,54 @@ class DDDG {
   size_t build_initial_dddg(size_t trace_off, size_t trace_size);
   inline_labelmap_t get_inline_labelmap() { return inline_labelmap; }
 
+  /* Hand each node to @callback as soon as it has been parsed, instead of
+   * building the graph. The nodes are created without graph vertices, and the
+   * callback may free them with Program::freeNode() once it is done with
+   * them. Every edge ends at the node that was parsed last, so the edges of a
+   * node are complete when the next node starts.
+   */
+  void set_node_callback(NodeCallback callback) { node_callback = callback; }
+
  private:
-  void parse_instruction_line(const std::string& line);
-  void parse_parameter(const std::string& line, int param_tag);
-  void parse_result(const std::string& line);
-  void parse_forward(const std::string& line);
-  void parse_call_parameter(const std::string& line, int param_tag);
+  // Read one invocation from a text or binary trace. Both return whether any
+  // instruction was seen.
+  bool read_text_trace(ProgressTracker& trace_progress, long& current_trace_off);
+  bool read_binary_trace(ProgressTracker& trace_progress,
+                         long& current_trace_off);
+
+  // Text trace line parsers. These decode the fields following the tag of a
+  // line and pass them on to the corresponding handle_* function below.
+  void parse_instruction_line(TraceLineTokenizer& line);
+  void parse_parameter(TraceLineTokenizer& line, int param_tag);
+  void parse_result(TraceLineTokenizer& line);
+  void parse_forward(TraceLineTokenizer& line);
   void parse_labelmap_line(const std::string& line);
-  void parse_entry_declaration(const std::string& line);
-  std::string parse_function_name(const std::string& line);
-  bool is_function_returned(const std::string& line, std::string target_function);
+  void parse_entry_declaration(TraceLineTokenizer& line);
+
+  // Trace record handlers, shared by the text and binary trace readers.
+  void handle_labelmap_entry(SrcTypes::Function* function,
+                             SrcTypes::Label* label,
+                             int line_number,
+                             const std::vector<SrcTypes::Function*>& callers);
+  void handle_instruction(int line_num,
+                          SrcTypes::Function* curr_function,
+                          SrcTypes::BasicBlock* basicblock,
+                          const std::string& bblockid,
+                          unsigned loop_depth,
+                          SrcTypes::Instruction* curr_inst,
+                          int microop,
+                          long node_id);
+  void handle_parameter(int param_tag,
+                        unsigned size,
+                        Value& value,
+                        bool is_reg,
+                        const std::string& label);
+  void handle_result(unsigned size,
+                     Value& value,
+                     bool is_reg,
+                     const std::string& label);
+  void handle_forward(bool is_reg, const std::string& label);
+  void handle_entry_declaration(int num_parameters);
 
   MemAccess* create_mem_access(Value& value);
 
@@ -277,6 +363,20 @@ class DDDG {
   SrcTypes::Variable* get_array_real_var(const std::string& array_name);
   SrcTypes::Variable* get_array_real_var(SrcTypes::Variable* var);
 
+  // Move the edges found so far into @edges, keeping one edge between each
+  // pair of nodes, and count the memory and control dependences.
+  void collect_edges(std::vector<dddg_edge_t>& edges);
+  // Hand the current node and its edges to node_callback.
+  void stream_node();
+
+  // Make @func the innermost activation. If it is the callee of the last
+  // call, it takes over the registers written by the call arguments.
+  void push_activation(const SrcTypes::DynamicFunction& func);
+  // The number of @var among the registers of @func, assigned on first sight.
+  unsigned register_number(SrcTypes::Function* func, SrcTypes::Variable* var);
+  // The last node to write the register @var in @activation, or NO_NODE.
+  unsigned& last_writer(activation_t& activation, SrcTypes::Variable* var);
+
   SrcTypes::DynamicFunction curr_dynamic_function;
 
   uint8_t curr_microop;
@@ -293,7 +393,6 @@ class DDDG {
   // The loop depth of the basic block the current node belongs to.
   unsigned current_loop_depth;
 
-  std::string curr_instid;
   std::vector<Value> parameter_value_per_inst;
   std::vector<unsigned> parameter_size_per_inst;
   std::vector<std::string> parameter_label_per_inst;
@@ -311,28 +410,48 @@ class DDDG {
   Program* program;
   std::string trace_file_name;
   gzFile& trace_file;
-
-  // Register dependency tracking table.
-  multi_uint_to_reg_edge register_edge_table;
-  // Memory dependence tracking table.
-  map_uint_to_set memory_edge_table;
-  // Control edge tracking table.
-  map_uint_to_set control_edge_table;
+  // Line reader of a text trace, or nullptr for a binary trace.
+  TraceLineReader* text_trace;
+  // Decoder state of a binary trace, or nullptr for a text trace.
+  BinaryTraceReader* binary_trace;
+
+  // Dependences found so far, in the order they were found. The memory and
+  // control edges may contain duplicates, which are removed by
+  // collect_edges().
+  std::vector<dddg_edge_t> register_edges;
+  std::vector<dddg_edge_t> memory_edges;
+  std::vector<dddg_edge_t> control_edges;
   // Maps a label in an inlined function to the original function in which it
   // was written.
   inline_labelmap_t inline_labelmap;
 
-  // keep track of currently executed methods
-  std::stack<SrcTypes::DynamicFunction> active_method;
-  // manage methods
-  std::unordered_map<SrcTypes::DynamicVariable, unsigned> register_last_written;
-  uint_to_uint address_last_written;
-  uint_to_uint ready_bits_last_changed;
+  // keep track of currently executed methods, innermost last
+  std::vector<activation_t> active_method;
+  // The activation that returned last, whose registers are still read by the
+  // operands of its Ret instruction.
+  activation_t returned_activation;
+  // The activation of callee_dynamic_function, which receives the call
+  // arguments before the callee starts executing.
+  activation_t callee_activation;
+  // The activation of curr_dynamic_function.
+  activation_t* curr_activation;
+  // The register numbers of each function, indexed by function index.
+  std::vector<function_registers_t> register_numbers;
+  // The last node to write each address, and the last node to change the ready
+  // bit of each address.
+  AddressIntervalMap<unsigned> address_last_written;
+  AddressIntervalMap<unsigned> ready_bits_last_changed;
   // DMA nodes that have been seen since the last DMA fence.
   std::list<unsigned> last_dma_nodes;
   // All nodes seen since the last Ret instruction.
-  std::list<unsigned> nodes_since_last_ret;
-  ExecNode* last_ret;
+  std::vector<unsigned> nodes_since_last_ret;
+  // The last Call or Ret node, or -1.
+  long last_ret;
+  // Streaming mode: receives the nodes as they are parsed.
+  NodeCallback node_callback;
+  // The edges of the current node, reused across streamed nodes.
+  std::vector<dddg_edge_t> streamed_edges;
+  long num_of_streamed_edges;
   // This points to the SourceManager object inside a BaseDatapath object.
   SrcTypes::SourceManager& srcManager;
 };
@@ -2,6 +2,7 @@
 #define __NODE_H__
 
 #include <cstdint>
+#include <memory>
 #include <sstream>
 #include <string>
 
@@ -11,6 +12,9 @@
 #include "SourceManager.h"
 #include "DynamicEntity.h"
 
+class Partition;
+class Register;
+
 #define BYTE 8
 
 // TODO: Is this correct in 64-bit mode?
@@ -22,31 +26,48 @@
 #define ADDR_MASK 0xffffffff
 
 // Basic information about a memory access.
+//
+// Each access records its concrete type in @kind, so that it can be downcast
+// with a static_cast instead of a dynamic_cast. Accesses are owned by the
+// Program, which destroys them by their concrete type, so there are no
+// virtual functions.
 class MemAccess {
   public:
-    MemAccess() : vaddr(0), size(0) {}
-    MemAccess(Addr _vaddr, size_t _size) : vaddr(_vaddr), size(_size) {}
-    virtual ~MemAccess() {}
+    enum Kind {
+      Scalar,
+      Vector,
+      Dma,
+      ReadyBit,
+    };
+
+    MemAccess(Kind _kind) : vaddr(0), size(0), kind(_kind) {}
+    MemAccess(Kind _kind, Addr _vaddr, size_t _size)
+        : vaddr(_vaddr), size(_size), kind(_kind) {}
+
+    Kind get_kind() const { return kind; }
 
     // Obtain a pointer to the first byte of data.
-    virtual uint8_t* data() = 0;
+    uint8_t* data();
 
     // Address read from the trace.
     Addr vaddr;
     // Size of the memory access in bytes.
     size_t size;
+
+  protected:
+    const Kind kind;
 };
 
 // For a typical memory access with a value of 64 bits or less.
 class ScalarMemAccess : public MemAccess {
   public:
-    ScalarMemAccess() : MemAccess(), is_float(false) {}
+    ScalarMemAccess() : MemAccess(Scalar), is_float(false) {}
 
     void set_value(uint64_t _value) {
       memcpy(&value[0], &_value, 8);
     }
 
-    virtual uint8_t* data() { return &value[0]; }
+    uint8_t* data() { return &value[0]; }
 
     // Is this value a floating point value?
     bool is_float;
@@ -60,22 +81,18 @@ class ScalarMemAccess : public MemAccess {
 // A memory access of greater than 64 bits.
 class VectorMemAccess : public MemAccess {
   public:
-    VectorMemAccess() : MemAccess(), value(nullptr) {}
-    virtual ~VectorMemAccess() {
-      if (value)
-        delete value;
-    }
+    VectorMemAccess() : MemAccess(Vector) {}
 
+    // Take ownership of @_value, which was allocated with new[].
     void set_value(uint8_t* _value) {
-      value = _value;
+      value.reset(_value);
     }
 
-    virtual uint8_t* data() { return value; }
+    uint8_t* data() { return value.get(); }
 
   protected:
-    // A pointer to a dynamically allocated buffer. This mem access object is
-    // responsible for cleaning it up.
-    uint8_t* value;
+    // The bytes of the value, allocated by the trace parser.
+    std::unique_ptr<uint8_t[]> value;
 };
 
 class DmaMemAccess : public MemAccess {
@@ -84,17 +101,17 @@ class DmaMemAccess : public MemAccess {
 
   public:
    DmaMemAccess()
-       : MemAccess(), src_addr(0), src_var(nullptr), dst_var(nullptr) {}
+       : MemAccess(Dma), src_addr(0), src_var(nullptr), dst_var(nullptr) {}
 
    DmaMemAccess(Addr _dst_addr,
                 Addr _src_addr,
                 size_t _size,
                 Variable* _src_var,
                 Variable* _dst_var)
-       : MemAccess(_dst_addr, _size), src_addr(_src_addr), src_var(_src_var),
-         dst_var(_dst_var) {}
+       : MemAccess(Dma, _dst_addr, _size), src_addr(_src_addr),
+         src_var(_src_var), dst_var(_dst_var) {}
 
-   virtual uint8_t* data() {
+   uint8_t* data() {
      assert(false &&
             "DMA memory accesses do not store the data in the trace itself!");
      return nullptr;
@@ -112,11 +129,11 @@ class ReadyBitAccess : public MemAccess {
   typedef SrcTypes::Variable Variable;
 
  public:
-  ReadyBitAccess() : MemAccess(), value(0) {}
+  ReadyBitAccess() : MemAccess(ReadyBit), value(0) {}
   ReadyBitAccess(Addr addr, size_t size, Variable* _array, uint8_t _value)
-      : MemAccess(addr, size), array(_array), value(_value) {}
+      : MemAccess(ReadyBit, addr, size), array(_array), value(_value) {}
 
-  virtual uint8_t* data() { return &value; }
+  uint8_t* data() { return &value; }
 
   // The array for the ready bits.
   Variable* array;
@@ -124,6 +141,20 @@ class ReadyBitAccess : public MemAccess {
   uint8_t value;
 };
 
+inline uint8_t* MemAccess::data() {
+  switch (kind) {
+    case Scalar:
+      return static_cast<ScalarMemAccess*>(this)->data();
+    case Vector:
+      return static_cast<VectorMemAccess*>(this)->data();
+    case Dma:
+      return static_cast<DmaMemAccess*>(this)->data();
+    case ReadyBit:
+      return static_cast<ReadyBitAccess*>(this)->data();
+  }
+  return nullptr;
+}
+
 class ExecNode {
  protected:
    typedef SrcTypes::src_id_t src_id_t;
@@ -134,14 +165,11 @@ class ExecNode {
          line_num(-1), start_execution_cycle(-1), complete_execution_cycle(-1),
          num_parents(0), isolated(true), inductive(false),
          dynamic_mem_op(false), double_precision(false), array_label(""),
-         partition_index(0), time_before_execution(0.0), mem_access(nullptr),
-         static_inst(nullptr), static_function(nullptr), variable(nullptr),
-         vertex_assigned(false) {}
+         partition_index(0), mem_register(nullptr), mem_partition(nullptr),
+         mem_block_index(0), activity_array(-1), time_before_execution(0.0),
+         mem_access(nullptr), static_inst(nullptr), static_function(nullptr),
+         variable(nullptr), vertex_assigned(false) {}
 
-   ~ExecNode() {
-     if (mem_access)
-       delete mem_access;
-  }
   /* Compare two nodes based only on their node ids. */
   bool operator<(const ExecNode& other) const {
     return (node_id < other.get_node_id());
@@ -180,19 +208,24 @@ class ExecNode {
   bool has_vertex() const { return vertex_assigned; }
   const std::string& get_array_label() const { return array_label; }
   unsigned get_partition_index() const { return partition_index; }
+  Register* get_mem_register() const { return mem_register; }
+  Partition* get_mem_partition() const { return mem_partition; }
+  unsigned get_mem_block_index() const { return mem_block_index; }
+  int get_activity_array() const { return activity_array; }
   bool has_array_label() const { return (array_label.compare("") != 0); }
   MemAccess* get_mem_access() const { return mem_access; }
+  /* These return NULL if the node has no memory access of that kind. */
   ScalarMemAccess* get_scalar_mem_access() const {
-    return dynamic_cast<ScalarMemAccess*>(mem_access);
+    return get_mem_access_of_kind<ScalarMemAccess>(MemAccess::Scalar);
   }
   DmaMemAccess* get_dma_mem_access() const {
-    return dynamic_cast<DmaMemAccess*>(mem_access);
+    return get_mem_access_of_kind<DmaMemAccess>(MemAccess::Dma);
   }
   VectorMemAccess* get_vector_mem_access() const {
-    return dynamic_cast<VectorMemAccess*>(mem_access);
+    return get_mem_access_of_kind<VectorMemAccess>(MemAccess::Vector);
   }
   ReadyBitAccess* get_ready_bit_access() const {
-    return dynamic_cast<ReadyBitAccess*>(mem_access);
+    return get_mem_access_of_kind<ReadyBitAccess>(MemAccess::ReadyBit);
   }
   unsigned get_loop_depth() const { return loop_depth; }
   float get_time_before_execution() const { return time_before_execution; }
@@ -228,6 +261,12 @@ class ExecNode {
   }
   void set_array_label(std::string label) { array_label = label; }
   void set_partition_index(unsigned index) { partition_index = index; }
+  void set_mem_register(Register* reg) { mem_register = reg; }
+  void set_mem_partition(Partition* partition, unsigned block_index) {
+    mem_partition = partition;
+    mem_block_index = block_index;
+  }
+  void set_activity_array(int slot) { activity_array = slot; }
   void set_mem_access(MemAccess* mem_access) { this->mem_access = mem_access; }
   void set_dma_mem_access(DmaMemAccess* dma_mem_access) {
     mem_access = dma_mem_access;
@@ -690,13 +729,24 @@ class ExecNode {
   std::string array_label;
   /* Index of the partitioned scratchpad being accessed. */
   unsigned partition_index;
+  /* Where a memory operation is serviced, resolved before scheduling so that
+   * the scheduler never looks arrays up by name: the register of a completely
+   * partitioned array, or else the scratchpad partition and the block in it.
+   */
+  Register* mem_register;
+  Partition* mem_partition;
+  unsigned mem_block_index;
+  /* Slot of the accessed array in the per cycle activity, or -1 if the
+   * accesses of this node are not counted there. */
+  int activity_array;
   /* Elapsed time before this node executes. Can be a fraction of a cycle.
    * TODO: Maybe refactor this so it's only part of ScratchpadDatapath
    * specifically. Something like a member class that can be extended.
    */
   float time_before_execution;
   /* Stores information about a memory access. If the node is not a memory op,
-   * this is NULL.
+   * this is NULL. The node does not own the access: nodes created by a Program
+   * get theirs from the Program, which frees them together.
    */
   MemAccess* mem_access;
   /* Loop depth of the basic block this node belongs to. */
@@ -712,6 +762,13 @@ class ExecNode {
   SrcTypes::BasicBlock* basic_block;
 
  private:
+  template <typename T>
+  T* get_mem_access_of_kind(MemAccess::Kind kind) const {
+    if (mem_access && mem_access->get_kind() == kind)
+      return static_cast<T*>(mem_access);
+    return nullptr;
+  }
+
   /* True if the node has been assigned a vertex, false otherwise. */
   bool vertex_assigned;
 };
@@ -0,0 +1,200 @@
+#ifndef __EXEC_NODE_MAP_H__
+#define __EXEC_NODE_MAP_H__
+
+/* The set of nodes of a program, indexed by node id.
+ *
+ * The node ids of a DDDG are assigned in trace order, so they are nearly
+ * contiguous. Instead of a tree, the nodes are stored in a vector of slots
+ * indexed by node_id - base_id, which makes lookups O(1) and iteration a
+ * linear scan. A removed node leaves a tombstone (a null slot) behind, which
+ * iteration skips.
+ *
+ * The interface follows the subset of std::map<unsigned, ExecNode*> that the
+ * rest of Aladdin uses: iteration is in increasing node id order and yields
+ * (node id, node) pairs, and at() throws std::out_of_range for missing ids.
+ *
+ * Unlike std::map, insert() may move the slots and so invalidates every
+ * iterator. erase() invalidates none, not even one to the erased node, so
+ * nodes can be removed while iterating. The tombstones are only dropped by
+ * compact(), which invalidates every iterator.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+class ExecNode;
+
+class ExecNodeMap {
+ public:
+  typedef std::pair<unsigned, ExecNode*> value_type;
+
+  // Iterates over the live slots in increasing node id order.
+  class iterator {
+   public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef ExecNodeMap::value_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type* pointer;
+    typedef const value_type& reference;
+
+    iterator() : pos(nullptr), last(nullptr) {}
+
+    reference operator*() const { return *pos; }
+    pointer operator->() const { return pos; }
+
+    iterator& operator++() {
+      do {
+        ++pos;
+      } while (pos != last && pos->second == nullptr);
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator prev = *this;
+      ++*this;
+      return prev;
+    }
+    // While the map is not empty, the slot at first_slot is live, so this
+    // never runs past the start unless begin() itself is decremented.
+    iterator& operator--() {
+      do {
+        --pos;
+      } while (pos->second == nullptr);
+      return *this;
+    }
+    iterator operator--(int) {
+      iterator next = *this;
+      --*this;
+      return next;
+    }
+
+    bool operator==(const iterator& other) const { return pos == other.pos; }
+    bool operator!=(const iterator& other) const { return pos != other.pos; }
+
+   private:
+    friend class ExecNodeMap;
+    iterator(pointer _pos, pointer _last) : pos(_pos), last(_last) {}
+
+    pointer pos;
+    // One past the last slot.
+    pointer last;
+  };
+  typedef iterator const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef reverse_iterator const_reverse_iterator;
+
+  ExecNodeMap() : base_id(0), first_slot(0), num_nodes(0) {}
+
+  iterator begin() const { return make_iterator(first_slot); }
+  iterator end() const { return make_iterator(slots.size()); }
+  reverse_iterator rbegin() const { return reverse_iterator(end()); }
+  reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+  size_t size() const { return num_nodes; }
+  bool empty() const { return num_nodes == 0; }
+
+  // Return the node with id @node_id, or nullptr if there is none.
+  ExecNode* get(unsigned node_id) const {
+    if (node_id < base_id || node_id - base_id >= slots.size())
+      return nullptr;
+    return slots[node_id - base_id].second;
+  }
+
+  ExecNode* at(unsigned node_id) const {
+    ExecNode* node = get(node_id);
+    if (node == nullptr)
+      throw std::out_of_range("ExecNodeMap::at");
+    return node;
+  }
+
+  size_t count(unsigned node_id) const { return get(node_id) != nullptr; }
+
+  iterator find(unsigned node_id) const {
+    if (get(node_id) == nullptr)
+      return end();
+    return make_iterator(node_id - base_id);
+  }
+
+  // Add @node with id @node_id, which must not be in the map yet. This
+  // invalidates all iterators.
+  void insert(unsigned node_id, ExecNode* node) {
+    assert(node != nullptr && get(node_id) == nullptr);
+    if (num_nodes == 0) {
+      slots.clear();
+      base_id = node_id;
+      first_slot = 0;
+    } else if (node_id < base_id) {
+      // Nodes are almost always inserted in increasing id order, so this is
+      // rare enough that moving all the slots is fine.
+      unsigned shift = base_id - node_id;
+      slots.insert(slots.begin(), shift, value_type(0, nullptr));
+      base_id = node_id;
+      first_slot += shift;
+    }
+    size_t slot = node_id - base_id;
+    if (slot >= slots.size())
+      slots.resize(slot + 1, value_type(0, nullptr));
+    slots[slot] = value_type(node_id, node);
+    if (slot < first_slot)
+      first_slot = slot;
+    num_nodes++;
+  }
+
+  // Remove the node with id @node_id, leaving a tombstone in its slot. The
+  // node itself is not deleted, and no iterator is invalidated. Returns the
+  // number of nodes removed.
+  size_t erase(unsigned node_id) {
+    if (get(node_id) == nullptr)
+      return 0;
+    slots[node_id - base_id] = value_type(0, nullptr);
+    num_nodes--;
+    while (first_slot < slots.size() && slots[first_slot].second == nullptr)
+      first_slot++;
+    return 1;
+  }
+
+  // Drop the tombstones at either end once there are enough of them. Nodes
+  // removed in id order, as when they are retired while the trace is
+  // streamed, would otherwise leave the slots growing without bound. This
+  // invalidates all iterators.
+  void compact() {
+    if (num_nodes == 0) {
+      clear();
+      return;
+    }
+    while (slots.back().second == nullptr)
+      slots.pop_back();
+    if (first_slot >= kMinCompaction && first_slot * 2 >= slots.size()) {
+      slots.erase(slots.begin(), slots.begin() + first_slot);
+      base_id += first_slot;
+      first_slot = 0;
+    }
+  }
+
+  void clear() {
+    slots.clear();
+    base_id = 0;
+    first_slot = 0;
+    num_nodes = 0;
+  }
+
+ private:
+  // The number of leading tombstones worth dropping at once.
+  static const size_t kMinCompaction = 4096;
+
+  iterator make_iterator(size_t slot) const {
+    return iterator(slots.data() + slot, slots.data() + slots.size());
+  }
+
+  // Slot i holds the node with id base_id + i, or a null node.
+  std::vector<value_type> slots;
+  unsigned base_id;
+  // Slots before this one are all tombstones.
+  size_t first_slot;
+  size_t num_nodes;
+};
+
+#endif
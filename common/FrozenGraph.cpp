@@ -0,0 +1,52 @@
+#include "FrozenGraph.h"
+
+void FrozenGraph::build(const Graph& graph, const ExecNodeMap& nodes) {
+  unsigned num_vertices = boost::num_vertices(graph);
+  unsigned num_edges = boost::num_edges(graph);
+
+  vertex_nodes.assign(num_vertices, nullptr);
+  out_offsets.assign(num_vertices + 1, 0);
+  out_vertices.clear();
+  out_vertices.reserve(num_edges);
+  out_types.clear();
+  out_types.reserve(num_edges);
+  in_offsets.assign(num_vertices + 1, 0);
+
+  for (unsigned v = 0; v < num_vertices; v++) {
+    vertex_nodes[v] = nodes.at(get(boost::vertex_node_id, graph, v));
+    out_edge_iter out_i, out_end;
+    for (boost::tie(out_i, out_end) = out_edges(v, graph); out_i != out_end;
+         ++out_i) {
+      unsigned child = target(*out_i, graph);
+      out_vertices.push_back(child);
+      out_types.push_back(get(boost::edge_name, graph, *out_i));
+      in_offsets[child + 1]++;
+    }
+    out_offsets[v + 1] = out_vertices.size();
+  }
+
+  // Bucket the edges by target. Sources are visited in increasing order, so
+  // the in-edges of each vertex end up sorted by source.
+  for (unsigned v = 0; v < num_vertices; v++)
+    in_offsets[v + 1] += in_offsets[v];
+  in_vertices.resize(num_edges);
+  in_types.resize(num_edges);
+  std::vector<unsigned> next_in(in_offsets.begin(), in_offsets.end() - 1);
+  for (unsigned v = 0; v < num_vertices; v++) {
+    for (unsigned e = out_offsets[v]; e < out_offsets[v + 1]; e++) {
+      unsigned slot = next_in[out_vertices[e]]++;
+      in_vertices[slot] = v;
+      in_types[slot] = out_types[e];
+    }
+  }
+}
+
+void FrozenGraph::clear() {
+  vertex_nodes.clear();
+  out_offsets.clear();
+  out_vertices.clear();
+  out_types.clear();
+  in_offsets.clear();
+  in_vertices.clear();
+  in_types.clear();
+}
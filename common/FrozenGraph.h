@@ -0,0 +1,77 @@
+#ifndef __FROZEN_GRAPH_H__
+#define __FROZEN_GRAPH_H__
+
+/* A read-only copy of the DDDG in compressed sparse row (CSR) form.
+ *
+ * Once the graph optimizations are done, the graph is no longer modified, but
+ * scheduling still walks the edges of every node. The adjacency_list keeps
+ * the out-edges and in-edges of each vertex in a red-black tree, so every
+ * step of such a walk is a pointer chase. A FrozenGraph instead packs the
+ * edges of all vertices into flat arrays: the edges of vertex v are
+ * [offsets[v], offsets[v + 1]) in the vertex and type arrays. Edge types
+ * (the edge_name property) take one byte each.
+ *
+ * Out-edges are stored in the same order as in the adjacency_list, so
+ * scheduling visits children in the same order as before.
+ */
+
+#include <stdint.h>
+#include <vector>
+
+#include "ExecNodeMap.h"
+#include "typedefs.h"
+
+class FrozenGraph {
+ public:
+  // The edges of one vertex: the vertices at their other end and their types.
+  struct EdgeRange {
+    const unsigned* vertices;
+    const uint8_t* types;
+    unsigned size;
+  };
+
+  FrozenGraph() {}
+
+  // Take a snapshot of @graph, whose vertices correspond to @nodes.
+  void build(const Graph& graph, const ExecNodeMap& nodes);
+  void clear();
+
+  bool empty() const { return vertex_nodes.empty(); }
+  unsigned numVertices() const { return vertex_nodes.size(); }
+  unsigned numEdges() const { return out_vertices.size(); }
+
+  // The node of vertex @v.
+  ExecNode* node(unsigned v) const { return vertex_nodes[v]; }
+
+  unsigned outDegree(unsigned v) const {
+    return out_offsets[v + 1] - out_offsets[v];
+  }
+  unsigned inDegree(unsigned v) const {
+    return in_offsets[v + 1] - in_offsets[v];
+  }
+  unsigned degree(unsigned v) const { return inDegree(v) + outDegree(v); }
+
+  EdgeRange outEdges(unsigned v) const {
+    EdgeRange range = { out_vertices.data() + out_offsets[v],
+                        out_types.data() + out_offsets[v], outDegree(v) };
+    return range;
+  }
+  EdgeRange inEdges(unsigned v) const {
+    EdgeRange range = { in_vertices.data() + in_offsets[v],
+                        in_types.data() + in_offsets[v], inDegree(v) };
+    return range;
+  }
+
+ private:
+  std::vector<ExecNode*> vertex_nodes;
+
+  std::vector<unsigned> out_offsets;
+  std::vector<unsigned> out_vertices;
+  std::vector<uint8_t> out_types;
+
+  std::vector<unsigned> in_offsets;
+  std::vector<unsigned> in_vertices;
+  std::vector<uint8_t> in_types;
+};
+
+#endif
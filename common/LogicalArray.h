@@ -39,6 +39,9 @@ class LogicalArray {
   /* Find the data block index for address addr in partition part_index. */
   const std::string& getBaseName() { return base_name; }
   size_t getBlockIndex(unsigned part_index, Addr addr);
+  Partition* getPartition(unsigned part_index) {
+    return partitions[part_index];
+  }
   size_t getPartitionIndex(Addr addr);
 
   unsigned getTotalLoads();
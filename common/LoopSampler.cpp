@@ -0,0 +1,113 @@
+#include <cmath>
+#include <string>
+
+#include "LoopSampler.h"
+#include "Program.h"
+
+using namespace SrcTypes;
+
+// The two-sided 95% quantile of the normal distribution.
+static const double kConfidenceZ = 1.96;
+
+LoopSampler::LoopSampler(const Program& _program,
+                         Function* _function,
+                         Label* _label,
+                         unsigned _warmup,
+                         unsigned _window,
+                         unsigned _period)
+    : program(_program), function(_function), label(_label), warmup(_warmup),
+      window(_window), period(_period), header(nullptr), after_boundary(false),
+      in_loop(false), iteration(0), keeping(true), in_window(false),
+      num_iterations(0), skipped_iterations(0), skipped_nodes(0) {}
+
+bool LoopSampler::isBoundary(const ExecNode* node) {
+  if (node->get_static_function() != function || !node->is_branch_op() ||
+      node->is_call_op())
+    return false;
+  int line_num = node->get_line_num();
+  auto it = boundary_lines.find(line_num);
+  if (it != boundary_lines.end())
+    return it->second;
+  // As with the unrolling directive, the loop may also be identified by its
+  // line number instead of its label.
+  UniqueLabel node_label = program.getUniqueLabel(node);
+  bool on_label = (node_label && node_label.get_label() == label) ||
+                  label->get_name() == std::to_string(line_num);
+  boundary_lines[line_num] = on_label;
+  return on_label;
+}
+
+bool LoopSampler::keep(const ExecNode* node) {
+  if (after_boundary) {
+    after_boundary = false;
+    bool in_function = node->get_static_function() == function;
+    if (!header && in_function)
+      header = node->get_basic_block();
+    if (in_function && node->get_basic_block() == header) {
+      iteration = in_loop ? iteration + 1 : 0;
+      in_loop = true;
+      num_iterations++;
+      if (iteration < warmup) {
+        keeping = true;
+        in_window = false;
+      } else {
+        unsigned offset = (iteration - warmup) % period;
+        keeping = offset < window;
+        in_window = keeping;
+        if (offset == 0)
+          windows.push_back({ node->get_node_id(), node->get_node_id(), 0, 0 });
+        if (keeping) {
+          windows.back().iterations++;
+        } else {
+          windows.back().skipped++;
+          skipped_iterations++;
+        }
+      }
+    } else {
+      // The loop is done, and whatever follows it is always kept.
+      in_loop = false;
+      keeping = true;
+      in_window = false;
+    }
+  }
+  if (keeping && in_window)
+    windows.back().last_node = node->get_node_id();
+  if (!keeping)
+    skipped_nodes++;
+  if (isBoundary(node))
+    after_boundary = true;
+  return keeping;
+}
+
+LoopSampler::Estimate LoopSampler::extrapolate(
+    double measured, const std::vector<double>& per_window) const {
+  Estimate estimate = { measured, 0 };
+  if (skipped_iterations == 0)
+    return estimate;
+  // Each window is an estimate of the mean over the iterations it stands in
+  // for, so its error is scaled by the number of those iterations.
+  std::vector<double> rates;
+  double sum_rates = 0;
+  double sum_sq_skipped = 0;
+  for (size_t i = 0; i < windows.size(); i++) {
+    const Window& window = windows[i];
+    if (window.iterations == 0)
+      continue;
+    double rate = per_window[i] / window.iterations;
+    estimate.value += rate * window.skipped;
+    rates.push_back(rate);
+    sum_rates += rate;
+    sum_sq_skipped += (double)window.skipped * window.skipped;
+  }
+  if (rates.size() < 2) {
+    estimate.bound = -1;
+    return estimate;
+  }
+  double mean = sum_rates / rates.size();
+  double variance = 0;
+  for (double rate : rates)
+    variance += (rate - mean) * (rate - mean);
+  variance /= rates.size() - 1;
+  estimate.bound = kConfidenceZ * std::sqrt(variance * sum_sq_skipped);
+  return estimate;
+}
@@ -0,0 +1,105 @@
+#ifndef __LOOP_SAMPLER_H__
+#define __LOOP_SAMPLER_H__
+
+/* Chooses which iterations of a loop to simulate when a trace is sampled.
+ *
+ * With the sampling directive, only some iterations of one loop are built into
+ * the DDDG: the first few iterations of every execution of the loop, which warm
+ * it up, and then a window of consecutive iterations out of every period. The
+ * other iterations are dropped as they are parsed, so neither the graph
+ * optimizations nor the scheduler ever see them.
+ *
+ * Iterations are delimited the same way as the loop boundaries found by loop
+ * unrolling: by the branches on the line of the loop label. The block that the
+ * first such branch jumps to is the loop header. A branch that jumps back to
+ * the header starts the next iteration, and a branch that jumps anywhere else
+ * leaves the loop, so the code after the loop is always kept.
+ *
+ * Each window stands in for the iterations skipped after it. A quantity that
+ * adds up over the iterations, like cycles or energy, is extrapolated by
+ * scaling its amount in each window by the number of iterations the window
+ * stands in for. The spread of the per-iteration amounts across the windows
+ * gives a confidence bound on the estimate.
+ */
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "ExecNode.h"
+#include "SourceEntity.h"
+
+class Program;
+
+class LoopSampler {
+ public:
+  // A run of consecutive sampled iterations.
+  struct Window {
+    // The first and last node ids in the window.
+    unsigned first_node;
+    unsigned last_node;
+    unsigned iterations;
+    // The iterations skipped after the window.
+    unsigned skipped;
+  };
+
+  // An extrapolated quantity and the half-width of its 95% confidence
+  // interval, which is negative if there are too few windows to tell.
+  struct Estimate {
+    double value;
+    double bound;
+  };
+
+  LoopSampler(const Program& _program,
+              SrcTypes::Function* _function,
+              SrcTypes::Label* _label,
+              unsigned _warmup,
+              unsigned _window,
+              unsigned _period);
+
+  // Decide whether to keep @node, which is the next node in the trace.
+  bool keep(const ExecNode* node);
+
+  const std::vector<Window>& getWindows() const { return windows; }
+  uint64_t getIterations() const { return num_iterations; }
+  uint64_t getSkippedIterations() const { return skipped_iterations; }
+  uint64_t getSkippedNodes() const { return skipped_nodes; }
+
+  /* Extrapolate a quantity whose total over the simulated iterations is
+   * @measured, and whose amount in each window is @per_window.
+   */
+  Estimate extrapolate(double measured,
+                       const std::vector<double>& per_window) const;
+
+ private:
+  // Is @node a branch on the line of the loop label?
+  bool isBoundary(const ExecNode* node);
+
+  const Program& program;
+  SrcTypes::Function* function;
+  SrcTypes::Label* label;
+  const unsigned warmup;
+  const unsigned window;
+  const unsigned period;
+
+  // The block that starts each iteration, once it is known.
+  SrcTypes::BasicBlock* header;
+  // The last node was a loop boundary.
+  bool after_boundary;
+  // The loop is executing, and the current iteration is @iteration of it.
+  bool in_loop;
+  unsigned iteration;
+  // The current iteration is kept.
+  bool keeping;
+  // The current iteration belongs to the last window.
+  bool in_window;
+  // Whether each line of the function is on the loop label.
+  std::unordered_map<int, bool> boundary_lines;
+
+  std::vector<Window> windows;
+  uint64_t num_iterations;
+  uint64_t skipped_iterations;
+  uint64_t skipped_nodes;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "ParallelSimulator.h"
+#include "ScratchpadDatapath.h"
+
+ParallelSimulator::ParallelSimulator(ScratchpadDatapath* acc,
+                                     std::string bench,
+                                     std::string trace_file,
+                                     std::string config_file) {
+  workers.emplace_back(acc);
+  if (!acc->loadTraceIndex())
+    exit(1);
+  unsigned first_invocation;
+  acc->getSelectedInvocations(&first_invocation, &last_invocation);
+  next_invocation = first_invocation;
+  next_to_dump = first_invocation;
+
+  unsigned num_invocations = last_invocation - first_invocation + 1;
+  unsigned num_workers =
+      std::min(acc->getParallelInvocations(), num_invocations);
+  std::cout << "-------------------------------" << std::endl;
+  std::cout << " Simulating " << num_invocations << " invocations on "
+            << num_workers << " threads" << std::endl;
+  std::cout << "-------------------------------" << std::endl;
+  // The index was saved by the first worker, so the others only load it.
+  for (unsigned i = 1; i < num_workers; i++) {
+    workers.emplace_back(
+        new ScratchpadDatapath(bench, trace_file, config_file));
+    if (!workers.back()->loadTraceIndex())
+      exit(1);
+  }
+  // The workers' messages are printed along with their stats.
+  for (auto& worker : workers)
+    worker->bufferConsole();
+}
+
+ParallelSimulator::~ParallelSimulator() {}
+
+#ifdef USE_DB
+void ParallelSimulator::setExperimentParameters(std::string experiment_name) {
+  for (auto& acc : workers)
+    acc->setExperimentParameters(experiment_name);
+}
+#endif
+
+void ParallelSimulator::run() {
+  std::vector<std::thread> threads;
+  for (auto& acc : workers)
+    threads.emplace_back(&ParallelSimulator::simulate, this, acc.get());
+  for (auto& thread : threads)
+    thread.join();
+}
+
+void ParallelSimulator::simulate(ScratchpadDatapath* acc) {
+  while (true) {
+    unsigned invocation = next_invocation++;
+    if (invocation > last_invocation)
+      return;
+
+    std::ostringstream progress_file;
+    progress_file << "dddg_parse_progress." << invocation << ".out";
+    acc->setProgressFileName(progress_file.str());
+    if (!acc->selectInvocations(invocation, invocation)) {
+      acc->flushConsole();
+      exit(1);
+    }
+    bool dddg_built = acc->buildDddg();
+    if (dddg_built) {
+      acc->globalOptimizationPass();
+      acc->prepareForScheduling();
+      while (!acc->step()) {
+      }
+      acc->computeStats();
+    }
+
+    // Invocations are picked up in order, so the one whose turn it is to be
+    // written is never waiting here.
+    std::unique_lock<std::mutex> guard(dump_lock);
+    dump_turn.wait(guard, [&] { return next_to_dump == invocation; });
+    if (dddg_built)
+      acc->writeStats();
+    acc->flushConsole();
+    next_to_dump++;
+    guard.unlock();
+    dump_turn.notify_all();
+
+    if (dddg_built) {
+      acc->clearDatapath();
+      // Each worker only simulates some of the invocations, so the memory
+      // stats of each invocation only count its own accesses.
+      acc->getScratchpad()->resetStats();
+    }
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef __PARALLEL_SIMULATOR_H__
+#define __PARALLEL_SIMULATOR_H__
+
+/* Simulates the top-level invocations of a trace concurrently.
+ *
+ * Invocations of the accelerated function only share the configuration and
+ * the source tables, so each worker thread simulates whole invocations with a
+ * datapath of its own: its own Program, SourceManager and scheduler state.
+ * Workers jump to their next invocation with the trace index and take
+ * invocations in increasing order.
+ *
+ * Building, optimizing, scheduling and computing the stats run concurrently.
+ * Stats are written one invocation at a time and in trace order, along with
+ * the console output of the worker, which is held back until then. The
+ * progress of building each DDDG goes to dddg_parse_progress.<invocation>.out.
+ *
+ * The summary and stats files are the same as those of a serial run, except
+ * for the memory power: a serial run accumulates the memory accesses of all
+ * the invocations, while here each invocation only counts its own.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ScratchpadDatapath;
+
+class ParallelSimulator {
+ public:
+  /* Simulate the invocations with @acc and getParallelInvocations() - 1
+   * more datapaths, built from the same arguments. Takes ownership of @acc.
+   */
+  ParallelSimulator(ScratchpadDatapath* acc,
+                    std::string bench,
+                    std::string trace_file,
+                    std::string config_file);
+  ~ParallelSimulator();
+
+#ifdef USE_DB
+  void setExperimentParameters(std::string experiment_name);
+#endif
+
+  // Simulate all the selected invocations and dump their stats.
+  void run();
+
+ private:
+  // Simulate invocations until there are none left.
+  void simulate(ScratchpadDatapath* acc);
+
+  std::vector<std::unique_ptr<ScratchpadDatapath>> workers;
+  // The last invocation to simulate.
+  unsigned last_invocation;
+
+  // The next invocation to be picked up by a worker.
+  std::atomic<unsigned> next_invocation;
+
+  std::mutex dump_lock;
+  // The invocation whose stats are written next.
+  unsigned next_to_dump;
+  std::condition_variable dump_turn;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include <cassert>
+#include <sys/time.h>
+
+#include "PassManager.h"
+
+void PassManager::addPass(const std::string& name,
+                          const std::vector<std::string>& prerequisites,
+                          const std::vector<std::string>& config_keys,
+                          std::function<void()> run) {
+  assert(!isRegistered(name) && "Pass registered twice!");
+  for (auto& prerequisite : prerequisites) {
+    if (!isRegistered(prerequisite)) {
+      std::cerr << "ERROR: Pass " << name << " must be registered after "
+                << prerequisite << std::endl;
+      exit(1);
+    }
+  }
+  passes.push_back({ name, config_keys, run });
+}
+
+bool PassManager::isRegistered(const std::string& name) const {
+  for (auto& pass : passes) {
+    if (pass.name == name)
+      return true;
+  }
+  return false;
+}
+
+void PassManager::run() {
+  profile.clear();
+  for (auto& pass : passes) {
+    PassProfile pass_profile = { pass.name, false, 0, GraphEditCounts() };
+    if (!pass.config_keys.empty()) {
+      pass_profile.skipped = true;
+      for (auto& key : pass.config_keys) {
+        if (config_is_set(key))
+          pass_profile.skipped = false;
+      }
+    }
+    if (!pass_profile.skipped) {
+      GraphEditCounts edits_before = program.edit_counts;
+      struct timeval start, end;
+      gettimeofday(&start, NULL);
+      pass.run();
+      gettimeofday(&end, NULL);
+      pass_profile.seconds =
+          (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 1e-6;
+      pass_profile.edits = program.edit_counts - edits_before;
+    }
+    profile.push_back(pass_profile);
+  }
+}
+
+void PassManager::writeProfile(std::ostream& out, bool header) const {
+  if (header)
+    out << "pass,skipped,seconds,nodes_removed,edges_added,edges_removed\n";
+  for (auto& pass : profile) {
+    out << pass.name << "," << pass.skipped << "," << pass.seconds << ","
+        << pass.edits.nodes_removed << "," << pass.edits.edges_added << ","
+        << pass.edits.edges_removed << "\n";
+  }
+}
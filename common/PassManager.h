@@ -0,0 +1,72 @@
+#ifndef __PASS_MANAGER_H__
+#define __PASS_MANAGER_H__
+
+/* Runs the graph optimization passes of a datapath and profiles them.
+ *
+ * Each pass is registered with the passes that must run before it and the
+ * configuration keys it reads. The ordering rules are checked when a pass is
+ * registered, so the passes run in registration order. A pass that reads
+ * configuration keys is skipped when none of them is set.
+ *
+ * For every pass that runs, the wall time and the graph edits it made (nodes
+ * disconnected, edges added and removed) are recorded, and can be written out
+ * as CSV with writeProfile().
+ */
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Program.h"
+
+class PassManager {
+ public:
+  // Returns true if the configuration key @key is set.
+  typedef std::function<bool(const std::string&)> ConfigQuery;
+
+  struct PassProfile {
+    std::string name;
+    bool skipped;
+    double seconds;
+    GraphEditCounts edits;
+  };
+
+  PassManager(Program& _program, ConfigQuery _config_is_set)
+      : program(_program), config_is_set(_config_is_set) {}
+
+  /* Register the pass @name, which runs @run. All the passes in
+   * @prerequisites must have been registered already. If @config_keys is not
+   * empty and none of the keys is set, the pass is skipped.
+   */
+  void addPass(const std::string& name,
+               const std::vector<std::string>& prerequisites,
+               const std::vector<std::string>& config_keys,
+               std::function<void()> run);
+
+  // Run all the passes in order, replacing the previous profile.
+  void run();
+
+  const std::vector<PassProfile>& getProfile() const { return profile; }
+
+  /* Write the profile of the last run as CSV, one line per pass, preceded by
+   * a header if @header is true.
+   */
+  void writeProfile(std::ostream& out, bool header) const;
+
+ private:
+  struct Pass {
+    std::string name;
+    std::vector<std::string> config_keys;
+    std::function<void()> run;
+  };
+
+  bool isRegistered(const std::string& name) const;
+
+  Program& program;
+  ConfigQuery config_is_set;
+  std::vector<Pass> passes;
+  std::vector<PassProfile> profile;
+};
+
+#endif
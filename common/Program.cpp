@@ -1,36 +1,190 @@
 #include "Program.h"
 
 #include "DDDG.h"
+#include "SourceManager.h"
 #include "SourceEntity.h"
 
 using namespace SrcTypes;
 
 void Program::addEdge(unsigned int from, unsigned int to, uint8_t parid) {
   if (from != to) {
-    add_edge(nodes.at(from)->get_vertex(), nodes.at(to)->get_vertex(),
-             EdgeProperty(parid), graph);
+    Vertex from_vertex = nodes.at(from)->get_vertex();
+    Vertex to_vertex = nodes.at(to)->get_vertex();
+    add_edge(from_vertex, to_vertex, EdgeProperty(parid), graph);
+    topo_order.addEdge(from_vertex, to_vertex);
   }
 }
 
-ExecNode* Program::insertNode(unsigned node_id, uint8_t microop) {
-  nodes[node_id] = new ExecNode(node_id, microop);
-  Vertex v = add_vertex(VertexProperty(node_id), graph);
-  nodes.at(node_id)->set_vertex(v);
-  assert(get(boost::vertex_node_id, graph, v) == node_id);
-  return nodes.at(node_id);
+void Program::buildGraph(const std::vector<dddg_edge_t>& edges) {
+  assert(boost::num_vertices(graph) == 0);
+  Vertex num_vertices = 0;
+  for (auto node_it = nodes.begin(); node_it != nodes.end(); ++node_it) {
+    assert(!node_it->second->has_vertex());
+    node_it->second->set_vertex(num_vertices);
+    topo_order.addVertex(num_vertices++);
+  }
+
+  std::vector<std::pair<Vertex, Vertex>> vertex_edges;
+  std::vector<EdgeProperty> edge_props;
+  vertex_edges.reserve(edges.size());
+  edge_props.reserve(edges.size());
+  for (const dddg_edge_t& edge : edges) {
+    if (edge.source == edge.sink)
+      continue;
+    Vertex from = nodes.at(edge.source)->get_vertex();
+    Vertex to = nodes.at(edge.sink)->get_vertex();
+    vertex_edges.emplace_back(from, to);
+    edge_props.emplace_back(edge.par_id);
+    topo_order.addEdge(from, to);
+  }
+
+  Graph bulk(vertex_edges.begin(), vertex_edges.end(), edge_props.begin(),
+             num_vertices, vertex_edges.size());
+  for (auto node_it = nodes.begin(); node_it != nodes.end(); ++node_it)
+    put(boost::vertex_node_id, bulk, node_it->second->get_vertex(),
+        node_it->first);
+  graph.swap(bulk);
+}
+
+void Program::compactGraph() {
+  if (dead_vertices.empty())
+    return;
+  // Rebuild the graph from its live edges, in the same order.
+  size_t num_live_edges = getNumEdges();
+  std::vector<std::pair<Vertex, Vertex>> vertex_edges;
+  std::vector<EdgeProperty> edge_props;
+  vertex_edges.reserve(num_live_edges);
+  edge_props.reserve(num_live_edges);
+  EdgeNameMap edge_to_parid = get(boost::edge_name, graph);
+  BGL_FORALL_EDGES(e, live_graph, LiveGraph) {
+    vertex_edges.emplace_back(source(e, graph), target(e, graph));
+    edge_props.emplace_back(edge_to_parid[e]);
+  }
+
+  Vertex num_vertices = boost::num_vertices(graph);
+  Graph compacted(vertex_edges.begin(), vertex_edges.end(), edge_props.begin(),
+                  num_vertices, vertex_edges.size());
+  for (Vertex v = 0; v < num_vertices; v++)
+    put(boost::vertex_node_id, compacted, v,
+        get(boost::vertex_node_id, graph, v));
+  graph.swap(compacted);
+  dead_vertices.clear();
+  createVertexMap();
+}
+
+ExecNode* Program::insertNode(unsigned node_id,
+                              uint8_t microop,
+                              bool in_graph) {
+  ExecNode* node = node_arena.create(node_id, microop);
+  nodes.insert(node_id, node);
+  if (in_graph)
+    addToGraph(node);
+  return node;
+}
+
+void Program::addToGraph(ExecNode* node) {
+  assert(!node->has_vertex());
+  Vertex v = add_vertex(VertexProperty(node->get_node_id()), graph);
+  node->set_vertex(v);
+  topo_order.addVertex(v);
+}
+
+void Program::freeNode(ExecNode* node) {
+  assert(!node->has_vertex());
+  nodes.erase(node->get_node_id());
+  MemAccess* mem_access = node->get_mem_access();
+  if (mem_access) {
+    switch (mem_access->get_kind()) {
+      case MemAccess::Scalar:
+        scalar_accesses.destroy(static_cast<ScalarMemAccess*>(mem_access));
+        break;
+      case MemAccess::Vector:
+        vector_accesses.destroy(static_cast<VectorMemAccess*>(mem_access));
+        break;
+      case MemAccess::Dma:
+        dma_accesses.destroy(static_cast<DmaMemAccess*>(mem_access));
+        break;
+      case MemAccess::ReadyBit:
+        ready_bit_accesses.destroy(static_cast<ReadyBitAccess*>(mem_access));
+        break;
+    }
+  }
+  node_arena.destroy(node);
 }
 
 void Program::clearExecNodes() {
-  for (auto& node_pair : nodes)
-    delete node_pair.second;
   nodes.clear();
+  node_arena.clear();
+  scalar_accesses.clear();
+  vector_accesses.clear();
+  dma_accesses.clear();
+  ready_bit_accesses.clear();
 }
 
 void Program::clear() {
   clearExecNodes();
   graph.clear();
+  dead_vertices.clear();
+  frozen_graph.clear();
+  edit_counts = GraphEditCounts();
+  topo_order.clear();
   call_arg_map.clear();
   loop_bounds.clear();
+  loop_configs.clear();
+}
+
+template <typename G> void TopologicalOrder::sort(const G& graph) {
+  if (!valid) {
+    order.clear();
+    // topological_sort() returns the vertices bottom nodes first.
+    boost::topological_sort(graph, std::back_inserter(order));
+    std::reverse(order.begin(), order.end());
+    setPositions();
+  }
+}
+
+const std::vector<Vertex>& TopologicalOrder::get(const Graph& graph) {
+  sort(graph);
+  return order;
+}
+
+const std::vector<Vertex>& TopologicalOrder::get(const LiveGraph& graph) {
+  sort(graph);
+  return order;
+}
+
+const std::vector<Vertex>& TopologicalOrder::get(const FrozenGraph& graph) {
+  if (!valid) {
+    unsigned num_vertices = graph.numVertices();
+    assert(num_vertices == position.size());
+    // Kahn's algorithm, using the order itself as the queue of vertices whose
+    // parents have all been placed.
+    std::vector<unsigned> num_unplaced_parents(num_vertices);
+    order.clear();
+    for (unsigned v = 0; v < num_vertices; v++) {
+      num_unplaced_parents[v] = graph.inDegree(v);
+      if (num_unplaced_parents[v] == 0)
+        order.push_back(v);
+    }
+    for (unsigned i = 0; i < order.size(); i++) {
+      FrozenGraph::EdgeRange children = graph.outEdges(order[i]);
+      for (unsigned j = 0; j < children.size; j++) {
+        unsigned child = children.vertices[j];
+        if (--num_unplaced_parents[child] == 0)
+          order.push_back(child);
+      }
+    }
+    assert(order.size() == num_vertices && "The graph has a cycle!");
+    setPositions();
+  }
+  return order;
+}
+
+void TopologicalOrder::setPositions() {
+  for (unsigned i = 0; i < order.size(); i++)
+    position[order[i]] = i;
+  valid = true;
+  num_sorts++;
 }
 
 ExecNode* Program::getNextNode(unsigned node_id) const {
@@ -42,7 +196,7 @@ ExecNode* Program::getNextNode(unsigned node_id) const {
   return next_it->second;
 }
 
-UniqueLabel Program::getUniqueLabel(ExecNode* node) const {
+UniqueLabel Program::getUniqueLabel(const ExecNode* node) const {
   // We'll only find a label if the labelmap is present in the dynamic trace,
   // but if the configuration file doesn't use labels (it's an older config
   // file), we have to fallback on using line numbers.
@@ -55,13 +209,45 @@ UniqueLabel Program::getUniqueLabel(ExecNode* node) const {
   return UniqueLabel();
 }
 
+void Program::resolveLoopConfigs(const unrolling_config_t& unrolling,
+                                 const pipeline_config_t& pipeline,
+                                 const SourceManager& src_manager) {
+  loop_configs.clear();
+  for (auto node_it = nodes.begin(); node_it != nodes.end(); ++node_it) {
+    ExecNode* node = node_it->second;
+    StaticLine line(node->get_static_function(), node->get_line_num());
+    auto inserted = loop_configs.emplace(line, LoopConfig());
+    if (!inserted.second)
+      continue;
+    LoopConfig& config = inserted.first->second;
+    config.label = getUniqueLabel(node);
+    auto unroll_it = unrolling.find(config.label);
+    if (unroll_it == unrolling.end()) {
+      // The configuration file may identify the loop by its line number
+      // instead of its label.
+      // TODO: Line numbers are no longer actually used as a standalone
+      // identifier, so don't specify it. That field can be removed in the
+      // future.
+      Label* label =
+          src_manager.get<Label>(std::to_string(node->get_line_num()));
+      unroll_it =
+          unrolling.find(UniqueLabel(node->get_static_function(), label));
+    }
+    if (unroll_it != unrolling.end()) {
+      config.unrolled = true;
+      config.unroll_factor = unroll_it->second;
+    }
+    config.pipelined = pipeline.find(config.label) != pipeline.end();
+  }
+}
+
 std::list<cnode_pair_t> Program::findLoopBoundaries(
     const UniqueLabel& loop_label) const {
   std::list<cnode_pair_t> loop_boundaries;
   bool is_loop_executing = false;
   unsigned current_loop_depth = (unsigned)-1;
 
-  const ExecNode* loop_start;
+  const ExecNode* loop_start = nullptr;
 
   // The loop boundaries provided by the accelerator are in a linear list with
   // no structure. We need to identify the start and end of each unrolled loop
@@ -72,7 +258,7 @@ std::list<cnode_pair_t> Program::findLoopBoundaries(
     const DynLoopBound& loop_bound = *it;
     const ExecNode* node = nodes.at(loop_bound.node_id);
     const Vertex vertex = node->get_vertex();
-    if (boost::degree(vertex, graph) > 0 &&
+    if (boost::degree(vertex, live_graph) > 0 &&
         node->get_line_num() == loop_label.get_line_number() &&
         node->get_static_function() == loop_label.get_function()) {
       if (!is_loop_executing) {
@@ -139,12 +325,12 @@ std::vector<unsigned> Program::getConnectedNodes(unsigned int node_id) const {
 }
 
 std::vector<unsigned> Program::getParentNodes(unsigned int node_id) const {
-  in_edge_iter in_edge_it, in_edge_end;
+  live_in_edge_iter in_edge_it, in_edge_end;
   ExecNode* node = nodes.at(node_id);
   Vertex vertex = node->get_vertex();
 
   std::vector<unsigned> connectedNodes;
-  for (boost::tie(in_edge_it, in_edge_end) = in_edges(vertex, graph);
+  for (boost::tie(in_edge_it, in_edge_end) = in_edges(vertex, live_graph);
        in_edge_it != in_edge_end;
        ++in_edge_it) {
     Edge edge = *in_edge_it;
@@ -155,12 +341,12 @@ std::vector<unsigned> Program::getParentNodes(unsigned int node_id) const {
 }
 
 std::vector<unsigned> Program::getChildNodes(unsigned int node_id) const {
-  out_edge_iter out_edge_it, out_edge_end;
+  live_out_edge_iter out_edge_it, out_edge_end;
   ExecNode* node = nodes.at(node_id);
   Vertex vertex = node->get_vertex();
 
   std::vector<unsigned> connectedNodes;
-  for (boost::tie(out_edge_it, out_edge_end) = out_edges(vertex, graph);
+  for (boost::tie(out_edge_it, out_edge_end) = out_edges(vertex, live_graph);
        out_edge_it != out_edge_end;
        ++out_edge_it) {
     Edge edge = *out_edge_it;
@@ -174,7 +360,7 @@ int Program::getEdgeWeight(unsigned node_id_0, unsigned node_id_1) const {
   auto edge_to_parid = get(boost::edge_name, graph);
   ExecNode* node_0 = nodes.at(node_id_0);
   ExecNode* node_1 = nodes.at(node_id_1);
-  auto edge_pair = edge(node_0->get_vertex(), node_1->get_vertex(), graph);
+  auto edge_pair = edge(node_0->get_vertex(), node_1->get_vertex(), live_graph);
   if (!edge_pair.second)
     return -1;
   return edge_to_parid[edge_pair.first];
@@ -186,9 +372,9 @@ int Program::shortestDistanceBetweenNodes(unsigned from, unsigned to) const {
   while (queue.size() != 0) {
     unsigned int curr_node = queue.front().first;
     unsigned int curr_dist = queue.front().second;
-    out_edge_iter out_edge_it, out_edge_end;
+    live_out_edge_iter out_edge_it, out_edge_end;
     for (boost::tie(out_edge_it, out_edge_end) =
-             out_edges(nodes.at(curr_node)->get_vertex(), graph);
+             out_edges(nodes.at(curr_node)->get_vertex(), live_graph);
          out_edge_it != out_edge_end;
          ++out_edge_it) {
       if (get(boost::edge_name, graph, *out_edge_it) != CONTROL_EDGE) {
@@ -2,12 +2,21 @@
 #define _PROGRAM_H_
 
 #include <list>
+#include <unordered_map>
+#include <vector>
 
+#include <boost/graph/filtered_graph.hpp>
+
+#include "Arena.h"
 #include "DynamicEntity.h"
 #include "ExecNode.h"
+#include "ExecNodeMap.h"
+#include "FrozenGraph.h"
 #include "SourceEntity.h"
 #include "typedefs.h"
 
+struct dddg_edge_t;
+
 /* A dynamic loop boundary is identified by a branch/call node and a target
  * loop depth.
  */
@@ -18,6 +27,159 @@ struct DynLoopBound {
       : node_id(_node_id), target_loop_depth(_target_loop_depth) {}
 };
 
+// Running totals of the edits the graph optimizations have made to the graph.
+struct GraphEditCounts {
+  // Nodes whose edges were all removed.
+  uint64_t nodes_removed;
+  uint64_t edges_added;
+  uint64_t edges_removed;
+
+  GraphEditCounts() : nodes_removed(0), edges_added(0), edges_removed(0) {}
+
+  GraphEditCounts operator-(const GraphEditCounts& other) const {
+    GraphEditCounts diff;
+    diff.nodes_removed = nodes_removed - other.nodes_removed;
+    diff.edges_added = edges_added - other.edges_added;
+    diff.edges_removed = edges_removed - other.edges_removed;
+    return diff;
+  }
+};
+
+// The vertices of the nodes removed from the graph by the optimizations.
+//
+// Clearing the edges of a vertex one at a time is slow on the graph, so a
+// removed vertex is only marked dead. Its edges stay in the graph, hidden by
+// LiveGraph, until Program::compactGraph() drops them all at once.
+class DeadVertices {
+ public:
+  DeadVertices() : num_vertices(0), num_edges(0) {}
+
+  bool count(Vertex vertex) const {
+    return vertex < dead.size() && dead[vertex];
+  }
+
+  // Mark @vertex dead, hiding its @num_live_edges remaining edges.
+  void insert(Vertex vertex, size_t num_live_edges) {
+    assert(!count(vertex));
+    if (vertex >= dead.size())
+      dead.resize(vertex + 1);
+    dead[vertex] = true;
+    num_vertices++;
+    num_edges += num_live_edges;
+  }
+
+  // Bring @vertex back, once its @num_removed_edges hidden edges have been
+  // removed from the graph.
+  void erase(Vertex vertex, size_t num_removed_edges) {
+    assert(count(vertex));
+    dead[vertex] = false;
+    num_vertices--;
+    num_edges -= num_removed_edges;
+  }
+
+  bool empty() const { return num_vertices == 0; }
+  // The number of edges in the graph that are hidden.
+  size_t getNumEdges() const { return num_edges; }
+
+  void clear() {
+    dead.clear();
+    num_vertices = 0;
+    num_edges = 0;
+  }
+
+ private:
+  std::vector<bool> dead;
+  size_t num_vertices;
+  size_t num_edges;
+};
+
+// Keeps the edges of the graph whose ends are both live.
+class LiveEdge {
+ public:
+  LiveEdge() : graph(nullptr), dead_vertices(nullptr) {}
+  LiveEdge(const Graph* _graph, const DeadVertices* _dead_vertices)
+      : graph(_graph), dead_vertices(_dead_vertices) {}
+
+  bool operator()(const Edge& edge) const {
+    return !dead_vertices->count(source(edge, *graph)) &&
+           !dead_vertices->count(target(edge, *graph));
+  }
+
+ private:
+  const Graph* graph;
+  const DeadVertices* dead_vertices;
+};
+
+// The graph without the edges of dead vertices, which are left isolated.
+typedef boost::filtered_graph<Graph, LiveEdge> LiveGraph;
+typedef boost::graph_traits<LiveGraph>::vertex_iterator live_vertex_iter;
+typedef boost::graph_traits<LiveGraph>::in_edge_iterator live_in_edge_iter;
+typedef boost::graph_traits<LiveGraph>::out_edge_iterator live_out_edge_iter;
+
+// A topological order of the vertices of the graph, maintained as the graph
+// is built and optimized.
+//
+// Every vertex comes before its children. New vertices are appended to the
+// order, and removing edges or clearing vertices never invalidates it. Adding
+// an edge only invalidates it if the edge goes backwards in the order, which
+// is rare because nodes are created in trace order. The order is then
+// recomputed with a full sort the next time it is requested.
+class TopologicalOrder {
+ public:
+  TopologicalOrder() : valid(true), num_sorts(0) {}
+
+  void addVertex(Vertex vertex) {
+    assert(vertex == position.size());
+    position.push_back(order.size());
+    order.push_back(vertex);
+  }
+
+  void addEdge(Vertex from, Vertex to) {
+    if (valid && position[from] > position[to])
+      valid = false;
+  }
+
+  // Return the order, sorting @graph first if it is out of date.
+  const std::vector<Vertex>& get(const Graph& graph);
+  const std::vector<Vertex>& get(const LiveGraph& graph);
+  // The same, for a frozen snapshot of the graph. Sorting walks the CSR arrays
+  // instead of the adjacency lists.
+  const std::vector<Vertex>& get(const FrozenGraph& graph);
+
+  // The number of full sorts since the last clear().
+  unsigned getNumSorts() const { return num_sorts; }
+
+  void clear() {
+    order.clear();
+    position.clear();
+    valid = true;
+    num_sorts = 0;
+  }
+
+ private:
+  // Sort @graph if the order is out of date.
+  template <typename G> void sort(const G& graph);
+  // Record the position of each vertex of a freshly sorted order.
+  void setPositions();
+
+  std::vector<Vertex> order;
+  // Index of each vertex in the order.
+  std::vector<unsigned> position;
+  bool valid;
+  unsigned num_sorts;
+};
+
+// The loop directives that apply to a static instruction.
+struct LoopConfig {
+  LoopConfig() : unrolled(false), unroll_factor(0), pipelined(false) {}
+
+  SrcTypes::UniqueLabel label;
+  // Whether an unrolling directive applies. An unroll factor of 0 means the
+  // loop is flattened.
+  bool unrolled;
+  unsigned unroll_factor;
+  bool pipelined;
+};
 
 // This class maintains mappings between names of function call arguments in
 // the caller and callee.
@@ -64,17 +226,53 @@ class CallArgMap {
 // of the graph.
 class Program {
  public:
-  Program() {}
+  Program() : live_graph(graph, LiveEdge(&graph, &dead_vertices)) {}
+  // live_graph refers to the program's own graph.
+  Program(const Program&) = delete;
 
   void clear();
   void clearExecNodes();
 
   // Graph modifiers.
   void addEdge(unsigned int from, unsigned int to, uint8_t parid);
-  ExecNode* insertNode(unsigned node_id, uint8_t microop);
+  // Build the graph in one pass from @edges, with a vertex for each node in
+  // node id order. The nodes must have been inserted without vertices.
+  void buildGraph(const std::vector<dddg_edge_t>& edges);
+  // Create the node @node_id. Unless @in_graph is false, a vertex is added
+  // to the graph for it.
+  ExecNode* insertNode(unsigned node_id, uint8_t microop, bool in_graph = true);
+  // Add a vertex to the graph for @node, which was inserted without one.
+  void addToGraph(ExecNode* node);
+  // Remove @node, which must not be in the graph, and free it and its memory
+  // access.
+  void freeNode(ExecNode* node);
+
+  // Memory access records for the nodes. They are owned by the program and
+  // freed by clear().
+  ScalarMemAccess* createScalarMemAccess() { return scalar_accesses.create(); }
+  VectorMemAccess* createVectorMemAccess() { return vector_accesses.create(); }
+  template <typename... Args>
+  DmaMemAccess* createDmaMemAccess(Args&&... args) {
+    return dma_accesses.create(std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  ReadyBitAccess* createReadyBitAccess(Args&&... args) {
+    return ready_bit_accesses.create(std::forward<Args>(args)...);
+  }
 
   void createVertexMap() { vertex_to_name = get(boost::vertex_node_id, graph); }
 
+  // Drop the edges of the dead vertices from the graph, leaving the vertices
+  // isolated. Vertex numbers don't change.
+  void compactGraph();
+
+  // Take a read-only snapshot of the graph for scheduling, compacting it
+  // first. The graph must not be modified afterwards.
+  void freezeGraph() {
+    compactGraph();
+    frozen_graph.build(graph, nodes);
+  }
+
   // Return the node with the next higher node id, or nullptr if there is none.
   ExecNode* getNextNode(unsigned node_id) const;
 
@@ -86,13 +284,15 @@ class Program {
   std::vector<unsigned> getChildNodes(unsigned int node_id) const;
 
   int getNumNodes() const { return boost::num_vertices(graph); }
-  int getNumEdges() const { return boost::num_edges(graph); }
+  int getNumEdges() const {
+    return boost::num_edges(graph) - dead_vertices.getNumEdges();
+  }
   int getNumConnectedNodes(unsigned int node_id) const {
-    return boost::degree(nodes.at(node_id)->get_vertex(), graph);
+    return boost::degree(nodes.at(node_id)->get_vertex(), live_graph);
   }
 
   bool edgeExistsV(Vertex from, Vertex to) const {
-    return edge(from, to, graph).second;
+    return edge(from, to, live_graph).second;
   }
 
   bool edgeExists(const ExecNode* from, const ExecNode* to) const {
@@ -135,7 +335,22 @@ class Program {
   //
   // If the labelmap does not contain an entry corresponding to this node's
   // line number, then an empty UniqueLabel is returned.
-  SrcTypes::UniqueLabel getUniqueLabel(ExecNode* node) const;
+  SrcTypes::UniqueLabel getUniqueLabel(const ExecNode* node) const;
+
+  // Resolve the loop directives of every static instruction in the program.
+  //
+  // The directives of a node only depend on its function and line number, so
+  // they are resolved once per static instruction instead of once per node.
+  // This must be called again whenever the nodes or the directives change.
+  void resolveLoopConfigs(const unrolling_config_t& unrolling,
+                          const pipeline_config_t& pipeline,
+                          const SrcTypes::SourceManager& src_manager);
+
+  // Return the loop directives that apply to @node.
+  const LoopConfig& getLoopConfig(const ExecNode* node) const {
+    return loop_configs.at(
+        StaticLine(node->get_static_function(), node->get_line_num()));
+  }
 
   // Get the edge weight between these two nodes, or -1 if no edge exists.
   int getEdgeWeight(unsigned node_id_0, unsigned node_id_1) const;
@@ -161,8 +376,16 @@ class Program {
   // Complete set of all execution nodes.
   ExecNodeMap nodes;
 
-  // Dynamic data dependence graph.
+  // Dynamic data dependence graph. Until it is compacted, it also holds the
+  // edges of dead vertices, so code that reads it while it is optimized must
+  // go through live_graph.
   Graph graph;
+  DeadVertices dead_vertices;
+  LiveGraph live_graph;
+
+  // CSR copy of the graph, built by freezeGraph() once the graph
+  // optimizations are done.
+  FrozenGraph frozen_graph;
 
   // Line number mapping to function and label name. If there are multiple
   // source files, there could be multiple function/labels with the same line
@@ -178,6 +401,34 @@ class Program {
 
   // Vertices to their corresponding node ids.
   VertexNameMap vertex_to_name;
+
+  // Edits made by the graph optimizations.
+  GraphEditCounts edit_counts;
+
+  // Topological order of the graph. Code that adds edges to the graph
+  // directly must report them to it.
+  TopologicalOrder topo_order;
+
+ private:
+  // A static instruction, identified by its function and line number.
+  typedef std::pair<const SrcTypes::Function*, int> StaticLine;
+  struct StaticLineHash {
+    size_t operator()(const StaticLine& line) const {
+      return std::hash<const void*>()(line.first) ^
+             std::hash<int>()(line.second);
+    }
+  };
+
+  // Loop directives of each static instruction, filled by
+  // resolveLoopConfigs().
+  std::unordered_map<StaticLine, LoopConfig, StaticLineHash> loop_configs;
+
+  // Storage for the nodes and their memory accesses.
+  Arena<ExecNode> node_arena;
+  Arena<ScalarMemAccess> scalar_accesses;
+  Arena<VectorMemAccess> vector_accesses;
+  Arena<DmaMemAccess> dma_accesses;
+  Arena<ReadyBitAccess> ready_bit_accesses;
 };
 
 #endif
@@ -34,6 +34,11 @@ class Scratchpad {
                            Addr addr,
                            bool isLoad);
   bool partitionExist(std::string baseName);
+  /* Return the array named baseName, or NULL if there is none. */
+  LogicalArray* getLogicalArray(const std::string& baseName) {
+    auto it = logical_arrays.find(baseName);
+    return it == logical_arrays.end() ? nullptr : it->second;
+  }
 
   size_t getPartitionIndex(std::string arrayName, Addr abs_addr) {
     return logical_arrays[arrayName]->getPartitionIndex(abs_addr);
@@ -2,6 +2,7 @@
  * local memory.
  */
 
+#include <algorithm>
 #include <string>
 
 #include "DatabaseDeps.h"
@@ -13,50 +14,85 @@ ScratchpadDatapath::ScratchpadDatapath(std::string bench,
                                        std::string trace_file,
                                        std::string config_file)
     : BaseDatapath(bench, trace_file, config_file),
-      cycle_time(user_params.cycle_time) {
-  std::cout << "-------------------------------" << std::endl;
-  std::cout << "      Setting ScratchPad       " << std::endl;
-  std::cout << "-------------------------------" << std::endl;
+      inflight_multicycle_nodes(std::max({ FP_MUL_LATENCY_IN_CYCLES,
+                                           FP_ADD_LATENCY_IN_CYCLES,
+                                           FP_DIV_LATENCY_IN_CYCLES,
+                                           TRIG_SINE_LATENCY_IN_CYCLES })),
+      skipped_idle_cycles(0), cycle_time(user_params.cycle_time) {
+  console() << "-------------------------------" << std::endl;
+  console() << "      Setting ScratchPad       " << std::endl;
+  console() << "-------------------------------" << std::endl;
   scratchpad = new Scratchpad(user_params.scratchpad_ports,
                               user_params.cycle_time,
                               user_params.ready_mode);
   scratchpadCanService = true;
   mem_reg_conversion_executed = false;
   scratchpad_partition_executed = false;
+  registerOptimizationPasses();
 }
 
 ScratchpadDatapath::~ScratchpadDatapath() { delete scratchpad; }
 
 void ScratchpadDatapath::clearDatapath() {
   BaseDatapath::clearDatapath();
+  inflight_multicycle_nodes.clear();
+  skipped_idle_cycles = 0;
 }
 
 void ScratchpadDatapath::globalOptimizationPass() {
-  std::cout << "=============================================" << std::endl;
-  std::cout << "      Optimizing...            " << benchName << std::endl;
-  std::cout << "=============================================" << std::endl;
+  console() << "=============================================" << std::endl;
+  console() << "      Optimizing...            " << benchName << std::endl;
+  console() << "=============================================" << std::endl;
+  passes.run();
+}
+
+void ScratchpadDatapath::registerOptimizationPasses() {
   // Node removals must come first.
-  removePhiNodes();
-  /* memoryAmbiguation() should execute after removeInductionDependence()
-   * because it needs induction_nodes. */
-  removeInductionDependence();
+  passes.addPass("phi_node_removal", {}, {}, [this] { removePhiNodes(); });
+  passes.addPass("induction_dependence_removal", {}, {},
+                 [this] { removeInductionDependence(); });
   // Base address must be initialized next.
-  initBaseAddress();
-  completePartition();
-  scratchpadPartition();
-  loopFlatten();
-  loopUnrolling();
-  removeSharedLoads();
-  storeBuffer();
-  removeRepeatedStores();
-  memoryAmbiguation();
-  treeHeightReduction();
-  fuseRegLoadStores();
-  fuseConsecutiveBranches();
+  passes.addPass("base_address_init",
+                 { "phi_node_removal", "induction_dependence_removal" }, {},
+                 [this] { initBaseAddress(); });
+  passes.addPass("complete_partition", { "base_address_init" },
+                 { "partition" }, [this] { completePartition(); });
+  passes.addPass("scratchpad_partition", { "base_address_init" },
+                 { "partition" }, [this] { scratchpadPartition(); });
+  passes.addPass("loop_flatten", { "base_address_init" }, { "unrolling" },
+                 [this] { loopFlatten(); });
+  passes.addPass("loop_unrolling", { "loop_flatten" }, { "unrolling" },
+                 [this] { loopUnrolling(); });
+  passes.addPass("load_buffering", { "base_address_init" }, {},
+                 [this] { removeSharedLoads(); });
+  passes.addPass("store_buffering", { "base_address_init" }, {},
+                 [this] { storeBuffer(); });
+  passes.addPass("repeated_store_removal", { "base_address_init" }, {},
+                 [this] { removeRepeatedStores(); });
+  // Needs the induction nodes.
+  passes.addPass("memory_ambiguation", { "induction_dependence_removal" }, {},
+                 [this] { memoryAmbiguation(); });
+  // Needs the loop boundaries found by loop unrolling.
+  passes.addPass("tree_height_reduction", { "loop_unrolling" }, {},
+                 [this] { treeHeightReduction(); });
+  passes.addPass("reg_load_store_fusion", { "base_address_init" }, {},
+                 [this] { fuseRegLoadStores(); });
+  passes.addPass("consecutive_branch_fusion", { "loop_unrolling" }, {},
+                 [this] { fuseConsecutiveBranches(); });
   // Must do loop pipelining last; after all the data/control dependences are
   // fixed
-  perLoopPipelining();
-  loopPipelining();
+  std::vector<std::string> all_passes = { "loop_unrolling",
+                                          "load_buffering",
+                                          "store_buffering",
+                                          "repeated_store_removal",
+                                          "memory_ambiguation",
+                                          "tree_height_reduction",
+                                          "reg_load_store_fusion",
+                                          "consecutive_branch_fusion" };
+  passes.addPass("per_loop_pipelining", all_passes, { "pipelining" },
+                 [this] { perLoopPipelining(); });
+  passes.addPass("global_loop_pipelining", all_passes, { "global_pipelining" },
+                 [this] { loopPipelining(); });
 }
 
 /* First, compute all base addresses, then check each node to make sure that
@@ -68,7 +104,7 @@ void ScratchpadDatapath::initBaseAddress() {
 
   vertex_iter vi, vi_end;
   for (boost::tie(vi, vi_end) = vertices(program.graph); vi != vi_end; ++vi) {
-    if (boost::degree(*vi, program.graph) == 0)
+    if (boost::degree(*vi, program.live_graph) == 0)
       continue;
     Vertex curr_vertex = *vi;
     ExecNode* node = program.nodeAtVertex(curr_vertex);
@@ -94,9 +130,9 @@ void ScratchpadDatapath::completePartition() {
   if (!user_params.partition.size())
     return;
 
-  std::cout << "-------------------------------" << std::endl;
-  std::cout << "        Mem to Reg Conv        " << std::endl;
-  std::cout << "-------------------------------" << std::endl;
+  console() << "-------------------------------" << std::endl;
+  console() << "        Mem to Reg Conv        " << std::endl;
+  console() << "-------------------------------" << std::endl;
 
   for (auto it = user_params.partition.begin();
        it != user_params.partition.end();
@@ -119,9 +155,9 @@ void ScratchpadDatapath::scratchpadPartition() {
   if (!user_params.partition.size())
     return;
 
-  std::cout << "-------------------------------" << std::endl;
-  std::cout << "      ScratchPad Partition     " << std::endl;
-  std::cout << "-------------------------------" << std::endl;
+  console() << "-------------------------------" << std::endl;
+  console() << "      ScratchPad Partition     " << std::endl;
+  console() << "-------------------------------" << std::endl;
   std::string bn(benchName);
 
   if (!scratchpad_partition_executed) {
@@ -157,7 +193,7 @@ void ScratchpadDatapath::scratchpadPartition() {
     ExecNode* node = node_it->second;
     if (!node->is_memory_op())
       continue;
-    if (boost::degree(node->get_vertex(), program.graph) == 0)
+    if (boost::degree(node->get_vertex(), program.live_graph) == 0)
       continue;
     const std::string& base_label = node->get_array_label();
 
@@ -183,101 +219,163 @@ void ScratchpadDatapath::scratchpadPartition() {
 #endif
 }
 
+/* The streaming counterpart of initBaseAddress() and scratchpadPartition() for
+ * a single node. Scratchpads are set up when their array is first accessed.
+ */
+void ScratchpadDatapath::initStreamedNode(ExecNode* node) {
+  if (!node->is_memory_op())
+    return;
+  completePartition();
+  const std::string& part_name = node->get_array_label();
+  auto part_it = user_params.partition.find(part_name);
+  if (part_it == user_params.partition.end()) {
+    std::cerr << "Unknown partition : " << part_name
+              << " at node: " << node->get_node_id() << std::endl;
+    exit(-1);
+  }
+  PartitionEntry& entry = part_it->second;
+  if (entry.partition_type == complete || entry.memory_type != spad) {
+    routeMemoryNode(node);
+    return;
+  }
+  if (!scratchpad->partitionExist(part_name)) {
+    // The base address comes from the GEPs into the array. If none has been
+    // parsed yet, the access is through a plain pointer, which is nearly
+    // always to the first element.
+    if (entry.base_addr == 0)
+      entry.base_addr = node->get_mem_access()->vaddr;
+    PartitionType part_type = entry.partition_type == block ? block : cyclic;
+    scratchpad->setScratchpad(part_name, entry.base_addr, part_type,
+                              entry.part_factor, entry.array_size,
+                              entry.wordsize);
+  }
+  node->set_partition_index(
+      scratchpad->getPartitionIndex(part_name, node->get_mem_access()->vaddr));
+  routeMemoryNode(node);
+}
+
+void ScratchpadDatapath::prepareForScheduling() {
+  BaseDatapath::prepareForScheduling();
+  for (auto node_it = program.nodes.begin(); node_it != program.nodes.end();
+       ++node_it) {
+    ExecNode* node = node_it->second;
+    if (node->is_memory_op() && !node->is_isolated())
+      routeMemoryNode(node);
+  }
+}
+
+void ScratchpadDatapath::routeMemoryNode(ExecNode* node) {
+  const std::string& array_name = node->get_array_label();
+  if (registers.has(array_name)) {
+    node->set_mem_register(registers.getRegister(array_name));
+    return;
+  }
+  const PartitionEntry& partition = user_params.partition.at(array_name);
+  assert(partition.memory_type != MemoryType::host &&
+         "Host memory accesses are not supported by standalone Aladdin!");
+  LogicalArray* array = scratchpad->getLogicalArray(array_name);
+  assert(array && "Memory access to an array without a scratchpad!");
+  unsigned part_index = node->get_partition_index();
+  node->set_mem_partition(
+      array->getPartition(part_index),
+      array->getBlockIndex(part_index, node->get_mem_access()->vaddr));
+}
+
 bool ScratchpadDatapath::step() {
-  if (!BaseDatapath::step()) {
+  if (user_params.event_driven)
+    skipIdleCycles();
+  bool finished = BaseDatapath::step();
+  // While a trace is streamed, more nodes may still come after all the nodes
+  // so far have executed.
+  if (!finished || stream) {
     scratchpad->step();
     scratchpadCanService = true;
-    return false;
-  } else {
-    return true;
   }
+  return finished;
+}
+
+void ScratchpadDatapath::skipIdleCycles() {
+  // Every node in flight is still in the executing queue, so if the queue
+  // holds nothing else, no node can start before one of them completes. The
+  // scratchpad ports were already freed at the end of the last cycle, and
+  // nothing in between uses them.
+  if (inflight_multicycle_nodes.empty() || !readyToExecuteQueue.empty() ||
+      !readyStoreQueue.empty() ||
+      executingQueue.size() != inflight_multicycle_nodes.size())
+    return;
+  unsigned next_cycle = inflight_multicycle_nodes.nextCompletion(num_cycles);
+  skipped_idle_cycles += next_cycle - num_cycles;
+  num_cycles = next_cycle;
 }
 
 void ScratchpadDatapath::stepExecutingQueue() {
-  auto it = executingQueue.begin();
-  int index = 0;
-  while (it != executingQueue.end()) {
-    ExecNode* node = *it;
-    bool executed = false;
+  scanExecutingQueue([this](ExecNode* node) {
     if (node->is_memory_op()) {
-      const std::string& array_name = node->get_array_label();
-      unsigned array_name_index = node->get_partition_index();
-      if (registers.has(array_name)) {
+      if (Register* reg = node->get_mem_register()) {
         markNodeStarted(node);
         if (node->is_load_op())
-          registers.getRegister(array_name)->increment_loads();
+          reg->increment_loads();
         else
-          registers.getRegister(array_name)->increment_stores();
-        markNodeCompleted(it, index);
-        executed = true;
+          reg->increment_stores();
+        markNodeCompleted(node);
+        return true;
       } else if (scratchpadCanService) {
-        PartitionEntry partition = user_params.partition.at(array_name);
-        assert(partition.memory_type != MemoryType::host &&
-               "Host memory accesses are not supported by standalone Aladdin!");
-        MemAccess* mem_access = node->get_mem_access();
-        Addr vaddr = mem_access->vaddr;
+        Partition* partition = node->get_mem_partition();
         bool isLoad = node->is_load_op();
-        if (scratchpad->canServicePartition(
-                array_name, array_name_index, vaddr, isLoad)){
+        if (partition->canService(node->get_mem_block_index(), isLoad)) {
           markNodeStarted(node);
           if (isLoad)
-            scratchpad->increment_loads(array_name, array_name_index);
+            partition->increment_loads();
           else
-            scratchpad->increment_stores(array_name, array_name_index);
-          markNodeCompleted(it, index);
-          executed = true;
+            partition->increment_stores();
+          markNodeCompleted(node);
+          return true;
         } else {
           scratchpadCanService = scratchpad->canService();
         }
       }
     } else if (node->is_multicycle_op()) {
-      unsigned node_id = node->get_node_id();
-      if (inflight_multicycle_nodes.find(node_id) ==
-          inflight_multicycle_nodes.end()) {
-        inflight_multicycle_nodes[node_id] = node->get_multicycle_latency();
+      if (!node->started()) {
         markNodeStarted(node);
-      } else {
-        unsigned remaining_cycles = inflight_multicycle_nodes.at(node_id);
-        if (remaining_cycles == 1) {
-          inflight_multicycle_nodes.erase(node_id);
-          markNodeCompleted(it, index);
-          executed = true;
-        } else {
-          inflight_multicycle_nodes.at(node_id)--;
-        }
+        inflight_multicycle_nodes.insert(
+            num_cycles, num_cycles + node->get_multicycle_latency());
+      } else if (node->get_start_execution_cycle() +
+                     node->get_multicycle_latency() ==
+                 (unsigned)num_cycles) {
+        inflight_multicycle_nodes.remove(num_cycles);
+        markNodeCompleted(node);
+        return true;
       }
     } else {
       markNodeStarted(node);
-      markNodeCompleted(it, index);
-      executed = true;
+      markNodeCompleted(node);
+      return true;
     }
-    if (!executed) {
-      ++it;
-      ++index;
-    }
-  }
+    return false;
+  });
 }
 
 int ScratchpadDatapath::rescheduleNodesWhenNeeded() {
-  std::vector<Vertex> topo_nodes;
-  boost::topological_sort(program.graph, std::back_inserter(topo_nodes));
-  // bottom nodes first
-  std::map<unsigned, float> alap_finish_time;
-  for (auto node_it : program.nodes)
-    alap_finish_time[node_it.first] = num_cycles * cycle_time;
+  const FrozenGraph& graph = program.frozen_graph;
+  const std::vector<Vertex>& topo_nodes = program.topo_order.get(graph);
+  // Indexed by vertex.
+  std::vector<float> alap_finish_time(graph.numVertices(),
+                                      num_cycles * cycle_time);
 
-  for (auto vi = topo_nodes.begin(); vi != topo_nodes.end(); ++vi) {
-    unsigned node_id = program.atVertex(*vi);
-    ExecNode* node = program.nodes.at(node_id);
+  // bottom nodes first
+  for (auto it = topo_nodes.rbegin(); it != topo_nodes.rend(); ++it) {
+    unsigned v = *it;
+    ExecNode* node = graph.node(v);
     if (node->is_isolated())
       continue;
     float alap_start_execution_time =
         node->get_start_execution_cycle() * cycle_time;
     /* Do not reschedule memory ops and branch ops.*/
     if (!node->is_memory_op() && !node->is_branch_op()) {
-      float alap_complete_execution_time = alap_finish_time.at(node_id);
+      float alap_complete_execution_time = alap_finish_time[v];
       int new_cycle = floor(alap_complete_execution_time / cycle_time) - 1;
       if (new_cycle > node->get_complete_execution_cycle()) {
+        countNodeActivity(node, -1);
         node->set_complete_execution_cycle(new_cycle);
         if (node->is_fp_op()) {
           node->set_start_execution_cycle(
@@ -289,15 +387,15 @@ int ScratchpadDatapath::rescheduleNodesWhenNeeded() {
           alap_start_execution_time =
               alap_complete_execution_time - node->fu_node_latency(cycle_time);
         }
+        countNodeActivity(node, 1);
       }
     }
 
-    in_edge_iter in_i, in_end;
-    for (boost::tie(in_i, in_end) = in_edges(*vi, program.graph); in_i != in_end;
-         ++in_i) {
-      int parent_id = program.atVertex(source(*in_i, program.graph));
-      if (alap_finish_time.at(parent_id) > alap_start_execution_time)
-        alap_finish_time.at(parent_id) = alap_start_execution_time;
+    FrozenGraph::EdgeRange parents = graph.inEdges(v);
+    for (unsigned i = 0; i < parents.size; i++) {
+      unsigned parent = parents.vertices[i];
+      if (alap_finish_time[parent] > alap_start_execution_time)
+        alap_finish_time[parent] = alap_start_execution_time;
     }
   }
   return num_cycles;
@@ -315,8 +413,6 @@ int ScratchpadDatapath::rescheduleNodesWhenNeeded() {
  * operation latency is non deterministic, especially in the case of cache
  * access.*/
 void ScratchpadDatapath::updateChildren(ExecNode* node) {
-  if (!node->has_vertex())
-    return;
   float latency_after_current_node = 0;
   if (node->is_memory_op() || node->is_fp_op()) {
     /*No packing for both memory ops and floating point ops. Children can only
@@ -331,14 +427,8 @@ void ScratchpadDatapath::updateChildren(ExecNode* node) {
           node->fu_node_latency(cycle_time) + num_cycles * cycle_time;
     }
   }
-  Vertex curr_vertex = node->get_vertex();
-  out_edge_iter out_edge_it, out_edge_end;
-  for (boost::tie(out_edge_it, out_edge_end) = out_edges(curr_vertex, program.graph);
-       out_edge_it != out_edge_end;
-       ++out_edge_it) {
-    Vertex child_vertex = target(*out_edge_it, program.graph);
-    ExecNode* child_node = program.nodeAtVertex(child_vertex);
-    int edge_parid = edgeToParid[*out_edge_it];
+  forEachChild(node, latency_after_current_node, [&](ExecNode* child_node,
+                                                     int edge_parid) {
     float child_earliest_time = child_node->get_time_before_execution();
     if (child_earliest_time < latency_after_current_node) {
       child_node->set_time_before_execution(latency_after_current_node);
@@ -362,10 +452,7 @@ void ScratchpadDatapath::updateChildren(ExecNode* node) {
                    child_node->is_fp_op() || node->is_fp_op()) {
           /* Do not pack memory operations and floating point functional units
            *  with others. */
-          if (child_node->is_store_op())
-            readyToExecuteQueue.push_front(child_node);
-          else
-            readyToExecuteQueue.push_back(child_node);
+          pushReady(child_node);
         } else {
           /* Both curr node and child node are non-memory, non-fp operations.*/
           if (edge_parid == CONTROL_EDGE) {
@@ -382,7 +469,7 @@ void ScratchpadDatapath::updateChildren(ExecNode* node) {
         child_node->set_num_parents(-1);
       }
     }
-  }
+  });
 }
 
 #ifdef USE_DB
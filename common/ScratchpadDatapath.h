@@ -6,6 +6,7 @@
 #include "BaseDatapath.h"
 #include "ExecNode.h"
 #include "Scratchpad.h"
+#include "TimingWheel.h"
 
 class ScratchpadDatapath : public BaseDatapath {
 
@@ -29,15 +30,30 @@ class ScratchpadDatapath : public BaseDatapath {
                                   float* avg_leak);
   virtual void getMemoryBlocks(std::vector<std::string>& names);
   virtual void updateChildren(ExecNode* node);
+  virtual void initStreamedNode(ExecNode* node);
+  virtual void prepareForScheduling();
   virtual int rescheduleNodesWhenNeeded();
+  Scratchpad* getScratchpad() { return scratchpad; }
+  // The cycles skipped in event-driven mode because nothing could happen in
+  // them.
+  unsigned getSkippedIdleCycles() const { return skipped_idle_cycles; }
 
  protected:
+  // Register the graph optimizations in the order they must run.
+  void registerOptimizationPasses();
+  // Resolve where memory @node is serviced.
+  void routeMemoryNode(ExecNode* node);
+  // If the only nodes executing are multicycle nodes in flight, move on to the
+  // next cycle in which one of them completes.
+  void skipIdleCycles();
+
   Scratchpad* scratchpad;
   /*True if any of the scratchpads can still service memory requests.
     False if non of the scratchpads can service any memory requests.*/
   bool scratchpadCanService;
-  /* Stores number of cycles left for multi-cycle nodes currently in flight. */
-  std::map<unsigned, unsigned> inflight_multicycle_nodes;
+  /* The completion cycles of the multi-cycle nodes currently in flight. */
+  TimingWheel inflight_multicycle_nodes;
+  unsigned skipped_idle_cycles;
   // To streamline code.
   const float cycle_time;
 
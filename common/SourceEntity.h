@@ -35,12 +35,15 @@ class SourceEntity {
   friend SourceManager;
 
  protected:
-  SourceEntity() : name("") {}
-  SourceEntity(std::string _name) : name(_name) {}
+  SourceEntity() : name(""), index(0) {}
+  SourceEntity(std::string _name) : name(_name), index(0) {}
   virtual ~SourceEntity() {}
 
  public:
   src_id_t get_id() const { return id; }
+  // Entities of each type are numbered densely in the order they were
+  // inserted into the SourceManager, so this can index a vector.
+  unsigned get_index() const { return index; }
   const std::string& get_name() const { return name; }
 
   bool operator==(const SourceEntity& other) const { return (other.id == id); }
@@ -55,6 +58,7 @@ class SourceEntity {
 
   std::string name;
   src_id_t id;
+  unsigned index;
 };
 
 // A function in the source code.
@@ -86,7 +86,9 @@ class SourceManager {
     std::string prefix = get_type_prefix<T>();
     T* entity = new T(name);
     src_id_t id = entity->get_id();
-    name_to_id.at(prefix)[name] = id;
+    src_id_map_t& _map = name_to_id.at(prefix);
+    entity->index = _map.size();
+    _map[name] = id;
     source_entities[id] = entity;
     return entity;
   }
@@ -0,0 +1,161 @@
+#ifndef __STREAM_WINDOW_H__
+#define __STREAM_WINDOW_H__
+
+/* The recent nodes of a DDDG that is scheduled while its trace is parsed.
+ *
+ * With the stream_window directive, each node is scheduled as soon as it has
+ * been parsed, and retired once it has executed and the trace has moved on by
+ * the window size, so only a window of nodes is in memory instead of the whole
+ * graph. Each entry holds what the graph would otherwise hold for its node:
+ * the children that are still waiting for it and the types of the edges to
+ * them. Like ExecNodeMap, entries are indexed by node_id - base_id, and gaps in
+ * the node ids leave empty entries behind.
+ *
+ * A retired node has executed, so an edge from it only needs to know when its
+ * children could start, which is no later than the latest finish time of all
+ * retired nodes. The exception is a node that was retired as isolated and only
+ * gets a child later. Those are remembered so that such edges can be caught.
+ *
+ * The array that the address computed by a node refers to can be needed much
+ * later, e.g. by the callee that an array is passed to, so it is kept for all
+ * nodes, at the cost of a pointer per node.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "SourceEntity.h"
+
+class ExecNode;
+
+class StreamWindow {
+ public:
+  struct Entry {
+    Entry()
+        : node(nullptr), done(true), pending_root(false), connected(false),
+          finish_time(0) {}
+
+    // Null for a gap in the node ids.
+    ExecNode* node;
+    // The children that were waiting for this node, and the edge types.
+    std::vector<std::pair<ExecNode*, uint8_t>> children;
+    // The node has executed, or turned out to be isolated.
+    bool done;
+    // The node has no parents and it is not known yet whether it will get any
+    // children.
+    bool pending_root;
+    // The node has an edge, or it is a DMA op.
+    bool connected;
+    // When the children of the node may start, in ns. Only set once done.
+    float finish_time;
+  };
+
+  StreamWindow(unsigned _size)
+      : size(_size), base_id(0), newest_id(0), first_id(0), peak_nodes(0),
+        num_nodes(0), retired_finish_time(0) {}
+
+  // The number of nodes a node stays in the window after it is parsed.
+  unsigned getSize() const { return size; }
+  unsigned getNewestId() const { return newest_id; }
+  // The first node id in the window.
+  unsigned getBaseId() const { return base_id; }
+  bool empty() const { return entries.empty(); }
+  size_t getNumNodes() const { return num_nodes; }
+  size_t getPeakNodes() const { return peak_nodes; }
+
+  // Add the entry of @node, whose id must be larger than all others so far.
+  Entry& push(ExecNode* node, unsigned node_id) {
+    if (entries.empty() && address_vars.empty()) {
+      base_id = node_id;
+      first_id = node_id;
+    }
+    while (base_id + entries.size() < node_id)
+      entries.emplace_back();
+    entries.emplace_back();
+    Entry& entry = entries.back();
+    entry.node = node;
+    entry.done = false;
+    newest_id = node_id;
+    address_vars.resize(node_id - first_id + 1, nullptr);
+    num_nodes++;
+    if (num_nodes > peak_nodes)
+      peak_nodes = num_nodes;
+    return entry;
+  }
+
+  // Return the entry of @node_id, or nullptr if it has been retired.
+  Entry* find(unsigned node_id) {
+    if (node_id < base_id || node_id - base_id >= entries.size())
+      return nullptr;
+    Entry& entry = entries[node_id - base_id];
+    return entry.node ? &entry : nullptr;
+  }
+
+  // The entry of the @i'th node id in the window.
+  Entry& at(size_t i) { return entries[i]; }
+  size_t getNumEntries() const { return entries.size(); }
+
+  // Is the oldest node done, and older than the window?
+  bool canRetireFront() const {
+    const Entry& entry = entries.front();
+    return entry.done && base_id + size <= newest_id;
+  }
+
+  // Drop the oldest entry, returning its node.
+  ExecNode* popFront() {
+    const Entry& entry = entries.front();
+    ExecNode* node = entry.node;
+    if (node) {
+      num_nodes--;
+      if (entry.connected)
+        retired_finish_time = std::max(retired_finish_time, entry.finish_time);
+      else
+        retired_isolated.push_back(base_id);
+    }
+    entries.pop_front();
+    base_id++;
+    return node;
+  }
+
+  // Was the retired node @node_id isolated?
+  bool wasIsolated(unsigned node_id) const {
+    return std::binary_search(
+        retired_isolated.begin(), retired_isolated.end(), node_id);
+  }
+
+  /* The array that the address computed by @node_id refers to, or null if it
+   * does not compute an address. Retired nodes are included.
+   */
+  SrcTypes::Variable* getAddressVar(unsigned node_id) const {
+    if (node_id < first_id || node_id - first_id >= address_vars.size())
+      return nullptr;
+    return address_vars[node_id - first_id];
+  }
+  void setAddressVar(unsigned node_id, SrcTypes::Variable* var) {
+    address_vars[node_id - first_id] = var;
+  }
+
+  // The latest finish time of a retired node.
+  float getRetiredFinishTime() const { return retired_finish_time; }
+
+ private:
+  const unsigned size;
+  std::deque<Entry> entries;
+  unsigned base_id;
+  unsigned newest_id;
+  // The id of the first node ever pushed.
+  unsigned first_id;
+  // Indexed by node_id - first_id.
+  std::vector<SrcTypes::Variable*> address_vars;
+  size_t peak_nodes;
+  size_t num_nodes;
+  float retired_finish_time;
+  // Ids of the isolated nodes that were retired, in increasing order.
+  std::vector<unsigned> retired_isolated;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef __TIMING_WHEEL_H__
+#define __TIMING_WHEEL_H__
+
+/* The cycles in which the multicycle nodes in flight will complete.
+ *
+ * Every latency is known when a node starts and is shorter than the wheel, so
+ * the nodes in flight always complete within one turn of it. Each slot counts
+ * the nodes completing in the cycle that maps to it, which is enough to find
+ * the next cycle in which anything completes without visiting the nodes.
+ */
+
+#include <assert.h>
+#include <vector>
+
+class TimingWheel {
+ public:
+  // The wheel holds nodes with latencies of up to @max_latency cycles.
+  TimingWheel(unsigned max_latency) : num_inflight(0) {
+    unsigned size = 1;
+    while (size <= max_latency)
+      size <<= 1;
+    slots.assign(size, 0);
+  }
+
+  // A node started in cycle @now completes in cycle @complete_cycle.
+  void insert(unsigned now, unsigned complete_cycle) {
+    assert(complete_cycle > now && complete_cycle - now < slots.size() &&
+           "Latency does not fit in the timing wheel!");
+    slots[slot(complete_cycle)]++;
+    num_inflight++;
+  }
+
+  // A node completed in cycle @complete_cycle.
+  void remove(unsigned complete_cycle) {
+    assert(slots[slot(complete_cycle)] > 0);
+    slots[slot(complete_cycle)]--;
+    num_inflight--;
+  }
+
+  // The first cycle from @now on in which a node completes. There must be a
+  // node in flight.
+  unsigned nextCompletion(unsigned now) const {
+    assert(num_inflight > 0);
+    unsigned cycle = now;
+    while (slots[slot(cycle)] == 0)
+      cycle++;
+    return cycle;
+  }
+
+  unsigned size() const { return num_inflight; }
+  bool empty() const { return num_inflight == 0; }
+
+  void clear() {
+    slots.assign(slots.size(), 0);
+    num_inflight = 0;
+  }
+
+ private:
+  unsigned slot(unsigned cycle) const { return cycle & (slots.size() - 1); }
+
+  // The number of nodes completing in the cycles that map to each slot.
+  std::vector<unsigned> slots;
+  unsigned num_inflight;
+};
+
+#endif
@@ -0,0 +1,572 @@
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>
+
+#include "TraceIndex.h"
+#include "TraceTokenizer.h"
+#include "opcode_func.h"
+
+static const char kIndexMagic[8] = { 'A', 'L', 'D', 'N', 'T', 'I', 'D', 'X' };
+static const uint32_t kIndexVersion = 1;
+static const unsigned kInputChunkSize = 1 << 16;
+static const unsigned kRawChunkSize = 1 << 20;
+
+//=------------------------------ Index builder ------------------------------=//
+
+/* Splits the uncompressed trace into lines and finds the invocation
+ * boundaries, following the same rules as DDDG::read_text_trace().
+ */
+class TraceIndex::Builder {
+ public:
+  Builder(TraceIndex& _index)
+      : index(_index), offset(0), invocation_start(0),
+        invocation_trace_off(0), seen_labelmap(false) {
+    reset();
+  }
+
+  // Consume the next @len bytes of the uncompressed trace. @trace_off is the
+  // offset into the trace file that they were decompressed from.
+  void consume(const char* data, size_t len, uint64_t trace_off) {
+    while (len > 0) {
+      const char* newline = (const char*)memchr(data, '\n', len);
+      size_t line_len = newline ? newline - data + 1 : len;
+      line.insert(line.end(), data, data + line_len);
+      offset += line_len;
+      data += line_len;
+      len -= line_len;
+      if (newline)
+        processLine(trace_off);
+    }
+  }
+
+  // Process the last line, if it did not end in a newline.
+  void finish(uint64_t trace_off) {
+    if (!line.empty())
+      processLine(trace_off);
+  }
+
+ private:
+  void reset() {
+    first_function.clear();
+    seen_first_line = false;
+    first_function_returned = false;
+    in_labelmap_section = false;
+    labelmap_parsed_or_not_present = false;
+  }
+
+  void processLine(uint64_t trace_off) {
+    // The line started where the last one ended, and the next one starts at
+    // the current offset.
+    uint64_t line_start = offset - line.size();
+    size_t len = line.size();
+    if (len > 0 && line[len - 1] == '\n')
+      len--;
+    line.resize(len);
+    line.push_back('\0');
+    char* buffer = line.data();
+    handleLine(buffer, len, line_start, trace_off);
+    line.clear();
+  }
+
+  void handleLine(char* buffer,
+                  size_t len,
+                  uint64_t line_start,
+                  uint64_t trace_off) {
+    if (!labelmap_parsed_or_not_present) {
+      if (!in_labelmap_section) {
+        if (strstr(buffer, "%%%% LABEL MAP START %%%%") != NULL) {
+          in_labelmap_section = true;
+          if (!seen_labelmap)
+            index.labelmap_start = line_start;
+          return;
+        }
+      } else {
+        if (strstr(buffer, "%%%% LABEL MAP END %%%%") != NULL) {
+          labelmap_parsed_or_not_present = true;
+          in_labelmap_section = false;
+          if (!seen_labelmap)
+            index.labelmap_end = offset;
+          seen_labelmap = true;
+          return;
+        }
+      }
+    }
+    if (memchr(buffer, ',', len) == NULL) {
+      if (first_function_returned) {
+        // The DDDG of this invocation ends here, and the next one starts
+        // reading at the following line.
+        reset();
+        invocation_start = offset;
+        invocation_trace_off = trace_off;
+      }
+      return;
+    }
+    labelmap_parsed_or_not_present = true;
+    TraceLineTokenizer tokenizer(buffer, len);
+    if (strcmp(tokenizer.next_field(), "0") != 0)
+      return;
+    tokenizer.skip_field();  // Line number.
+    const char* function = tokenizer.next_field();
+    tokenizer.skip_field();  // Basic block.
+    tokenizer.skip_field();  // Instruction.
+    int microop = tokenizer.next_int();
+    if (!seen_first_line) {
+      seen_first_line = true;
+      first_function = function;
+      Invocation invocation = { invocation_start, invocation_trace_off };
+      index.invocations.push_back(invocation);
+    }
+    first_function_returned =
+        microop == LLVM_IR_Ret && first_function == function;
+  }
+
+  TraceIndex& index;
+  // Offset in the uncompressed trace of the end of the consumed data.
+  uint64_t offset;
+  // The line being assembled.
+  std::vector<char> line;
+
+  uint64_t invocation_start;
+  uint64_t invocation_trace_off;
+  bool seen_labelmap;
+
+  // Parser state of the current invocation.
+  std::string first_function;
+  bool seen_first_line;
+  bool first_function_returned;
+  bool in_labelmap_section;
+  bool labelmap_parsed_or_not_present;
+};
+
+//=-------------------------------- TraceIndex -------------------------------=//
+
+const uint64_t TraceIndex::kEndOfTrace;
+const uint64_t TraceIndex::kAccessPointSpan;
+const unsigned TraceIndex::kWindowSize;
+
+TraceIndex::TraceIndex()
+    : labelmap_start(0), labelmap_end(0), uncompressed_size(0),
+      gzipped(false), trace_size(0), trace_mtime(0) {}
+
+std::string TraceIndex::indexFileName(const std::string& trace_name) {
+  return trace_name + ".idx";
+}
+
+bool TraceIndex::statTrace(const std::string& trace_name,
+                           uint64_t* size,
+                           int64_t* mtime) const {
+  struct stat st;
+  if (stat(trace_name.c_str(), &st) != 0)
+    return false;
+  *size = st.st_size;
+  *mtime = st.st_mtime;
+  return true;
+}
+
+bool TraceIndex::loadOrBuild(const std::string& trace_name) {
+  std::string index_name = indexFileName(trace_name);
+  if (load(index_name, trace_name))
+    return true;
+  std::cout << "Indexing trace " << trace_name << "..." << std::endl;
+  if (!build(trace_name))
+    return false;
+  // Failing to save the index only means that it will be rebuilt next time.
+  if (!save(index_name))
+    std::cerr << "WARNING: Could not save the trace index to " << index_name
+              << std::endl;
+  return true;
+}
+
+bool TraceIndex::build(const std::string& trace_name, uint64_t span) {
+  invocations.clear();
+  access_points.clear();
+  labelmap_start = 0;
+  labelmap_end = 0;
+  uncompressed_size = 0;
+  if (!statTrace(trace_name, &trace_size, &trace_mtime))
+    return false;
+  FILE* trace = fopen(trace_name.c_str(), "rb");
+  if (!trace)
+    return false;
+  unsigned char magic[2];
+  gzipped = fread(magic, 1, sizeof(magic), trace) == sizeof(magic) &&
+            magic[0] == 0x1f && magic[1] == 0x8b;
+  rewind(trace);
+
+  Builder builder(*this);
+  bool success =
+      gzipped ? indexGzip(trace, builder, span) : indexRaw(trace, builder);
+  fclose(trace);
+  if (!success)
+    std::cerr << "ERROR: Failed to index trace " << trace_name << std::endl;
+  return success;
+}
+
+bool TraceIndex::indexRaw(FILE* trace, Builder& builder) {
+  std::vector<char> buffer(kRawChunkSize);
+  size_t bytes;
+  while ((bytes = fread(buffer.data(), 1, buffer.size(), trace)) > 0) {
+    uncompressed_size += bytes;
+    builder.consume(buffer.data(), bytes, uncompressed_size);
+  }
+  builder.finish(uncompressed_size);
+  return !ferror(trace);
+}
+
+// Based on zran.c from the zlib distribution.
+bool TraceIndex::indexGzip(FILE* trace, Builder& builder, uint64_t span) {
+  std::vector<unsigned char> input(kInputChunkSize);
+  std::vector<unsigned char> window(kWindowSize);
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  // Decode gzip or zlib wrappers.
+  if (inflateInit2(&strm, 47) != Z_OK)
+    return false;
+
+  uint64_t total_in = 0;
+  uint64_t total_out = 0;
+  uint64_t last_point = 0;
+  bool member_ended = false;
+  bool success = true;
+  while (true) {
+    if (strm.avail_in == 0) {
+      strm.avail_in = fread(input.data(), 1, input.size(), trace);
+      strm.next_in = input.data();
+      if (ferror(trace)) {
+        success = false;
+        break;
+      }
+      if (strm.avail_in == 0) {
+        // The trace must not end in the middle of a gzip member.
+        success = member_ended;
+        break;
+      }
+    }
+    if (strm.avail_out == 0) {
+      strm.avail_out = kWindowSize;
+      strm.next_out = window.data();
+    }
+    unsigned char* out_start = strm.next_out;
+    total_in += strm.avail_in;
+    total_out += strm.avail_out;
+    // Stop at the end of every deflate block to look for access points.
+    int ret = inflate(&strm, Z_BLOCK);
+    total_in -= strm.avail_in;
+    total_out -= strm.avail_out;
+    builder.consume(
+        (const char*)out_start, strm.next_out - out_start, total_in);
+    if (ret == Z_DATA_ERROR && member_ended) {
+      // Ignore trailing garbage after the last gzip member, as gzip does.
+      break;
+    }
+    if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
+      success = false;
+      break;
+    }
+    if (ret == Z_STREAM_END) {
+      // Look for another concatenated gzip member.
+      member_ended = true;
+      inflateReset(&strm);
+      continue;
+    }
+    member_ended = false;
+    // Bit 7 of data_type is set at the end of a block header, and bit 6 is set
+    // if that block is the last one.
+    if ((strm.data_type & 128) && !(strm.data_type & 64) &&
+        (access_points.empty() || total_out - last_point >= span)) {
+      addAccessPoint(
+          strm.data_type & 7, total_in, total_out, strm.avail_out, window.data());
+      last_point = total_out;
+    }
+  }
+  inflateEnd(&strm);
+  uncompressed_size = total_out;
+  builder.finish(total_in);
+  return success;
+}
+
+void TraceIndex::addAccessPoint(int bits,
+                                uint64_t in,
+                                uint64_t out,
+                                unsigned left,
+                                const unsigned char* window) {
+  AccessPoint point;
+  point.out = out;
+  point.in = in;
+  point.bits = bits;
+  // The window is a circular buffer, and the output ends @left bytes before
+  // its end. Store it starting from the oldest byte.
+  point.window.resize(kWindowSize);
+  if (left)
+    memcpy(point.window.data(), window + kWindowSize - left, left);
+  if (left < kWindowSize)
+    memcpy(point.window.data() + left, window, kWindowSize - left);
+  access_points.push_back(std::move(point));
+}
+
+const TraceIndex::AccessPoint* TraceIndex::findAccessPoint(
+    uint64_t offset) const {
+  const AccessPoint* found = nullptr;
+  size_t lo = 0, hi = access_points.size();
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (access_points[mid].out <= offset) {
+      found = &access_points[mid];
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return found;
+}
+
+template <typename T>
+static bool writeField(gzFile file, const T& value) {
+  return gzwrite(file, &value, sizeof(T)) == sizeof(T);
+}
+
+template <typename T>
+static bool readField(gzFile file, T& value) {
+  return gzread(file, &value, sizeof(T)) == sizeof(T);
+}
+
+bool TraceIndex::save(const std::string& index_name) const {
+  gzFile file = gzopen(index_name.c_str(), "wb");
+  if (!file)
+    return false;
+  bool ok = gzwrite(file, kIndexMagic, sizeof(kIndexMagic)) ==
+                sizeof(kIndexMagic) &&
+            writeField(file, kIndexVersion) && writeField(file, trace_size) &&
+            writeField(file, trace_mtime) &&
+            writeField(file, (uint8_t)gzipped) &&
+            writeField(file, uncompressed_size) &&
+            writeField(file, labelmap_start) &&
+            writeField(file, labelmap_end) &&
+            writeField(file, (uint64_t)invocations.size());
+  for (const Invocation& invocation : invocations) {
+    ok = ok && writeField(file, invocation.offset) &&
+         writeField(file, invocation.trace_off);
+  }
+  ok = ok && writeField(file, (uint64_t)access_points.size());
+  for (const AccessPoint& point : access_points) {
+    ok = ok && writeField(file, point.out) && writeField(file, point.in) &&
+         writeField(file, (int32_t)point.bits) &&
+         gzwrite(file, point.window.data(), kWindowSize) == (int)kWindowSize;
+  }
+  ok = gzclose(file) == Z_OK && ok;
+  if (!ok)
+    remove(index_name.c_str());
+  return ok;
+}
+
+bool TraceIndex::load(const std::string& index_name,
+                      const std::string& trace_name) {
+  uint64_t actual_size;
+  int64_t actual_mtime;
+  if (!statTrace(trace_name, &actual_size, &actual_mtime))
+    return false;
+  gzFile file = gzopen(index_name.c_str(), "rb");
+  if (!file)
+    return false;
+  char magic[sizeof(kIndexMagic)];
+  uint32_t version;
+  uint8_t is_gzipped;
+  uint64_t num_invocations, num_points;
+  bool ok = gzread(file, magic, sizeof(magic)) == sizeof(magic) &&
+            memcmp(magic, kIndexMagic, sizeof(magic)) == 0 &&
+            readField(file, version) && version == kIndexVersion &&
+            readField(file, trace_size) && trace_size == actual_size &&
+            readField(file, trace_mtime) && trace_mtime == actual_mtime &&
+            readField(file, is_gzipped) &&
+            readField(file, uncompressed_size) &&
+            readField(file, labelmap_start) &&
+            readField(file, labelmap_end) &&
+            readField(file, num_invocations);
+  gzipped = is_gzipped;
+  invocations.clear();
+  for (uint64_t i = 0; ok && i < num_invocations; i++) {
+    Invocation invocation;
+    ok = readField(file, invocation.offset) &&
+         readField(file, invocation.trace_off);
+    invocations.push_back(invocation);
+  }
+  ok = ok && readField(file, num_points);
+  access_points.clear();
+  for (uint64_t i = 0; ok && i < num_points; i++) {
+    AccessPoint point;
+    int32_t bits;
+    point.window.resize(kWindowSize);
+    ok = readField(file, point.out) && readField(file, point.in) &&
+         readField(file, bits) &&
+         gzread(file, point.window.data(), kWindowSize) == (int)kWindowSize;
+    point.bits = bits;
+    access_points.push_back(std::move(point));
+  }
+  gzclose(file);
+  if (!ok) {
+    invocations.clear();
+    access_points.clear();
+  }
+  return ok;
+}
+
+//=---------------------------- IndexedTraceStream ---------------------------=//
+
+IndexedTraceStream::IndexedTraceStream(const TraceIndex& _index,
+                                       const std::string& trace_name)
+    : index(_index), strm_init(false), raw_mode(false),
+      at_member_start(false), at_end(false), input(kInputChunkSize),
+      discard(kInputChunkSize), curr_range(0), range_started(false), pos(0) {
+  file = fopen(trace_name.c_str(), "rb");
+  memset(&strm, 0, sizeof(strm));
+}
+
+IndexedTraceStream::~IndexedTraceStream() {
+  if (strm_init)
+    inflateEnd(&strm);
+  if (file)
+    fclose(file);
+}
+
+void IndexedTraceStream::addRange(uint64_t start, uint64_t end) {
+  if (start < end)
+    ranges.push_back(std::make_pair(start, end));
+}
+
+int IndexedTraceStream::read(char* buf, unsigned len) {
+  while (curr_range < ranges.size()) {
+    const std::pair<uint64_t, uint64_t>& range = ranges[curr_range];
+    if (!range_started) {
+      if (!seek(range.first))
+        return -1;
+      range_started = true;
+    }
+    uint64_t remaining = range.second - pos;
+    int bytes = 0;
+    if (remaining > 0) {
+      bytes = readRaw(
+          (unsigned char*)buf, remaining < len ? (unsigned)remaining : len);
+      if (bytes < 0)
+        return -1;
+    }
+    if (bytes == 0) {
+      // Reached the end of the range or of the trace.
+      curr_range++;
+      range_started = false;
+      continue;
+    }
+    pos += bytes;
+    return bytes;
+  }
+  return 0;
+}
+
+long IndexedTraceStream::getTraceOffset() const {
+  if (!file)
+    return 0;
+  return ftello(file) - strm.avail_in;
+}
+
+bool IndexedTraceStream::seek(uint64_t offset) {
+  if (!file)
+    return false;
+  if (!index.isGzipped()) {
+    if (fseeko(file, offset, SEEK_SET) != 0)
+      return false;
+    pos = offset;
+    return true;
+  }
+
+  // Restart from an access point, unless the target is only a short distance
+  // ahead of the current position.
+  if (!strm_init || offset < pos ||
+      offset - pos > TraceIndex::kAccessPointSpan) {
+    const TraceIndex::AccessPoint* point = index.findAccessPoint(offset);
+    if (!point)
+      return false;
+    if (strm_init)
+      inflateEnd(&strm);
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, -15) != Z_OK)
+      return false;
+    strm_init = true;
+    raw_mode = true;
+    at_member_start = false;
+    at_end = false;
+    if (fseeko(file, point->in - (point->bits ? 1 : 0), SEEK_SET) != 0)
+      return false;
+    if (point->bits) {
+      int byte = getc(file);
+      if (byte == EOF)
+        return false;
+      inflatePrime(&strm, point->bits, byte >> (8 - point->bits));
+    }
+    inflateSetDictionary(
+        &strm, point->window.data(), TraceIndex::kWindowSize);
+    pos = point->out;
+  }
+  while (pos < offset) {
+    uint64_t remaining = offset - pos;
+    int bytes = readRaw(discard.data(),
+                        remaining < discard.size() ? (unsigned)remaining
+                                                   : discard.size());
+    if (bytes <= 0)
+      return false;
+    pos += bytes;
+  }
+  return true;
+}
+
+bool IndexedTraceStream::fillInput() {
+  strm.avail_in = fread(input.data(), 1, input.size(), file);
+  strm.next_in = input.data();
+  return strm.avail_in > 0;
+}
+
+bool IndexedTraceStream::skipInput(unsigned len) {
+  while (len > 0) {
+    if (strm.avail_in == 0 && !fillInput())
+      return false;
+    unsigned skipped = len < strm.avail_in ? len : strm.avail_in;
+    strm.next_in += skipped;
+    strm.avail_in -= skipped;
+    len -= skipped;
+  }
+  return true;
+}
+
+int IndexedTraceStream::readRaw(unsigned char* buf, unsigned len) {
+  if (!index.isGzipped()) {
+    size_t bytes = fread(buf, 1, len, file);
+    return ferror(file) ? -1 : bytes;
+  }
+  strm.next_out = buf;
+  strm.avail_out = len;
+  while (!at_end && strm.avail_out == len) {
+    if (strm.avail_in == 0 && !fillInput()) {
+      if (ferror(file) || !at_member_start)
+        return -1;
+      at_end = true;
+      break;
+    }
+    int ret = inflate(&strm, Z_NO_FLUSH);
+    if (ret == Z_DATA_ERROR && at_member_start) {
+      // Trailing garbage after the last gzip member.
+      at_end = true;
+      break;
+    }
+    if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR)
+      return -1;
+    if (ret == Z_STREAM_END) {
+      // Raw deflate does not consume the gzip trailer of the member.
+      if (raw_mode && !skipInput(8))
+        return -1;
+      inflateReset2(&strm, 31);
+      raw_mode = false;
+      at_member_start = true;
+    } else if (strm.avail_out != len) {
+      at_member_start = false;
+    }
+  }
+  return len - strm.avail_out;
+}
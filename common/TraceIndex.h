@@ -0,0 +1,177 @@
+#ifndef __TRACE_INDEX_H__
+#define __TRACE_INDEX_H__
+
+/* An index of the top-level invocations in a text dynamic trace.
+ *
+ * Aladdin builds one DDDG per top-level invocation of the traced function,
+ * reading the trace sequentially, so simulating invocation N requires parsing
+ * all the invocations before it. A TraceIndex records where each invocation
+ * starts in the uncompressed trace, using the same rules as
+ * DDDG::build_initial_dddg() to find the end of an invocation.
+ *
+ * Gzipped traces cannot be seeked into directly. While indexing, the state of
+ * the decompressor is therefore saved at deflate block boundaries roughly
+ * every kAccessPointSpan bytes of output: the compressed bit offset and the
+ * last 32KB of output, which deflate may refer back to. Decompression can be
+ * restarted from any of these access points, so reaching any offset costs at
+ * most kAccessPointSpan bytes of decompression.
+ *
+ * The index is built in one pass over the trace and saved next to it as
+ * <trace>.idx. It is rebuilt if the trace changes.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+class TraceIndex {
+ public:
+  // Denotes the end of the uncompressed trace.
+  static const uint64_t kEndOfTrace = UINT64_MAX;
+  // Distance in uncompressed bytes between gzip access points.
+  static const uint64_t kAccessPointSpan = 16 << 20;
+  // Size of the deflate history window.
+  static const unsigned kWindowSize = 32768;
+
+  struct Invocation {
+    // Offset of the first line of the invocation in the uncompressed trace.
+    uint64_t offset;
+    // Offset into the trace file at which the invocation starts. This is only
+    // approximate for gzipped traces, and is used to report progress.
+    uint64_t trace_off;
+  };
+
+  struct AccessPoint {
+    // Offset in the uncompressed trace.
+    uint64_t out;
+    // Offset of the first full byte of the deflate block in the trace file.
+    uint64_t in;
+    // Number of bits of the block in the byte before @in (0-7).
+    int bits;
+    // The last kWindowSize bytes of output before @out.
+    std::vector<unsigned char> window;
+  };
+
+  TraceIndex();
+
+  // Return the file name of the index of @trace_name.
+  static std::string indexFileName(const std::string& trace_name);
+
+  /* Load the index of @trace_name, or build and save it if it does not exist
+   * or is out of date. Returns false if the trace could not be indexed.
+   */
+  bool loadOrBuild(const std::string& trace_name);
+
+  // Index @trace_name in a single pass, with gzip access points about every
+  // @span bytes.
+  bool build(const std::string& trace_name,
+             uint64_t span = kAccessPointSpan);
+  bool save(const std::string& index_name) const;
+  // Returns false if the index cannot be read or does not match the trace.
+  bool load(const std::string& index_name, const std::string& trace_name);
+
+  unsigned getNumInvocations() const { return invocations.size(); }
+  const Invocation& getInvocation(unsigned i) const {
+    return invocations.at(i);
+  }
+  // Uncompressed offset at which invocation @i ends.
+  uint64_t getInvocationEnd(unsigned i) const {
+    return i + 1 < invocations.size() ? invocations[i + 1].offset
+                                      : kEndOfTrace;
+  }
+
+  // The labelmap section, including its start and end markers. The range is
+  // empty if the trace has no labelmap.
+  uint64_t getLabelmapStart() const { return labelmap_start; }
+  uint64_t getLabelmapEnd() const { return labelmap_end; }
+
+  bool isGzipped() const { return gzipped; }
+  uint64_t getUncompressedSize() const { return uncompressed_size; }
+  size_t getNumAccessPoints() const { return access_points.size(); }
+
+  // Return the last access point at or before @offset, or nullptr if there is
+  // none (which is only the case for uncompressed traces).
+  const AccessPoint* findAccessPoint(uint64_t offset) const;
+
+ private:
+  // Line scanner used while building the index.
+  class Builder;
+
+  bool indexGzip(FILE* trace, Builder& builder, uint64_t span);
+  bool indexRaw(FILE* trace, Builder& builder);
+  void addAccessPoint(int bits,
+                      uint64_t in,
+                      uint64_t out,
+                      unsigned left,
+                      const unsigned char* window);
+
+  // Identify the trace file that the index was built from.
+  bool statTrace(const std::string& trace_name,
+                 uint64_t* size,
+                 int64_t* mtime) const;
+
+  std::vector<Invocation> invocations;
+  std::vector<AccessPoint> access_points;
+  uint64_t labelmap_start;
+  uint64_t labelmap_end;
+  uint64_t uncompressed_size;
+  bool gzipped;
+  uint64_t trace_size;
+  int64_t trace_mtime;
+};
+
+/* Reads selected ranges of the uncompressed trace, using a TraceIndex to
+ * restart decompression close to the start of each range.
+ */
+class IndexedTraceStream {
+ public:
+  IndexedTraceStream(const TraceIndex& _index, const std::string& trace_name);
+  ~IndexedTraceStream();
+
+  // Whether the trace file was opened successfully.
+  bool isOpen() const { return file != NULL; }
+
+  // Queue the range [start, end) of the uncompressed trace to be read. Ranges
+  // are read in the order they were added.
+  void addRange(uint64_t start, uint64_t end);
+
+  /* Read up to @len bytes of the queued ranges into @buf.
+   *
+   * Returns the number of bytes read, 0 at the end of the last range, or -1
+   * if the trace could not be read.
+   */
+  int read(char* buf, unsigned len);
+
+  // The offset into the trace file up to which it has been read.
+  long getTraceOffset() const;
+
+ private:
+  // Position the stream at @offset of the uncompressed trace.
+  bool seek(uint64_t offset);
+  // Decompress (or read) up to @len bytes at the current position.
+  int readRaw(unsigned char* buf, unsigned len);
+  bool fillInput();
+  bool skipInput(unsigned len);
+
+  const TraceIndex& index;
+  FILE* file;
+  z_stream strm;
+  bool strm_init;
+  // Decompression restarted from an access point is raw deflate, and only
+  // switches to parsing gzip wrappers at the start of the next gzip member.
+  bool raw_mode;
+  bool at_member_start;
+  bool at_end;
+  std::vector<unsigned char> input;
+  std::vector<unsigned char> discard;
+
+  std::vector<std::pair<uint64_t, uint64_t>> ranges;
+  unsigned curr_range;
+  bool range_started;
+  // Current position in the uncompressed trace.
+  uint64_t pos;
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include <assert.h>
+#include <cstring>
+
+#include "TraceIndex.h"
+#include "TraceReader.h"
+
+TraceLineReader::TraceLineReader(gzFile& _trace_file,
+                                 size_t buffer_size,
+                                 unsigned num_buffers)
+    : trace_file(_trace_file), started(false), ring(num_buffers),
+      num_produced(0), num_released(0), num_acquired(0), trace_done(false),
+      stop(false), curr_buffer(nullptr), curr_pos(0), at_end(false),
+      consumed_trace_off(0), bytes_decompressed(0), trace_bytes_read(0),
+      decompress_secs(0), decompress_stall_secs(0), bytes_parsed(0),
+      lines_parsed(0), parse_stall_secs(0) {
+  for (TraceBuffer& buf : ring) {
+    buf.data.resize(buffer_size);
+    buf.len = 0;
+    buf.trace_off = 0;
+  }
+}
+
+TraceLineReader::~TraceLineReader() {
+  if (!started)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(ring_lock);
+    stop = true;
+  }
+  slot_free.notify_all();
+  decompressor.join();
+}
+
+void TraceLineReader::read_from(IndexedTraceStream* _stream) {
+  assert(!started && "The trace has already been read from!");
+  stream.reset(_stream);
+}
+
+int TraceLineReader::read_trace(char* buf, unsigned len) {
+  if (stream)
+    return stream->read(buf, len);
+  return gzread(trace_file, buf, len);
+}
+
+long TraceLineReader::read_trace_offset() {
+  if (stream)
+    return stream->getTraceOffset();
+  return gzoffset(trace_file);
+}
+
+double TraceLineReader::elapsed(const struct timeval& start,
+                                const struct timeval& end) {
+  return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+}
+
+void TraceLineReader::fill_buffers() {
+  // The tail of the last buffer that did not end in a newline.
+  std::vector<char> partial_line;
+  bool eof = false;
+  while (!eof) {
+    struct timeval wait_start, wait_end;
+    gettimeofday(&wait_start, NULL);
+    TraceBuffer* buf;
+    {
+      std::unique_lock<std::mutex> lock(ring_lock);
+      while (!stop && num_produced - num_released == ring.size())
+        slot_free.wait(lock);
+      if (stop)
+        return;
+      buf = &ring[num_produced % ring.size()];
+    }
+    gettimeofday(&wait_end, NULL);
+
+    // Start with the partial line left over from the previous buffer.
+    size_t len = partial_line.size();
+    if (buf->data.size() < len * 2)
+      buf->data.resize(len * 2);
+    memcpy(buf->data.data(), partial_line.data(), len);
+    partial_line.clear();
+
+    size_t line_end = 0;
+    while (line_end == 0 && !eof) {
+      if (len == buf->data.size())
+        buf->data.resize(buf->data.size() * 2);
+      int bytes = read_trace(&buf->data[len], buf->data.size() - len);
+      if (bytes <= 0) {
+        // The last line of the trace need not end in a newline.
+        eof = true;
+        line_end = len;
+        break;
+      }
+      len += bytes;
+      // Only hand out whole lines.
+      for (size_t i = len; i > 0; i--) {
+        if (buf->data[i - 1] == '\n') {
+          line_end = i;
+          break;
+        }
+      }
+    }
+    partial_line.assign(buf->data.begin() + line_end, buf->data.begin() + len);
+    buf->len = line_end;
+    // Leave room for the consumer to terminate a last line without a newline.
+    if (buf->data.size() == buf->len)
+      buf->data.push_back('\0');
+    buf->trace_off = read_trace_offset();
+
+    struct timeval fill_end;
+    gettimeofday(&fill_end, NULL);
+    {
+      std::lock_guard<std::mutex> lock(ring_lock);
+      bytes_decompressed += line_end;
+      trace_bytes_read = buf->trace_off;
+      decompress_stall_secs += elapsed(wait_start, wait_end);
+      decompress_secs += elapsed(wait_end, fill_end);
+      num_produced++;
+      trace_done = eof;
+    }
+    slot_filled.notify_one();
+  }
+}
+
+bool TraceLineReader::acquire_buffer() {
+  struct timeval wait_start, wait_end;
+  gettimeofday(&wait_start, NULL);
+  std::unique_lock<std::mutex> lock(ring_lock);
+  while (num_acquired == num_produced && !trace_done)
+    slot_filled.wait(lock);
+  gettimeofday(&wait_end, NULL);
+  parse_stall_secs += elapsed(wait_start, wait_end);
+  if (num_acquired == num_produced)
+    return false;
+  curr_buffer = &ring[num_acquired % ring.size()];
+  curr_pos = 0;
+  num_acquired++;
+  return true;
+}
+
+void TraceLineReader::release_buffer() {
+  {
+    std::lock_guard<std::mutex> lock(ring_lock);
+    num_released++;
+  }
+  curr_buffer = nullptr;
+  slot_free.notify_one();
+}
+
+char* TraceLineReader::getline(size_t* len) {
+  if (!started) {
+    started = true;
+    gettimeofday(&consume_start, NULL);
+    decompressor = std::thread(&TraceLineReader::fill_buffers, this);
+  }
+  while (!at_end && (!curr_buffer || curr_pos == curr_buffer->len)) {
+    if (curr_buffer)
+      release_buffer();
+    if (!acquire_buffer())
+      at_end = true;
+    else
+      consumed_trace_off = curr_buffer->trace_off;
+  }
+  if (at_end)
+    return nullptr;
+
+  char* line = &curr_buffer->data[curr_pos];
+  size_t remaining = curr_buffer->len - curr_pos;
+  char* newline = (char*)memchr(line, '\n', remaining);
+  size_t line_len = newline ? newline - line : remaining;
+  // If there is no newline, this is the last line of the trace, and the
+  // decompressor has left room past it for the terminator.
+  line[line_len] = '\0';
+  curr_pos += newline ? line_len + 1 : line_len;
+  bytes_parsed += newline ? line_len + 1 : line_len;
+  lines_parsed++;
+  *len = line_len;
+  return line;
+}
+
+void TraceLineReader::print_stats(std::ostream& out) {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  double parse_secs = started ? elapsed(consume_start, now) : 0;
+  std::lock_guard<std::mutex> lock(ring_lock);
+  parse_secs -= parse_stall_secs;
+  const double MB = 1024 * 1024;
+  out << "Trace decompression: " << bytes_decompressed / MB << " MB ("
+      << trace_bytes_read / MB << " MB read) in " << decompress_secs << " s, "
+      << (decompress_secs > 0 ? bytes_decompressed / MB / decompress_secs : 0)
+      << " MB/s, stalled " << decompress_stall_secs << " s" << std::endl;
+  out << "Trace parsing: " << lines_parsed << " lines, " << bytes_parsed / MB
+      << " MB in " << parse_secs << " s, "
+      << (parse_secs > 0 ? bytes_parsed / MB / parse_secs : 0)
+      << " MB/s, stalled " << parse_stall_secs << " s" << std::endl;
+}
@@ -0,0 +1,121 @@
+#ifndef __TRACE_READER_H__
+#define __TRACE_READER_H__
+
+/* A pipelined reader for the text dynamic trace.
+ *
+ * Decompressing the trace with gzgets and parsing it on the same thread leaves
+ * one of the two stages idle at any time. TraceLineReader moves the
+ * decompression to a background thread, which fills a bounded ring of large
+ * buffers with whole lines. The parser consumes one buffer at a time and hands
+ * out the lines in it without copying them.
+ *
+ * The same reader works for gzipped and uncompressed traces, since zlib reads
+ * uncompressed files transparently.
+ *
+ * The reader owns the read position of the trace file once it has started, so
+ * it must outlive all DDDGs built from the trace, and the trace file must not
+ * be read or closed by anyone else while the reader exists.
+ */
+
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/time.h>
+#include <zlib.h>
+
+class IndexedTraceStream;
+
+class TraceLineReader {
+ public:
+  // Each buffer holds at least @buffer_size bytes of the decompressed trace.
+  // A buffer is grown if a single line does not fit in it.
+  static const size_t kDefaultBufferSize = 4 << 20;
+  static const unsigned kDefaultNumBuffers = 4;
+
+  TraceLineReader(gzFile& _trace_file,
+                  size_t buffer_size = kDefaultBufferSize,
+                  unsigned num_buffers = kDefaultNumBuffers);
+  ~TraceLineReader();
+
+  // Read the trace through @stream instead of the trace file, e.g. to read
+  // only selected invocations. The reader takes ownership of @stream. This
+  // must be called before the first line is read.
+  void read_from(IndexedTraceStream* stream);
+
+  /* Return the next line of the trace, or nullptr at the end of the trace.
+   *
+   * The trailing newline is replaced by a null terminator, and the length of
+   * the line (excluding the terminator) is returned in @len. The line remains
+   * valid until the next call, and may be modified in place by the caller.
+   *
+   * The decompressor thread is started on the first call.
+   */
+  char* getline(size_t* len);
+
+  // The offset into the (compressed) trace file up to which the trace has
+  // been consumed. This is only accurate to the granularity of one buffer.
+  long get_trace_offset() const { return consumed_trace_off; }
+
+  // Print the throughput of the decompression and parsing stages so far.
+  void print_stats(std::ostream& out);
+
+ private:
+  struct TraceBuffer {
+    std::vector<char> data;
+    // Number of valid bytes in data, which always ends on a line boundary.
+    size_t len;
+    // Offset into the trace file after this buffer was filled.
+    long trace_off;
+  };
+
+  // Body of the decompressor thread.
+  void fill_buffers();
+  // Read the next @len bytes of the trace from the file or the stream.
+  int read_trace(char* buf, unsigned len);
+  long read_trace_offset();
+  // Wait for the next filled buffer. Returns false at the end of the trace.
+  bool acquire_buffer();
+  void release_buffer();
+  static double elapsed(const struct timeval& start, const struct timeval& end);
+
+  gzFile& trace_file;
+  std::unique_ptr<IndexedTraceStream> stream;
+  std::thread decompressor;
+  bool started;
+
+  std::vector<TraceBuffer> ring;
+  // Slots are filled and consumed in ring order. The counters are totals, so
+  // the slot of a counter is its value modulo the ring size.
+  unsigned long num_produced;
+  unsigned long num_released;
+  unsigned long num_acquired;
+  // Set by the decompressor at the end of the trace.
+  bool trace_done;
+  // Set by the destructor to stop the decompressor.
+  bool stop;
+  std::mutex ring_lock;
+  std::condition_variable slot_free;
+  std::condition_variable slot_filled;
+
+  // The buffer being consumed, and the position of the next line in it.
+  TraceBuffer* curr_buffer;
+  size_t curr_pos;
+  bool at_end;
+  long consumed_trace_off;
+
+  // Statistics. The decompressor stats are only written by that thread, and
+  // only read after it has finished or while holding ring_lock.
+  unsigned long bytes_decompressed;
+  long trace_bytes_read;
+  double decompress_secs;
+  double decompress_stall_secs;
+  unsigned long bytes_parsed;
+  unsigned long lines_parsed;
+  double parse_stall_secs;
+  struct timeval consume_start;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef __TRACE_TOKENIZER_H__
+#define __TRACE_TOKENIZER_H__
+
+/* A zero-copy tokenizer for lines of the text dynamic trace.
+ *
+ * Every trace line is a list of comma separated fields. TraceLineTokenizer
+ * walks a line in place, replacing the comma after each field it hands out
+ * with a null terminator, so fields can be used as C strings directly out of
+ * the decompression buffer. Numeric fields are parsed without copying them.
+ *
+ * Missing fields are returned as empty strings and parse as zero, so a short
+ * line never reads past the end of its buffer.
+ */
+
+#include <cstring>
+#include <stdint.h>
+
+class TraceLineTokenizer {
+ public:
+  // @line must be null terminated at @len, and is modified in place.
+  TraceLineTokenizer(char* line, size_t len) : pos(line), end(line + len) {}
+
+  // Return the next field as a null terminated string. Its length (without
+  // the terminator) is returned in @len if it is not null.
+  char* next_field(size_t* len = nullptr) {
+    char* field = pos;
+    char* comma = (char*)memchr(pos, ',', end - pos);
+    if (comma) {
+      *comma = '\0';
+      pos = comma + 1;
+    } else {
+      // The last field ends at the terminator of the line.
+      comma = end;
+      pos = end;
+    }
+    if (len)
+      *len = comma - field;
+    return field;
+  }
+
+  void skip_field() { next_field(); }
+
+  // Parse the next field as a signed decimal integer.
+  long long next_int() { return parse_int(next_field()); }
+
+  // Whether there are any characters left on the line.
+  bool at_end() const { return pos == end; }
+
+  // The unconsumed rest of the line.
+  char* rest() const { return pos; }
+
+  /* Parse a decimal integer with an optional sign.
+   *
+   * Parsing stops at the first character that is not a digit, and the value
+   * wraps around on overflow instead of saturating, so that unsigned 64-bit
+   * values are returned bit-exact.
+   */
+  static long long parse_int(const char* str) {
+    bool negative = false;
+    if (*str == '-' || *str == '+')
+      negative = *str++ == '-';
+    uint64_t value = 0;
+    for (; *str >= '0' && *str <= '9'; str++)
+      value = value * 10 + (*str - '0');
+    return negative ? -(long long)value : (long long)value;
+  }
+
+  // Parse a hexadecimal integer, with or without a leading 0x.
+  static uint64_t parse_hex(const char* str) {
+    if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X'))
+      str += 2;
+    uint64_t value = 0;
+    for (;; str++) {
+      int nibble = hex_digit(*str);
+      if (nibble < 0)
+        break;
+      value = (value << 4) | nibble;
+    }
+    return value;
+  }
+
+  // Return the value of a hex digit, or -1 if @c is not one.
+  static int hex_digit(char c) {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+ private:
+  char* pos;
+  char* end;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "file_func.h"
+#include "ParallelSimulator.h"
 #include "ScratchpadDatapath.h"
 #include "Scratchpad.h"
 #include "DDDG.h"
@@ -50,6 +51,34 @@ int main(int argc, const char* argv[]) {
 
   acc = new ScratchpadDatapath(bench, trace_file, config_file);
 
+  if (acc->isStreaming()) {
+    if (acc->getParallelInvocations() > 1) {
+      std::cerr << "ERROR: stream_window cannot be combined with "
+                   "parallel_invocations." << std::endl;
+      exit(1);
+    }
+    if (acc->isSampling()) {
+      std::cerr << "ERROR: stream_window cannot be combined with "
+                   "sampling." << std::endl;
+      exit(1);
+    }
+    // Each invocation is scheduled while it is parsed.
+    while (acc->streamDddg())
+      acc->clearDatapath();
+    delete acc;
+    return 0;
+  }
+
+  if (acc->getParallelInvocations() > 1) {
+    ParallelSimulator simulator(acc, bench, trace_file, config_file);
+#ifdef USE_DB
+    if (argc == 5)
+      simulator.setExperimentParameters(std::string(argv[4]));
+#endif
+    simulator.run();
+    return 0;
+  }
+
 #ifdef USE_DB
   bool use_db = (argc == 5);
   if (use_db) {
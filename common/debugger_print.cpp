@@ -130,12 +130,12 @@ void DebugNodePrinter::printMemoryOp() {
     else
       out << "No\n";
     out << "    Value: ";
-    if (auto vec_access = dynamic_cast<VectorMemAccess*>(mem_access)) {
+    if (auto vec_access = node->get_vector_mem_access()) {
       char* hexstr = bytesToHexStr(vec_access->data(), vec_access->size, true);
       out << hexstr << "\n";
       delete[] hexstr;
     } else {
-      auto scalar_access = dynamic_cast<ScalarMemAccess*>(mem_access);
+      auto scalar_access = node->get_scalar_mem_access();
       uint64_t bits;
       memcpy(&bits, scalar_access->data(), 8);
       if (scalar_access->is_float && scalar_access->size == 4)
@@ -15,7 +15,7 @@ std::string BaseAddressInit::getCenteredName(size_t size) {
 void BaseAddressInit::optimize() {
   EdgeNameMap edge_to_parid = get(boost::edge_name, graph);
 
-  vertex_iter vi, vi_end;
+  live_vertex_iter vi, vi_end;
   for (boost::tie(vi, vi_end) = vertices(graph); vi != vi_end; ++vi) {
     if (boost::degree(*vi, graph) == 0)
       continue;
@@ -27,7 +27,7 @@ void BaseAddressInit::optimize() {
     // iterate its parents, until it finds the root parent
     while (true) {
       bool found_parent = false;
-      in_edge_iter in_edge_it, in_edge_end;
+      live_in_edge_iter in_edge_it, in_edge_end;
 
       for (boost::tie(in_edge_it, in_edge_end) = in_edges(curr_vertex, graph);
            in_edge_it != in_edge_end;
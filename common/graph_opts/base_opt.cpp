@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <atomic>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "base_opt.h"
@@ -10,9 +13,9 @@
 
 void BaseAladdinOpt::run() {
   static const std::string boundary = "-------------------------------";
-  std::cout << boundary << "\n"
-            << getCenteredName(boundary.size()) << "\n"
-            << boundary << "\n";
+  console << boundary << "\n"
+          << getCenteredName(boundary.size()) << "\n"
+          << boundary << "\n";
   optimize();
 }
 
@@ -33,29 +36,85 @@ bool BaseAladdinOpt::doesEdgeExist(Vertex from, Vertex to) {
 
 void BaseAladdinOpt::updateGraphWithNewEdges(
     std::vector<NewEdge>& to_add_edges) {
-  std::cout << "  Adding " << to_add_edges.size() << " new edges.\n";
+  console << "  Adding " << to_add_edges.size() << " new edges.\n";
   for (auto it = to_add_edges.begin(); it != to_add_edges.end(); ++it) {
     if (*it->from != *it->to && !doesEdgeExist(it->from, it->to)) {
+      reviveVertex(it->from->get_vertex());
+      reviveVertex(it->to->get_vertex());
       get(boost::edge_name,
-          graph)[add_edge(it->from->get_vertex(), it->to->get_vertex(), graph)
-                     .first] = it->parid;
+          full_graph)[add_edge(it->from->get_vertex(), it->to->get_vertex(),
+                               full_graph).first] = it->parid;
+      topo_order.addEdge(it->from->get_vertex(), it->to->get_vertex());
+      edit_counts.edges_added++;
     }
   }
 }
 void BaseAladdinOpt::updateGraphWithIsolatedNodes(
     std::vector<unsigned>& to_remove_nodes) {
-  std::cout << "  Removing " << to_remove_nodes.size() << " isolated nodes.\n";
+  console << "  Removing " << to_remove_nodes.size() << " isolated nodes.\n";
   for (auto it = to_remove_nodes.begin(); it != to_remove_nodes.end(); ++it) {
-    clear_vertex(exec_nodes.at(*it)->get_vertex(), graph);
+    Vertex vertex = exec_nodes.at(*it)->get_vertex();
+    unsigned degree = boost::degree(vertex, graph);
+    if (degree == 0)
+      continue;
+    dead_vertices.insert(vertex, degree);
+    edit_counts.nodes_removed++;
+    edit_counts.edges_removed += degree;
   }
 }
 
+void BaseAladdinOpt::reviveVertex(Vertex vertex) {
+  if (!dead_vertices.count(vertex))
+    return;
+  // The hidden edges were already counted as removed.
+  dead_vertices.erase(vertex, boost::degree(vertex, full_graph));
+  clear_vertex(vertex, full_graph);
+}
+
 void BaseAladdinOpt::updateGraphWithIsolatedEdges(
     std::set<Edge>& to_remove_edges) {
-  std::cout << "  Removing " << to_remove_edges.size() << " edges.\n";
+  console << "  Removing " << to_remove_edges.size() << " edges.\n";
+  size_t num_edges_before = boost::num_edges(full_graph);
   for (auto it = to_remove_edges.begin(), E = to_remove_edges.end(); it != E;
        ++it)
-    remove_edge(source(*it, graph), target(*it, graph), graph);
+    remove_edge(source(*it, graph), target(*it, graph), full_graph);
+  edit_counts.edges_removed += num_edges_before - boost::num_edges(full_graph);
+}
+
+std::vector<ExecNodeMap::iterator> BaseAladdinOpt::findLoopRegions() const {
+  std::vector<ExecNodeMap::iterator> regions;
+  auto node_it = exec_nodes.begin();
+  regions.push_back(node_it);
+  for (auto& bound : loop_bounds) {
+    while (node_it != exec_nodes.end() && node_it->first < bound.node_id)
+      ++node_it;
+    regions.push_back(node_it);
+    if (node_it == exec_nodes.end())
+      break;
+  }
+  return regions;
+}
+
+void BaseAladdinOpt::forEachRegion(
+    size_t num_regions, const std::function<void(size_t)>& analyze) const {
+  size_t num_threads =
+      std::min<size_t>(user_params.graph_opt_threads, num_regions);
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < num_regions; i++)
+      analyze(i);
+    return;
+  }
+  std::atomic<size_t> next_region(0);
+  auto worker = [&]() {
+    for (size_t i = next_region++; i < num_regions; i = next_region++)
+      analyze(i);
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++)
+    threads.emplace_back(worker);
+  worker();
+  for (auto& thread : threads)
+    thread.join();
 }
 
 bool BaseAladdinOpt::isPrunableNode(ExecNode* node) const {
@@ -99,33 +158,29 @@ bool BaseAladdinOpt::isPrunableNode(ExecNode* node) const {
 void BaseAladdinOpt::cleanLeafNodes() {
   EdgeNameMap edge_to_parid = get(boost::edge_name, graph);
 
-  // Track the number of children each node has that will be removed.
-  std::map<unsigned, unsigned> num_children_to_be_removed;
-  for (auto& node_it : exec_nodes)
-    num_children_to_be_removed[node_it.first] = 0;
+  // Track the number of children each vertex has that will be removed.
+  std::vector<unsigned> num_children_to_be_removed(boost::num_vertices(graph));
   std::vector<unsigned> to_remove_nodes;
 
-  std::vector<Vertex> topo_nodes;
-  boost::topological_sort(graph, std::back_inserter(topo_nodes));
+  const std::vector<Vertex>& topo_nodes = topo_order.get(graph);
   // bottom nodes first
-  for (auto vi = topo_nodes.begin(); vi != topo_nodes.end(); ++vi) {
+  for (auto vi = topo_nodes.rbegin(); vi != topo_nodes.rend(); ++vi) {
     Vertex node_vertex = *vi;
     if (boost::degree(node_vertex, graph) == 0)
       continue;
     unsigned node_id = vertex_to_name[node_vertex];
     ExecNode* node = exec_nodes.at(node_id);
-    if (num_children_to_be_removed.at(node_id) ==
+    if (num_children_to_be_removed[node_vertex] ==
             boost::out_degree(node_vertex, graph) &&
         isPrunableNode(node)) {
       to_remove_nodes.push_back(node_id);
       // This node will be removed, so we need to update the counters for all
       // of its parents.
-      in_edge_iter in_edge_it, in_edge_end;
+      live_in_edge_iter in_edge_it, in_edge_end;
       for (boost::tie(in_edge_it, in_edge_end) = in_edges(node_vertex, graph);
            in_edge_it != in_edge_end;
            ++in_edge_it) {
-        int parent_id = vertex_to_name[source(*in_edge_it, graph)];
-        num_children_to_be_removed.at(parent_id)++;
+        num_children_to_be_removed[source(*in_edge_it, graph)]++;
       }
     } else if (node->is_branch_op()) {
       // Increment the counter for every parent of this branch node with a
@@ -134,43 +189,15 @@ void BaseAladdinOpt::cleanLeafNodes() {
       // are control dependences to branches, then that parent's produced value
       // is not used anywhere, so it can be removed. Note that it is the PARENT
       // of the branch that may be removed, not the branch itself.
-      in_edge_iter in_edge_it, in_edge_end;
+      live_in_edge_iter in_edge_it, in_edge_end;
       for (boost::tie(in_edge_it, in_edge_end) = in_edges(node_vertex, graph);
            in_edge_it != in_edge_end;
            ++in_edge_it) {
-        if (edge_to_parid[*in_edge_it] == CONTROL_EDGE) {
-          int parent_id = vertex_to_name[source(*in_edge_it, graph)];
-          num_children_to_be_removed.at(parent_id)++;
-        }
+        if (edge_to_parid[*in_edge_it] == CONTROL_EDGE)
+          num_children_to_be_removed[source(*in_edge_it, graph)]++;
       }
     }
   }
   updateGraphWithIsolatedNodes(to_remove_nodes);
 }
 
-SrcTypes::UniqueLabel BaseAladdinOpt::getUniqueLabel(ExecNode* node) {
-  // We'll only find a label if the labelmap is present in the dynamic trace,
-  // but if the configuration file doesn't use labels (it's an older config
-  // file), we have to fallback on using line numbers.
-  auto range = labelmap.equal_range(node->get_line_num());
-  for (auto it = range.first; it != range.second; ++it) {
-    if (it->second.get_function() != node->get_static_function())
-      continue;
-    return it->second;
-  }
-  return SrcTypes::UniqueLabel();
-}
-
-unrolling_config_t::const_iterator BaseAladdinOpt::getUnrollFactor(
-    ExecNode* node) {
-  using namespace SrcTypes;
-  UniqueLabel unrolling_id = getUniqueLabel(node);
-  auto config_it = user_params.unrolling.find(unrolling_id);
-  if (config_it != user_params.unrolling.end())
-    return config_it;
-  Label* label = src_manager.get<Label>(std::to_string(node->get_line_num()));
-  // TODO: Line numbers are no longer actually used as a standalone identifier,
-  // so don't specify it. That field can be removed in the future.
-  return user_params.unrolling.find(
-      UniqueLabel(node->get_static_function(), label));
-}
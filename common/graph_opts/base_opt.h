@@ -1,6 +1,8 @@
 #ifndef _BASE_OPT_H_
 #define _BASE_OPT_H_
 
+#include <functional>
+#include <iostream>
 #include <string>
 #include <vector>
 
@@ -19,14 +21,20 @@ class BaseAladdinOpt {
   // reference. This lets us use a mixture of const and non-const Program
   // fields while keeping a const reference to Program for its helper
   // functions.
+  //
+  // Progress messages are printed to @_console.
   BaseAladdinOpt(Program& _program,
                  const SrcTypes::SourceManager& _src_manager,
-                 const UserConfigParams& _user_params)
-      : program(_program), exec_nodes(_program.nodes), graph(_program.graph),
+                 const UserConfigParams& _user_params,
+                 std::ostream& _console = std::cout)
+      : program(_program), exec_nodes(_program.nodes),
+        graph(_program.live_graph), full_graph(_program.graph),
+        dead_vertices(_program.dead_vertices),
         loop_bounds(_program.loop_bounds),
-        vertex_to_name(_program.vertex_to_name), labelmap(_program.labelmap),
-        src_manager(_src_manager), call_argument_map(_program.call_arg_map),
-        user_params(_user_params) {}
+        vertex_to_name(_program.vertex_to_name), src_manager(_src_manager),
+        call_argument_map(_program.call_arg_map),
+        edit_counts(_program.edit_counts), topo_order(_program.topo_order),
+        user_params(_user_params), console(_console) {}
 
   void run();
   virtual void optimize() = 0;
@@ -47,31 +55,58 @@ class BaseAladdinOpt {
   // Is this node removable from the program if it has no children?
   bool isPrunableNode(ExecNode* node) const;
 
-  unrolling_config_t::const_iterator getUnrollFactor(ExecNode* node);
-  SrcTypes::UniqueLabel getUniqueLabel(ExecNode* node);
+  // The loop directives that apply to @node.
+  const LoopConfig& getLoopConfig(const ExecNode* node) const {
+    return program.getLoopConfig(node);
+  }
 
   void updateGraphWithNewEdges(std::vector<NewEdge>& to_add_edges);
+  // Remove all the edges of the nodes @to_remove_nodes. Their vertices are
+  // only marked dead, and the edges are dropped when the graph is compacted.
   void updateGraphWithIsolatedNodes(std::vector<unsigned>& to_remove_nodes);
   void updateGraphWithIsolatedEdges(std::set<Edge>& to_remove_edges);
+  // If @vertex is dead, drop its hidden edges and make it live again, so that
+  // new edges can be added to it.
+  void reviveVertex(Vertex vertex);
   void cleanLeafNodes();
 
+  // Split the nodes into the regions that end at each loop boundary. Region i
+  // holds the nodes in [regions[i], regions[i + 1]), and the nodes after the
+  // last boundary are not in any region.
+  std::vector<ExecNodeMap::iterator> findLoopRegions() const;
+
+  // Call @analyze(i) for every i in [0, num_regions), concurrently on up to
+  // user_params.graph_opt_threads threads. @analyze may read the graph and
+  // the nodes, but must only modify state that belongs to region i.
+  void forEachRegion(size_t num_regions,
+                     const std::function<void(size_t)>& analyze) const;
+
   const Program& program;
 
   // Mutable properties of nodes, loops, and graphs.
   ExecNodeMap& exec_nodes;
-  Graph& graph;
+  // The optimizations read the graph through the live view, which hides the
+  // edges of removed nodes, and only the updateGraphWith* functions edit the
+  // full graph.
+  LiveGraph& graph;
+  Graph& full_graph;
+  DeadVertices& dead_vertices;
   std::vector<DynLoopBound>& loop_bounds;
 
   // Unmutable graph properties.
   const VertexNameMap& vertex_to_name;
 
   // Source information.
-  const labelmap_t& labelmap;
   const SrcTypes::SourceManager& src_manager;
   const CallArgMap& call_argument_map;
 
+  // Updated by the updateGraphWith* functions.
+  GraphEditCounts& edit_counts;
+  TopologicalOrder& topo_order;
+
   // User configuration settings.
   const UserConfigParams& user_params;
+  std::ostream& console;
 };
 
 #endif
@@ -19,8 +19,7 @@ void ConsecutiveBranchFusion::optimize() {
   std::set<Edge> to_remove_edges;
   std::vector<NewEdge> to_add_edges;
 
-  std::list<Vertex> topo_nodes;
-  boost::topological_sort(graph, std::front_inserter(topo_nodes));
+  const std::vector<Vertex>& topo_nodes = topo_order.get(graph);
 
   for (auto vi = topo_nodes.begin(); vi != topo_nodes.end(); ++vi) {
     Vertex vertex = *vi;
@@ -50,7 +49,7 @@ void ConsecutiveBranchFusion::findBranchChain(
 
   if (boost::out_degree(root->get_vertex(), graph) != 1)
     return;
-  out_edge_iter out_edge_it, out_edge_end;
+  live_out_edge_iter out_edge_it, out_edge_end;
   for (boost::tie(out_edge_it, out_edge_end) =
            out_edges(root->get_vertex(), graph);
        out_edge_it != out_edge_end;
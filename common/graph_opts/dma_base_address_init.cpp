@@ -85,7 +85,7 @@ void DmaBaseAddressInit::optimize() {
 
     // Find the node that generated this address, if it exists.
     bool found_src = false, found_dst = false;
-    in_edge_iter in_edge_it, in_edge_end;
+    live_in_edge_iter in_edge_it, in_edge_end;
     for (boost::tie(in_edge_it, in_edge_end) = in_edges(dma_vertex, graph);
          in_edge_it != in_edge_end;
          ++in_edge_it) {
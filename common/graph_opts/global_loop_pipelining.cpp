@@ -33,7 +33,7 @@ void GlobalLoopPipelining::optimize() {
 
   EdgeNameMap edge_to_parid = get(boost::edge_name, graph);
 
-  vertex_iter vi, vi_end;
+  live_vertex_iter vi, vi_end;
   std::set<Edge> to_remove_edges;
   std::vector<NewEdge> to_add_edges;
 
@@ -77,11 +77,11 @@ void GlobalLoopPipelining::optimize() {
     ExecNode* br_node = exec_nodes.at(first_it->first);
     ExecNode* first_node = exec_nodes.at(first_it->second);
     bool found = false;
-    auto unroll_it = getUnrollFactor(br_node);
+    const LoopConfig& loop_config = getLoopConfig(br_node);
     /* We only want to pipeline loop iterations that are from the same unrolled
      * loop. Here we first check the current basic block is part of an unrolled
      * loop iteration. */
-    if (unroll_it != user_params.unrolling.end()) {
+    if (loop_config.unrolled) {
       // check whether the previous branch is the same loop or not
       if (prev_branch_n != nullptr) {
         if ((br_node->get_line_num() == prev_branch_n->get_line_num()) &&
@@ -104,7 +104,7 @@ void GlobalLoopPipelining::optimize() {
     }
     // adding dependence between first_id and prev_branch's children
     assert(prev_branch_n->has_vertex());
-    out_edge_iter out_edge_it, out_edge_end;
+    live_out_edge_iter out_edge_it, out_edge_end;
     for (boost::tie(out_edge_it, out_edge_end) =
              out_edges(prev_branch_n->get_vertex(), graph);
          out_edge_it != out_edge_end;
@@ -120,7 +120,7 @@ void GlobalLoopPipelining::optimize() {
     }
     // update first_id's parents, dependence become strict control dependence
     assert(first_node->has_vertex());
-    in_edge_iter in_edge_it, in_edge_end;
+    live_in_edge_iter in_edge_it, in_edge_end;
     for (boost::tie(in_edge_it, in_edge_end) =
              in_edges(first_node->get_vertex(), graph);
          in_edge_it != in_edge_end;
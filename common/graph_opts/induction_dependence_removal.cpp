@@ -40,7 +40,7 @@ void InductionDependenceRemoval::optimize() {
       /* If one of the parent is inductive, and the operation is an integer mul,
        * do strength reduction that converts the mul/div to a shifter.*/
       bool any_inductive = false;
-      in_edge_iter in_edge_it, in_edge_end;
+      live_in_edge_iter in_edge_it, in_edge_end;
       for (boost::tie(in_edge_it, in_edge_end) =
                in_edges(node->get_vertex(), graph);
            in_edge_it != in_edge_end;
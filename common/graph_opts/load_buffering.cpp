@@ -10,25 +10,24 @@ void LoadBuffering::optimize() {
 
   EdgeNameMap edge_to_parid = get(boost::edge_name, graph);
 
-  vertex_iter vi, vi_end;
+  // Loads are only shared within a loop region, so the regions are analyzed
+  // independently and their edits are merged in region order.
+  std::vector<ExecNodeMap::iterator> regions = findLoopRegions();
+  size_t num_regions = regions.size() - 1;
+  std::vector<std::vector<NewEdge>> region_add_edges(num_regions);
+  std::vector<std::vector<Edge>> region_remove_edges(num_regions);
 
-  std::set<Edge> to_remove_edges;
-  std::vector<NewEdge> to_add_edges;
-
-  int shared_loads = 0;
-  auto bound_it = loop_bounds.begin();
-
-  auto node_it = exec_nodes.begin();
-  while (node_it != exec_nodes.end()) {
+  forEachRegion(num_regions, [&](size_t region) {
+    std::vector<NewEdge>& to_add_edges = region_add_edges[region];
+    std::vector<Edge>& to_remove_edges = region_remove_edges[region];
     std::unordered_map<unsigned, ExecNode*> address_loaded;
-    while (node_it->first < bound_it->node_id && node_it != exec_nodes.end()) {
+    for (auto node_it = regions[region]; node_it != regions[region + 1];
+         ++node_it) {
       ExecNode* node = node_it->second;
       if (!node->has_vertex() ||
           boost::degree(node->get_vertex(), graph) == 0 ||
-          !node->is_memory_op()) {
-        node_it++;
+          !node->is_memory_op())
         continue;
-      }
       Addr node_address = node->get_mem_access()->vaddr;
       auto addr_it = address_loaded.find(node_address);
       if (node->is_store_op() && addr_it != address_loaded.end()) {
@@ -38,16 +37,13 @@ void LoadBuffering::optimize() {
           address_loaded[node_address] = node;
         } else {
           // check whether the current load is dynamic or not.
-          if (node->is_dynamic_mem_op()) {
-            ++node_it;
+          if (node->is_dynamic_mem_op())
             continue;
-          }
-          shared_loads++;
           node->set_microop(LLVM_IR_Move);
           ExecNode* prev_load = addr_it->second;
           // iterate through its children
           Vertex load_node = node->get_vertex();
-          out_edge_iter out_edge_it, out_edge_end;
+          live_out_edge_iter out_edge_it, out_edge_end;
           for (boost::tie(out_edge_it, out_edge_end) =
                    out_edges(load_node, graph);
                out_edge_it != out_edge_end;
@@ -61,21 +57,27 @@ void LoadBuffering::optimize() {
               to_add_edges.push_back(
                   { prev_load, child_node, edge_to_parid[curr_edge] });
             }
-            to_remove_edges.insert(*out_edge_it);
+            to_remove_edges.push_back(*out_edge_it);
           }
-          in_edge_iter in_edge_it, in_edge_end;
+          live_in_edge_iter in_edge_it, in_edge_end;
           for (boost::tie(in_edge_it, in_edge_end) =
                    in_edges(load_node, graph);
                in_edge_it != in_edge_end;
                ++in_edge_it)
-            to_remove_edges.insert(*in_edge_it);
+            to_remove_edges.push_back(*in_edge_it);
         }
       }
-      node_it++;
     }
-    bound_it++;
-    if (bound_it == loop_bounds.end())
-      break;
+  });
+
+  std::set<Edge> to_remove_edges;
+  std::vector<NewEdge> to_add_edges;
+  for (size_t region = 0; region < num_regions; region++) {
+    to_add_edges.insert(to_add_edges.end(),
+                        region_add_edges[region].begin(),
+                        region_add_edges[region].end());
+    to_remove_edges.insert(region_remove_edges[region].begin(),
+                           region_remove_edges[region].end());
   }
   updateGraphWithNewEdges(to_add_edges);
   updateGraphWithIsolatedEdges(to_remove_edges);
@@ -91,8 +91,8 @@ void LoopUnrolling::optimize() {
         curr_call_depth++;
         prev_branch = node;
       }
-      auto unroll_it = getUnrollFactor(node);
-      if (unroll_it == user_params.unrolling.end() || unroll_it->second == 0) {
+      const LoopConfig& loop_config = getLoopConfig(node);
+      if (!loop_config.unrolled || loop_config.unroll_factor == 0) {
         // not unrolling branch
         if (!node->is_call_op() && !node->is_dma_op()) {
           nodes_between.push_back(node);
@@ -160,7 +160,7 @@ void LoopUnrolling::optimize() {
         }
 
         // Counting number of loop iterations.
-        int unroll_factor = unroll_it->second;
+        int unroll_factor = loop_config.unroll_factor;
         curr_loop->dyn_invocations++;
         if (curr_loop->dyn_invocations % unroll_factor == 0) {
           if (loop_bounds.rbegin()->node_id != node_id) {
@@ -184,7 +184,10 @@ void LoopUnrolling::optimize() {
       }
     }
   }
-  loop_bounds.push_back(DynLoopBound(exec_nodes.size(), 0));
+  // Node ids can have gaps, e.g. where sampled iterations were dropped.
+  unsigned end_node_id =
+      exec_nodes.empty() ? 0 : exec_nodes.rbegin()->first + 1;
+  loop_bounds.push_back(DynLoopBound(end_node_id, 0));
 
   if (iter_counts == 0 && user_params.unrolling.size() != 0) {
     std::cerr << "-------------------------------\n"
@@ -210,8 +213,8 @@ void LoopFlattening::optimize() {
   for (auto node_it = exec_nodes.begin(); node_it != exec_nodes.end();
        ++node_it) {
     ExecNode* node = node_it->second;
-    auto config_it = getUnrollFactor(node);
-    if (config_it == user_params.unrolling.end() || config_it->second != 0)
+    const LoopConfig& loop_config = getLoopConfig(node);
+    if (!loop_config.unrolled || loop_config.unroll_factor != 0)
       continue;
     if (node->is_compute_op())
       node->set_microop(LLVM_IR_Move);
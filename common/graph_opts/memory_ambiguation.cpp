@@ -21,6 +21,7 @@ std::string MemoryAmbiguationOpt::getCenteredName(size_t size) {
 }
 
 void MemoryAmbiguationOpt::optimize() {
+  clearSourcesCache();
   std::vector<NewEdge> to_add_edges;
   EdgeNameMap edge_to_parid = get(boost::edge_name, graph);
   using gep_store_pair_t = std::pair<ExecNode*, ExecNode*>;
@@ -31,7 +32,7 @@ void MemoryAmbiguationOpt::optimize() {
     ExecNode* node = node_it->second;
     if (!node->is_memory_op() || !node->has_vertex())
       continue;
-    in_edge_iter in_edge_it, in_edge_end;
+    live_in_edge_iter in_edge_it, in_edge_end;
     for (boost::tie(in_edge_it, in_edge_end) =
              in_edges(node->get_vertex(), graph);
          in_edge_it != in_edge_end;
@@ -80,6 +81,7 @@ void MemoryAmbiguationOpt::optimize() {
     }
   }
 
+  clearSourcesCache();
   updateGraphWithNewEdges(to_add_edges);
 }
 
@@ -87,7 +89,16 @@ MemoryAddrSources MemoryAmbiguationOpt::findMemoryAddrSources(
     ExecNode* current_node,
     Function* current_func,
     EdgeNameMap& edge_to_parid) {
-  in_edge_iter in_edge_it, in_edge_end;
+  // The sources also depend on @current_func, so only searches within the
+  // function of the node itself are cached.
+  bool cacheable = current_node->get_static_function() == current_func;
+  if (cacheable) {
+    auto cached = sources_cache.find(current_node->get_node_id());
+    if (cached != sources_cache.end())
+      return cached->second;
+  }
+
+  live_in_edge_iter in_edge_it, in_edge_end;
   MemoryAddrSources sources;
   for (boost::tie(in_edge_it, in_edge_end) =
            in_edges(current_node->get_vertex(), graph);
@@ -116,5 +127,30 @@ MemoryAddrSources MemoryAmbiguationOpt::findMemoryAddrSources(
       current_node->get_static_function() == current_func)
     sources.add_noninductive(current_node);
   sources.sort_and_uniquify();
+  if (cacheable)
+    cacheSources(current_node, sources);
   return sources;
 }
+
+void MemoryAmbiguationOpt::cacheSources(const ExecNode* node,
+                                        const MemoryAddrSources& sources) {
+  size_t size = cachedSize(sources);
+  if (size > max_cached_sources ||
+      sources_cache.find(node->get_node_id()) != sources_cache.end())
+    return;
+  while (num_cached_sources + size > max_cached_sources) {
+    auto oldest = sources_cache.find(cached_nodes.front());
+    num_cached_sources -= cachedSize(oldest->second);
+    sources_cache.erase(oldest);
+    cached_nodes.pop_front();
+  }
+  sources_cache[node->get_node_id()] = sources;
+  cached_nodes.push_back(node->get_node_id());
+  num_cached_sources += size;
+}
+
+void MemoryAmbiguationOpt::clearSourcesCache() {
+  sources_cache.clear();
+  cached_nodes.clear();
+  num_cached_sources = 0;
+}
@@ -1,6 +1,10 @@
 #ifndef _MEMORY_AMBIGUATION_H_
 #define _MEMORY_AMBIGUATION_H_
 
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+
 #include "base_opt.h"
 
 /* A class to represent the sources of a memory address generation.
@@ -39,6 +43,10 @@ class MemoryAddrSources {
     return noninductive.empty() && inductive.empty();
   }
 
+  size_t size() const {
+    return noninductive.size() + inductive.size();
+  }
+
   void print_noninductive() const {
     std::cout << "Noninductive: [ ";
     for (auto node : noninductive) {
@@ -102,9 +110,42 @@ class MemoryAmbiguationOpt : public BaseAladdinOpt {
   // that are either loads and index adds and return a MemoryAddrSources object.
   // If no such parents are found, return the oldest ancestor that is a
   // non-inductive compute op.
+  //
+  // Results are memoized per node, since the GEPs of different stores often
+  // share ancestor chains.
   MemoryAddrSources findMemoryAddrSources(ExecNode* current_node,
                                           SrcTypes::Function* current_func,
                                           EdgeNameMap& edge_to_parid);
+
+ protected:
+  // Bound the total size of sources_cache. Each entry is charged at least one
+  // source, so that empty entries still count towards the bound.
+  void setMaxCachedSources(size_t max_sources) {
+    max_cached_sources = max_sources;
+  }
+
+  void cacheSources(const ExecNode* node, const MemoryAddrSources& sources);
+  void clearSourcesCache();
+
+  // Sources found so far, by node id.
+  std::unordered_map<unsigned, MemoryAddrSources> sources_cache;
+  // The ids of the nodes in sources_cache, oldest first.
+  std::deque<unsigned> cached_nodes;
+
+ private:
+  // The most source nodes kept in sources_cache by default. When it is full,
+  // the oldest entries are evicted first: they belong to the deepest ancestors
+  // of the GEPs searched so far, which later searches rarely reach again.
+  static const size_t kMaxCachedSources = 1 << 20;
+
+  // How much of an entry counts towards the bound.
+  static size_t cachedSize(const MemoryAddrSources& sources) {
+    return std::max<size_t>(1, sources.size());
+  }
+
+  size_t max_cached_sources = kMaxCachedSources;
+  // Total charged size of the entries in sources_cache.
+  size_t num_cached_sources = 0;
 };
 
 #endif
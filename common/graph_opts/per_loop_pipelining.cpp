@@ -99,7 +99,7 @@ void PerLoopPipelining::optimize() {
       // This pass just adds that new edge. The original edge will be removed
       // later.
       assert(prev_branch_node->has_vertex());
-      out_edge_iter out_edge_it, out_edge_end;
+      live_out_edge_iter out_edge_it, out_edge_end;
       for (boost::tie(out_edge_it, out_edge_end) =
                out_edges(prev_branch_node->get_vertex(), graph);
            out_edge_it != out_edge_end;
@@ -119,7 +119,7 @@ void PerLoopPipelining::optimize() {
       // iteration bounds (rather than branch nodes), so any dependences of
       // FNINs must be converted to control edges.
       assert(first_node->has_vertex());
-      in_edge_iter in_edge_it, in_edge_end;
+      live_in_edge_iter in_edge_it, in_edge_end;
       for (boost::tie(in_edge_it, in_edge_end) =
                in_edges(first_node->get_vertex(), graph);
            in_edge_it != in_edge_end;
@@ -25,7 +25,7 @@ void PhiNodeRemoval::optimize() {
     Vertex node_vertex = node->get_vertex();
     // find its children
     std::vector<std::pair<ExecNode*, int>> phi_child;
-    out_edge_iter out_edge_it, out_edge_end;
+    live_out_edge_iter out_edge_it, out_edge_end;
     for (boost::tie(out_edge_it, out_edge_end) = out_edges(node_vertex, graph);
          out_edge_it != out_edge_end;
          ++out_edge_it) {
@@ -41,7 +41,7 @@ void PhiNodeRemoval::optimize() {
       // find its first non-phi ancestor.
       // phi node can have multiple children, but it can only have one parent.
       assert(boost::in_degree(node_vertex, graph) == 1);
-      in_edge_iter in_edge_it = in_edges(node_vertex, graph).first;
+      live_in_edge_iter in_edge_it = in_edges(node_vertex, graph).first;
       Vertex parent_vertex = source(*in_edge_it, graph);
       ExecNode* nonphi_ancestor = getNodeFromVertex(parent_vertex);
       // Search for the first non-phi ancestor of the current phi node.
@@ -70,7 +70,7 @@ void PhiNodeRemoval::optimize() {
     } else {
       // convert nodes
       assert(boost::in_degree(node_vertex, graph) == 1);
-      in_edge_iter in_edge_it = in_edges(node_vertex, graph).first;
+      live_in_edge_iter in_edge_it = in_edges(node_vertex, graph).first;
       Vertex parent_vertex = source(*in_edge_it, graph);
       ExecNode* nonphi_ancestor = getNodeFromVertex(parent_vertex);
       while (nonphi_ancestor->is_convert_op()) {
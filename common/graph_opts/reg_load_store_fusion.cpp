@@ -35,7 +35,7 @@ void RegLoadStoreFusion::optimize() {
 
     if (node->is_load_op()) {
       Vertex load_vertex = node->get_vertex();
-      out_edge_iter out_edge_it, out_edge_end;
+      live_out_edge_iter out_edge_it, out_edge_end;
       for (boost::tie(out_edge_it, out_edge_end) = out_edges(load_vertex, graph);
            out_edge_it != out_edge_end;
            ++out_edge_it) {
@@ -53,7 +53,7 @@ void RegLoadStoreFusion::optimize() {
       }
     } else if (node->is_store_op()) {
       Vertex store_vertex = node->get_vertex();
-      in_edge_iter in_edge_it, in_edge_end;
+      live_in_edge_iter in_edge_it, in_edge_end;
       for (boost::tie(in_edge_it, in_edge_end) = in_edges(store_vertex, graph);
            in_edge_it != in_edge_end;
            ++in_edge_it) {
@@ -45,7 +45,7 @@ void RepeatedStoreRemoval::optimize() {
             removed_stores++;
           } else {
             int num_of_real_children = 0;
-            out_edge_iter out_edge_it, out_edge_end;
+            live_out_edge_iter out_edge_it, out_edge_end;
             for (boost::tie(out_edge_it, out_edge_end) =
                      out_edges(node->get_vertex(), graph);
                  out_edge_it != out_edge_end;
@@ -10,29 +10,31 @@ void StoreBuffering::optimize() {
 
   EdgeNameMap edge_to_parid = get(boost::edge_name, graph);
 
-  std::vector<NewEdge> to_add_edges;
-  std::vector<unsigned> to_remove_nodes;
+  // Stores are only forwarded to loads in the same loop region, so the
+  // regions are analyzed independently and their edits are merged in region
+  // order.
+  std::vector<ExecNodeMap::iterator> regions = findLoopRegions();
+  size_t num_regions = regions.size() - 1;
+  std::vector<std::vector<NewEdge>> region_add_edges(num_regions);
+  std::vector<std::vector<unsigned>> region_remove_nodes(num_regions);
 
-  auto bound_it = loop_bounds.begin();
-  auto node_it = exec_nodes.begin();
-
-  while (node_it != exec_nodes.end()) {
-    while (node_it->first < bound_it->node_id && node_it != exec_nodes.end()) {
+  forEachRegion(num_regions, [&](size_t region) {
+    std::vector<NewEdge>& to_add_edges = region_add_edges[region];
+    std::vector<unsigned>& to_remove_nodes = region_remove_nodes[region];
+    unsigned region_end = loop_bounds[region].node_id;
+    for (auto node_it = regions[region]; node_it != regions[region + 1];
+         ++node_it) {
       ExecNode* node = node_it->second;
       if (!node->has_vertex() ||
-          boost::degree(node->get_vertex(), graph) == 0) {
-        ++node_it;
+          boost::degree(node->get_vertex(), graph) == 0)
         continue;
-      }
       if (node->is_store_op()) {
         // remove this store, unless it is a dynamic store which cannot be
         // statically disambiguated.
-        if (node->is_dynamic_mem_op()) {
-          ++node_it;
+        if (node->is_dynamic_mem_op())
           continue;
-        }
         Vertex node_vertex = node->get_vertex();
-        out_edge_iter out_edge_it, out_edge_end;
+        live_out_edge_iter out_edge_it, out_edge_end;
 
         std::vector<Vertex> store_child;
         for (boost::tie(out_edge_it, out_edge_end) =
@@ -43,7 +45,7 @@ void StoreBuffering::optimize() {
           ExecNode* child_node = getNodeFromVertex(child_vertex);
           if (child_node->is_load_op()) {
             if (child_node->is_dynamic_mem_op() ||
-                child_node->get_node_id() >= (unsigned)bound_it->node_id)
+                child_node->get_node_id() >= region_end)
               continue;
             else
               store_child.push_back(child_vertex);
@@ -53,7 +55,7 @@ void StoreBuffering::optimize() {
         if (store_child.size() > 0) {
           bool parent_found = false;
           Vertex store_parent;
-          in_edge_iter in_edge_it, in_edge_end;
+          live_in_edge_iter in_edge_it, in_edge_end;
           for (boost::tie(in_edge_it, in_edge_end) =
                    in_edges(node_vertex, graph);
                in_edge_it != in_edge_end;
@@ -73,7 +75,7 @@ void StoreBuffering::optimize() {
               Vertex load_node = *load_it;
               to_remove_nodes.push_back(vertex_to_name[load_node]);
 
-              out_edge_iter out_edge_it, out_edge_end;
+              live_out_edge_iter out_edge_it, out_edge_end;
               for (boost::tie(out_edge_it, out_edge_end) =
                        out_edges(load_node, graph);
                    out_edge_it != out_edge_end;
@@ -87,11 +89,18 @@ void StoreBuffering::optimize() {
           }
         }
       }
-      ++node_it;
     }
-    ++bound_it;
-    if (bound_it == loop_bounds.end())
-      break;
+  });
+
+  std::vector<NewEdge> to_add_edges;
+  std::vector<unsigned> to_remove_nodes;
+  for (size_t region = 0; region < num_regions; region++) {
+    to_add_edges.insert(to_add_edges.end(),
+                        region_add_edges[region].begin(),
+                        region_add_edges[region].end());
+    to_remove_nodes.insert(to_remove_nodes.end(),
+                           region_remove_nodes[region].begin(),
+                           region_remove_nodes[region].end());
   }
   updateGraphWithNewEdges(to_add_edges);
   updateGraphWithIsolatedNodes(to_remove_nodes);
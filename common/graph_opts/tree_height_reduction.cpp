@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "tree_height_reduction.h"
 
 #include "../DDDG.h"
@@ -10,8 +12,6 @@ void TreeHeightReduction::optimize() {
   if (loop_bounds.size() <= 2)
     return;
 
-  EdgeNameMap edge_to_parid = get(boost::edge_name, graph);
-
   begin_node_id = exec_nodes.begin()->first;
   end_node_id = (--exec_nodes.end())->first + 1;
 
@@ -35,143 +35,179 @@ void TreeHeightReduction::optimize() {
         break;
     }
     node_it++;
+    if (node_it == exec_nodes.end())
+      break;
     node_id = node_it->first;
   }
 
+  // Chains are only followed within a region, so the regions are analyzed
+  // independently. Within a region, nodes are visited bottom nodes first.
+  std::vector<std::vector<ExecNode*>> region_nodes(region_id + 1);
+  for (auto node_it = exec_nodes.rbegin(); node_it != exec_nodes.rend();
+       ++node_it)
+    region_nodes[bound_region.at(node_it->first)].push_back(node_it->second);
+  std::vector<std::vector<TreeEdits>> region_edits(region_nodes.size());
+
+  forEachRegion(region_nodes.size(), [&](size_t region) {
+    for (ExecNode* node : region_nodes[region]) {
+      if (!node->has_vertex() ||
+          boost::degree(node->get_vertex(), graph) == 0 ||
+          updated.at(node->get_node_id()) || !node->is_associative())
+        continue;
+      TreeEdits edits = { node->get_node_id() };
+      if (rebalanceTree(node, bound_region, updated, edits))
+        region_edits[region].push_back(std::move(edits));
+    }
+  });
+
+  // Merge the edits in the order the trees were found in: from the highest
+  // node id down.
+  std::vector<TreeEdits*> all_edits;
+  for (auto& edits : region_edits) {
+    for (auto& tree : edits)
+      all_edits.push_back(&tree);
+  }
+  std::sort(all_edits.begin(), all_edits.end(),
+            [](const TreeEdits* a, const TreeEdits* b) {
+              return a->root_id > b->root_id;
+            });
   std::set<Edge> to_remove_edges;
   std::vector<NewEdge> to_add_edges;
+  for (TreeEdits* tree : all_edits) {
+    to_remove_edges.insert(tree->remove_edges.begin(),
+                           tree->remove_edges.end());
+    to_add_edges.insert(to_add_edges.end(), tree->add_edges.begin(),
+                        tree->add_edges.end());
+  }
+  /*For tree reduction, we always remove edges first, then add edges. The reason
+   * is that it's possible that we are adding the same edges as the edges that
+   * we want to remove. Doing adding edges first then removing edges could lead
+   * to losing dependences.*/
+  updateGraphWithIsolatedEdges(to_remove_edges);
+  updateGraphWithNewEdges(to_add_edges);
+  cleanLeafNodes();
+}
 
-  // nodes with no outgoing edges to first (bottom nodes first)
-  for (auto node_it = exec_nodes.rbegin(); node_it != exec_nodes.rend();
-       ++node_it) {
-    ExecNode* node = node_it->second;
-    if (!node->has_vertex() || boost::degree(node->get_vertex(), graph) == 0 ||
-        updated.at(node->get_node_id()) || !node->is_associative())
-      continue;
-    unsigned node_id = node->get_node_id();
-    updated.at(node_id) = 1;
-    int node_region = bound_region.at(node_id);
-
-    std::list<ExecNode*> nodes;
-    std::vector<Edge> tmp_remove_edges;
-    std::vector<std::pair<ExecNode*, bool>> leaves;
-    std::vector<ExecNode*> associative_chain;
-    associative_chain.push_back(node);
-    unsigned chain_id = 0;
-    while (chain_id < associative_chain.size()) {
-      ExecNode* chain_node = associative_chain[chain_id];
-      if (chain_node->is_associative()) {
-        updated.at(chain_node->get_node_id()) = 1;
-        int num_of_chain_parents = 0;
-        in_edge_iter in_edge_it, in_edge_end;
+bool TreeHeightReduction::rebalanceTree(
+    ExecNode* node,
+    const std::map<unsigned, int>& bound_region,
+    std::map<unsigned, bool>& updated,
+    TreeEdits& edits) {
+  EdgeNameMap edge_to_parid = get(boost::edge_name, graph);
+  unsigned node_id = node->get_node_id();
+  updated.at(node_id) = 1;
+  int node_region = bound_region.at(node_id);
+
+  std::list<ExecNode*> nodes;
+  std::vector<Edge> tmp_remove_edges;
+  std::vector<std::pair<ExecNode*, bool>> leaves;
+  std::vector<ExecNode*> associative_chain;
+  associative_chain.push_back(node);
+  unsigned chain_id = 0;
+  while (chain_id < associative_chain.size()) {
+    ExecNode* chain_node = associative_chain[chain_id];
+    if (chain_node->is_associative()) {
+      updated.at(chain_node->get_node_id()) = 1;
+      int num_of_chain_parents = 0;
+      live_in_edge_iter in_edge_it, in_edge_end;
+      for (boost::tie(in_edge_it, in_edge_end) =
+               in_edges(chain_node->get_vertex(), graph);
+           in_edge_it != in_edge_end;
+           ++in_edge_it) {
+        if (edge_to_parid[*in_edge_it] == CONTROL_EDGE)
+          continue;
+        num_of_chain_parents++;
+      }
+      if (num_of_chain_parents == 2) {
+        nodes.push_front(chain_node);
         for (boost::tie(in_edge_it, in_edge_end) =
                  in_edges(chain_node->get_vertex(), graph);
              in_edge_it != in_edge_end;
              ++in_edge_it) {
           if (edge_to_parid[*in_edge_it] == CONTROL_EDGE)
             continue;
-          num_of_chain_parents++;
-        }
-        if (num_of_chain_parents == 2) {
-          nodes.push_front(chain_node);
-          for (boost::tie(in_edge_it, in_edge_end) =
-                   in_edges(chain_node->get_vertex(), graph);
-               in_edge_it != in_edge_end;
-               ++in_edge_it) {
-            if (edge_to_parid[*in_edge_it] == CONTROL_EDGE)
-              continue;
-            Vertex parent_vertex = source(*in_edge_it, graph);
-            int parent_id = vertex_to_name[parent_vertex];
-            ExecNode* parent_node = getNodeFromVertex(parent_vertex);
-            assert(*parent_node < *chain_node);
-
-            Edge curr_edge = *in_edge_it;
-            tmp_remove_edges.push_back(curr_edge);
-            int parent_region = bound_region.at(parent_id);
-            if (parent_region == node_region) {
-              updated.at(parent_id) = 1;
-              if (!parent_node->is_associative())
-                leaves.push_back(std::make_pair(parent_node, false));
-              else {
-                out_edge_iter out_edge_it, out_edge_end;
-                int num_of_children = 0;
-                for (boost::tie(out_edge_it, out_edge_end) =
-                         out_edges(parent_vertex, graph);
-                     out_edge_it != out_edge_end;
-                     ++out_edge_it) {
-                  if (edge_to_parid[*out_edge_it] != CONTROL_EDGE)
-                    num_of_children++;
-                }
-
-                if (num_of_children == 1)
-                  associative_chain.push_back(parent_node);
-                else
-                  leaves.push_back(std::make_pair(parent_node, false));
+          Vertex parent_vertex = source(*in_edge_it, graph);
+          int parent_id = vertex_to_name[parent_vertex];
+          ExecNode* parent_node = getNodeFromVertex(parent_vertex);
+          assert(*parent_node < *chain_node);
+
+          Edge curr_edge = *in_edge_it;
+          tmp_remove_edges.push_back(curr_edge);
+          int parent_region = bound_region.at(parent_id);
+          if (parent_region == node_region) {
+            updated.at(parent_id) = 1;
+            if (!parent_node->is_associative())
+              leaves.push_back(std::make_pair(parent_node, false));
+            else {
+              live_out_edge_iter out_edge_it, out_edge_end;
+              int num_of_children = 0;
+              for (boost::tie(out_edge_it, out_edge_end) =
+                       out_edges(parent_vertex, graph);
+                   out_edge_it != out_edge_end;
+                   ++out_edge_it) {
+                if (edge_to_parid[*out_edge_it] != CONTROL_EDGE)
+                  num_of_children++;
               }
-            } else {
-              leaves.push_back(std::make_pair(parent_node, true));
+
+              if (num_of_children == 1)
+                associative_chain.push_back(parent_node);
+              else
+                leaves.push_back(std::make_pair(parent_node, false));
             }
+          } else {
+            leaves.push_back(std::make_pair(parent_node, true));
           }
-        } else {
-          /* Promote the single parent node with higher priority. This affects
-           * mostly the top of the graph where no parent exists. */
-          leaves.push_back(std::make_pair(chain_node, true));
         }
       } else {
-        leaves.push_back(std::make_pair(chain_node, false));
+        /* Promote the single parent node with higher priority. This affects
+         * mostly the top of the graph where no parent exists. */
+        leaves.push_back(std::make_pair(chain_node, true));
       }
-      chain_id++;
+    } else {
+      leaves.push_back(std::make_pair(chain_node, false));
     }
-    // build the tree
-    if (nodes.size() < 3)
-      continue;
-    for (auto it = tmp_remove_edges.begin(), E = tmp_remove_edges.end();
-         it != E;
-         it++)
-      to_remove_edges.insert(*it);
-
-    std::map<ExecNode*, unsigned> rank_map;
-    auto leaf_it = leaves.begin();
-
-    while (leaf_it != leaves.end()) {
-      if (leaf_it->second == false)
-        rank_map[leaf_it->first] = begin_node_id;
-      else
-        rank_map[leaf_it->first] = end_node_id;
-      ++leaf_it;
-    }
-    // reconstruct the rest of the balanced tree
-    // TODO: Find a better name for this.
-    auto new_node_it = nodes.begin();
-    while (new_node_it != nodes.end()) {
-      ExecNode* node1 = nullptr;
-      ExecNode* node2 = nullptr;
-      if (rank_map.size() == 2) {
-        node1 = rank_map.begin()->first;
-        node2 = (++rank_map.begin())->first;
-      } else {
-        findMinRankNodes(&node1, &node2, rank_map);
-      }
-      // TODO: Is this at all possible...?
-      assert((node1->get_node_id() != end_node_id) &&
-             (node2->get_node_id() != end_node_id));
-      to_add_edges.push_back({ node1, *new_node_it, 1 });
-      to_add_edges.push_back({ node2, *new_node_it, 1 });
-
-      // place the new node in the map, remove the two old nodes
-      rank_map[*new_node_it] = std::max(rank_map[node1], rank_map[node2]) + 1;
-      rank_map.erase(node1);
-      rank_map.erase(node2);
-      ++new_node_it;
+    chain_id++;
+  }
+  // build the tree
+  if (nodes.size() < 3)
+    return false;
+  edits.remove_edges = std::move(tmp_remove_edges);
+
+  std::map<ExecNode*, unsigned> rank_map;
+  auto leaf_it = leaves.begin();
+
+  while (leaf_it != leaves.end()) {
+    if (leaf_it->second == false)
+      rank_map[leaf_it->first] = begin_node_id;
+    else
+      rank_map[leaf_it->first] = end_node_id;
+    ++leaf_it;
+  }
+  // reconstruct the rest of the balanced tree
+  // TODO: Find a better name for this.
+  auto new_node_it = nodes.begin();
+  while (new_node_it != nodes.end()) {
+    ExecNode* node1 = nullptr;
+    ExecNode* node2 = nullptr;
+    if (rank_map.size() == 2) {
+      node1 = rank_map.begin()->first;
+      node2 = (++rank_map.begin())->first;
+    } else {
+      findMinRankNodes(&node1, &node2, rank_map);
     }
+    // TODO: Is this at all possible...?
+    assert((node1->get_node_id() != end_node_id) &&
+           (node2->get_node_id() != end_node_id));
+    edits.add_edges.push_back({ node1, *new_node_it, 1 });
+    edits.add_edges.push_back({ node2, *new_node_it, 1 });
+
+    // place the new node in the map, remove the two old nodes
+    rank_map[*new_node_it] = std::max(rank_map[node1], rank_map[node2]) + 1;
+    rank_map.erase(node1);
+    rank_map.erase(node2);
+    ++new_node_it;
   }
-  /*For tree reduction, we always remove edges first, then add edges. The reason
-   * is that it's possible that we are adding the same edges as the edges that
-   * we want to remove. Doing adding edges first then removing edges could lead
-   * to losing dependences.*/
-  updateGraphWithIsolatedEdges(to_remove_edges);
-  updateGraphWithNewEdges(to_add_edges);
-  cleanLeafNodes();
+  return true;
 }
 
 void TreeHeightReduction::findMinRankNodes(
@@ -10,6 +10,23 @@ class TreeHeightReduction : public BaseAladdinOpt {
   virtual std::string getCenteredName(size_t size);
 
  protected:
+  // The edits that rebalance the tree of one associative chain.
+  struct TreeEdits {
+    // The bottom node of the chain.
+    unsigned root_id;
+    std::vector<Edge> remove_edges;
+    std::vector<NewEdge> add_edges;
+  };
+
+  /* Find the associative chain that ends at @node and record the edits that
+   * turn it into a balanced tree in @edits. Only the nodes in the same region
+   * as @node are marked as @updated. Returns false if the chain is too short
+   * to rebalance.
+   */
+  bool rebalanceTree(ExecNode* node,
+                     const std::map<unsigned, int>& bound_region,
+                     std::map<unsigned, bool>& updated,
+                     TreeEdits& edits);
   void findMinRankNodes(ExecNode** node1,
                         ExecNode** node2,
                         std::map<ExecNode*, unsigned>& rank_map);
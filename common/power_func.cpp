@@ -1,5 +1,10 @@
+#include <mutex>
+
 #include "power_func.h"
 
+// CACTI keeps its parameters in globals, so only one query can run at a time.
+static std::mutex cacti_mutex;
+
 void getRegisterPowerArea(float cycle_time,
                           float* internal_power_per_bit,
                           float* switch_power_per_bit,
@@ -635,6 +640,7 @@ uca_org_t cactiWrapper(unsigned num_of_bytes, unsigned wordsize, unsigned num_po
   int ndsam1 = 0;
   int ndsam2 = 0;
   int ecc = 0;
+  std::lock_guard<std::mutex> lock(cacti_mutex);
   return cacti_interface(cache_size,
                          line_size,
                          associativity,
@@ -0,0 +1,215 @@
+/* Converts an LLVM-Tracer text trace into the binary trace format.
+ *
+ * The output is gzip compressed if its file name ends in ".gz", and written
+ * uncompressed otherwise. Aladdin detects binary traces automatically, so the
+ * converted trace can be passed to aladdin in place of the text trace.
+ *
+ * The converter follows the same rules as DDDG::build_initial_dddg() for
+ * finding the labelmap section and the end of each top level invocation, so
+ * the binary trace produces exactly the same DDDGs as the original.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <boost/tokenizer.hpp>
+
+#include "BinaryTrace.h"
+#include "DDDG.h"
+#include "TraceReader.h"
+#include "opcode_func.h"
+
+static bool endsWith(const std::string& str, const std::string& suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static void convertLabelmapLine(BinaryTraceWriter& writer,
+                                const std::string& line) {
+  char label_name[256], function_name[256], callers[256];
+  int line_number;
+  int num_matches = sscanf(line.c_str(),
+                           "%[^/]/%s %d inline %[^\n]",
+                           function_name,
+                           label_name,
+                           &line_number,
+                           callers);
+  label_name[255] = '\0';
+  function_name[255] = '\0';
+  std::vector<std::string> caller_names;
+  if (num_matches == 4) {
+    boost::char_separator<char> sep(" ");
+    std::string temp(callers);
+    boost::tokenizer<boost::char_separator<char>> tok(temp, sep);
+    for (auto it = tok.begin(); it != tok.end(); ++it)
+      caller_names.push_back(*it);
+  }
+  writer.writeLabelMapEntry(
+      function_name, label_name, line_number, caller_names);
+}
+
+int main(int argc, const char* argv[]) {
+  if (argc < 3) {
+    std::cout << "-------------------------------" << std::endl;
+    std::cout << "trace_converter takes:         " << std::endl;
+    std::cout << "./trace_converter <text trace> <binary trace>" << std::endl;
+    std::cout << "   The binary trace is gzip compressed if its name ends \n"
+              << "   with \".gz\"." << std::endl;
+    std::cout << "-------------------------------" << std::endl;
+    exit(0);
+  }
+  std::string input_name(argv[1]);
+  std::string output_name(argv[2]);
+
+  gzFile input = gzopen(input_name.c_str(), "r");
+  if (!input) {
+    std::cerr << "ERROR: Cannot open input trace " << input_name << std::endl;
+    exit(1);
+  }
+  if (BinaryTraceReader::isBinaryTrace(input)) {
+    std::cerr << "ERROR: " << input_name << " is already a binary trace."
+              << std::endl;
+    exit(1);
+  }
+  gzFile output =
+      gzopen(output_name.c_str(), endsWith(output_name, ".gz") ? "wb" : "wT");
+  if (!output) {
+    std::cerr << "ERROR: Cannot open output trace " << output_name
+              << std::endl;
+    exit(1);
+  }
+
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+
+  BinaryTraceWriter writer(output);
+  writer.writeHeader();
+
+  std::unique_ptr<TraceLineReader> reader(new TraceLineReader(input));
+  char* buffer;
+  size_t len;
+  std::string first_function;
+  bool seen_first_line = false;
+  bool first_function_returned = false;
+  bool in_labelmap_section = false;
+  bool labelmap_parsed_or_not_present = false;
+  int curr_microop = -1;
+  unsigned long num_lines = 0;
+  unsigned long num_invocations = 0;
+
+  while ((buffer = reader->getline(&len)) != NULL) {
+    num_lines++;
+
+    if (!labelmap_parsed_or_not_present) {
+      if (!in_labelmap_section) {
+        if (strstr(buffer, "%%%% LABEL MAP START %%%%") != NULL) {
+          in_labelmap_section = true;
+          continue;
+        }
+      } else {
+        if (strstr(buffer, "%%%% LABEL MAP END %%%%") != NULL) {
+          labelmap_parsed_or_not_present = true;
+          in_labelmap_section = false;
+          continue;
+        }
+        convertLabelmapLine(writer, std::string(buffer, len));
+      }
+    }
+    if (memchr(buffer, ',', len) == NULL) {
+      if (first_function_returned) {
+        // This is where the text parser stops reading the current invocation.
+        writer.writeEndOfInvocation();
+        num_invocations++;
+        seen_first_line = false;
+        first_function_returned = false;
+        in_labelmap_section = false;
+        labelmap_parsed_or_not_present = false;
+      }
+      continue;
+    }
+    labelmap_parsed_or_not_present = true;
+    TraceLineTokenizer line(buffer, len);
+    const char* tag = line.next_field();
+    if (strcmp(tag, "0") == 0) {
+      int line_num = line.next_int();
+      char* func = line.next_field();
+      char* bblockid = line.next_field();
+      char* instid = line.next_field();
+      int microop = line.next_int();
+      long node_id = line.next_int();
+      if (!seen_first_line) {
+        seen_first_line = true;
+        first_function = func;
+      }
+      first_function_returned =
+          microop == LLVM_IR_Ret && first_function == func;
+      curr_microop = microop;
+      writer.writeInstruction(
+          line_num, func, bblockid, instid, microop, node_id);
+    } else if (strcmp(tag, "f") == 0) {
+      int size = line.next_int();
+      line.skip_field();  // Value.
+      int is_reg = line.next_int();
+      writer.writeForward(size, is_reg, line.next_field());
+    } else if (strcmp(tag, "entry") == 0) {
+      char* func = line.next_field();
+      int num_parameters = line.next_int();
+      curr_microop = LLVM_IR_EntryDecl;
+      writer.writeEntryDecl(func, num_parameters);
+    } else {
+      // Results and parameters.
+      int size = line.next_int();
+      char* char_value = line.next_field();
+      int is_reg = line.next_int();
+      char* label = line.next_field();
+      Value value(char_value, size);
+      if (strcmp(tag, "r") == 0) {
+        writer.writeResult(size, value, is_reg, label);
+        continue;
+      }
+      std::string prev_bblock;
+      bool has_prev_bblock = false;
+      if (curr_microop == LLVM_IR_PHI) {
+        size_t prev_bbid_len;
+        char* prev_bbid = line.next_field(&prev_bbid_len);
+        if (prev_bbid_len > 0) {
+          prev_bblock = prev_bbid;
+          has_prev_bblock = true;
+        }
+      }
+      writer.writeParameter(TraceLineTokenizer::parse_int(tag),
+                            size,
+                            value,
+                            is_reg,
+                            label,
+                            has_prev_bblock ? &prev_bblock : nullptr);
+    }
+  }
+  if (seen_first_line)
+    num_invocations++;
+  writer.flush();
+  reader->print_stats(std::cout);
+  // Stop the decompressor before closing the input.
+  reader.reset();
+  gzclose(input);
+  gzclose(output);
+
+  gettimeofday(&end, NULL);
+  double elapsed =
+      (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 1e-6;
+
+  struct stat input_st, output_st;
+  stat(input_name.c_str(), &input_st);
+  stat(output_name.c_str(), &output_st);
+  std::cout << "-------------------------------" << std::endl;
+  std::cout << "Converted " << num_lines << " lines into "
+            << writer.getNumRecords() << " records in " << elapsed << " s."
+            << std::endl;
+  std::cout << "Invocations: " << num_invocations << std::endl;
+  std::cout << "Unique strings: " << writer.getNumStrings() << std::endl;
+  std::cout << "Input size: " << input_st.st_size << " bytes" << std::endl;
+  std::cout << "Output size: " << output_st.st_size << " bytes" << std::endl;
+  std::cout << "-------------------------------" << std::endl;
+  return 0;
+}
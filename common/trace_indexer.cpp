@@ -0,0 +1,58 @@
+/* Builds the invocation index of a text trace.
+ *
+ * The index is saved next to the trace as <trace>.idx. Aladdin builds it
+ * automatically the first time invocations are selected with the
+ * "invocations" config directive, but large traces can be indexed ahead of
+ * time with this tool.
+ */
+
+#include <iostream>
+#include <sys/time.h>
+
+#include "TraceIndex.h"
+
+int main(int argc, const char* argv[]) {
+  if (argc < 2) {
+    std::cout << "-------------------------------" << std::endl;
+    std::cout << "trace_indexer takes:           " << std::endl;
+    std::cout << "./trace_indexer <text trace> [-v]" << std::endl;
+    std::cout << "   -v lists the offset of every invocation." << std::endl;
+    std::cout << "-------------------------------" << std::endl;
+    exit(0);
+  }
+  std::string trace_name(argv[1]);
+  bool verbose = argc > 2 && std::string(argv[2]) == "-v";
+
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  TraceIndex index;
+  if (!index.build(trace_name))
+    exit(1);
+  std::string index_name = TraceIndex::indexFileName(trace_name);
+  if (!index.save(index_name)) {
+    std::cerr << "ERROR: Cannot write the index to " << index_name
+              << std::endl;
+    exit(1);
+  }
+  gettimeofday(&end, NULL);
+  double elapsed =
+      (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 1e-6;
+
+  std::cout << "-------------------------------" << std::endl;
+  std::cout << "Indexed " << trace_name << " in " << elapsed << " s."
+            << std::endl;
+  std::cout << "Invocations: " << index.getNumInvocations() << std::endl;
+  std::cout << "Uncompressed size: " << index.getUncompressedSize()
+            << " bytes" << std::endl;
+  if (index.isGzipped())
+    std::cout << "Access points: " << index.getNumAccessPoints() << std::endl;
+  if (verbose) {
+    for (unsigned i = 0; i < index.getNumInvocations(); i++) {
+      std::cout << "  " << i << ": offset " << index.getInvocation(i).offset
+                << std::endl;
+    }
+  }
+  std::cout << "Index: " << index_name << std::endl;
+  std::cout << "-------------------------------" << std::endl;
+  return 0;
+}
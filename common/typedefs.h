@@ -52,6 +52,5 @@ typedef std::unordered_map<SrcTypes::UniqueLabel, SrcTypes::UniqueLabel>
     inline_labelmap_t;
 typedef std::pair<ExecNode*, ExecNode*> node_pair_t;
 typedef std::pair<const ExecNode*, const ExecNode*> cnode_pair_t;
-typedef std::map<unsigned, ExecNode*> ExecNodeMap;
 
 #endif
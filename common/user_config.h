@@ -29,7 +29,11 @@ class UserConfigParams {
  public:
   UserConfigParams()
       : cycle_time(1), ready_mode(false), scratchpad_ports(1),
-        global_pipelining(false) {}
+        global_pipelining(false), select_invocations(false),
+        first_invocation(0), last_invocation(0), parallel_invocations(1),
+        graph_opt_threads(1), stream_window(0), event_driven(false),
+        sampling(false), sampled_function(nullptr), sampled_label(nullptr),
+        sampling_warmup(0), sampling_window(0), sampling_period(0) {}
 
   partition_config_t::const_iterator getArrayConfig(Addr addr) const {
     auto part_it = partition.begin();
@@ -57,6 +61,31 @@ class UserConfigParams {
   bool ready_mode;
   unsigned scratchpad_ports;
   bool global_pipelining;
+  // Only simulate the top-level invocations in the trace from
+  // first_invocation to last_invocation (inclusive, counting from 0).
+  bool select_invocations;
+  unsigned first_invocation;
+  unsigned last_invocation;
+  // Number of invocations to simulate concurrently.
+  unsigned parallel_invocations;
+  // Number of threads the graph optimizations can analyze loop regions on.
+  unsigned graph_opt_threads;
+  // Schedule the trace while it is parsed, keeping this many recent nodes in
+  // memory. Zero builds and optimizes the whole graph first.
+  unsigned stream_window;
+  // Skip the cycles in which the only nodes executing are multicycle nodes
+  // that are not done yet.
+  bool event_driven;
+  // Only simulate some iterations of the loop sampled_label in
+  // sampled_function: the first sampling_warmup iterations of each execution
+  // of the loop, then sampling_window out of every sampling_period iterations.
+  // The others are extrapolated from the sampled ones.
+  bool sampling;
+  SrcTypes::Function* sampled_function;
+  SrcTypes::Label* sampled_label;
+  unsigned sampling_warmup;
+  unsigned sampling_window;
+  unsigned sampling_period;
 };
 
 
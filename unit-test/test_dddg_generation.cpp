@@ -76,3 +76,21 @@ SCENARIO("Test DDDG Generation w/ aes", "[aes]") {
     }
   }
 }
+
+SCENARIO("Test DDDG Generation w/ Binary Trace", "[binary_trace]") {
+  GIVEN("Test Triad w/ Input Size 128 converted to a binary trace") {
+    std::string bench("outputs/triad-128-bin");
+    std::string trace_file("inputs/triad-128-trace-bin.gz");
+    std::string config_file("inputs/config-triad-p2-u2-P1");
+
+    ScratchpadDatapath* acc;
+    WHEN("DDDG is generated.") {
+      acc = new ScratchpadDatapath(bench, trace_file, config_file);
+      acc->buildDddg();
+      THEN("The Graph Size should match the text trace.") {
+        REQUIRE(acc->getProgram().getNumNodes() == 1538);
+        REQUIRE(acc->getProgram().getNumEdges() == 3328);
+      }
+    }
+  }
+}
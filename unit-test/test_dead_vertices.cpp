@@ -0,0 +1,67 @@
+#include "catch.hpp"
+#include "DDDG.h"
+#include "graph_opts/base_opt.h"
+
+// Exposes the graph editing functions shared by the optimizations.
+class GraphEditOpt : public BaseAladdinOpt {
+ public:
+  using BaseAladdinOpt::BaseAladdinOpt;
+  using BaseAladdinOpt::NewEdge;
+  using BaseAladdinOpt::updateGraphWithNewEdges;
+  using BaseAladdinOpt::updateGraphWithIsolatedNodes;
+  virtual void optimize() {}
+  virtual std::string getCenteredName(size_t size) { return ""; }
+};
+
+SCENARIO("Test removing nodes by marking their vertices dead",
+         "[dead_vertices]") {
+  GIVEN("A graph with the edges 0->1, 0->2, 1->2 and 2->3") {
+    Program program;
+    SrcTypes::SourceManager src_manager;
+    UserConfigParams user_params;
+    for (unsigned id = 0; id < 4; id++)
+      program.insertNode(id, LLVM_IR_Add);
+    program.createVertexMap();
+    program.addEdge(0, 1, REGISTER_EDGE);
+    program.addEdge(0, 2, CONTROL_EDGE);
+    program.addEdge(1, 2, REGISTER_EDGE);
+    program.addEdge(2, 3, REGISTER_EDGE);
+    GraphEditOpt opt(program, src_manager, user_params);
+
+    WHEN("Node 1 is removed") {
+      std::vector<unsigned> to_remove_nodes = { 1, 1 };
+      opt.updateGraphWithIsolatedNodes(to_remove_nodes);
+      THEN("Its edges are hidden but still stored.") {
+        REQUIRE(program.getNumConnectedNodes(1) == 0);
+        REQUIRE_FALSE(program.edgeExists(0, 1));
+        REQUIRE_FALSE(program.edgeExists(1, 2));
+        REQUIRE(program.getParentNodes(2) == std::vector<unsigned>({ 0 }));
+        REQUIRE(program.getNumEdges() == 2);
+        REQUIRE(boost::num_edges(program.graph) == 4);
+        REQUIRE(program.edit_counts.nodes_removed == 1);
+        REQUIRE(program.edit_counts.edges_removed == 2);
+      }
+      THEN("Compacting the graph drops them and keeps the others.") {
+        program.compactGraph();
+        REQUIRE(boost::num_edges(program.graph) == 2);
+        REQUIRE(boost::degree(1, program.graph) == 0);
+        REQUIRE(program.getNumEdges() == 2);
+        REQUIRE(program.getEdgeWeight(0, 2) == CONTROL_EDGE);
+        REQUIRE(program.getEdgeWeight(2, 3) == REGISTER_EDGE);
+        REQUIRE(program.vertex_to_name[3] == 3);
+      }
+      THEN("Adding an edge to it brings it back without its old edges.") {
+        std::vector<GraphEditOpt::NewEdge> to_add_edges = {
+          { program.nodes.at(1), program.nodes.at(3), CONTROL_EDGE }
+        };
+        opt.updateGraphWithNewEdges(to_add_edges);
+        REQUIRE(program.getNumConnectedNodes(1) == 1);
+        REQUIRE(program.edgeExists(1, 3));
+        REQUIRE_FALSE(program.edgeExists(0, 1));
+        REQUIRE(program.getNumEdges() == 3);
+        REQUIRE(boost::num_edges(program.graph) == 3);
+        REQUIRE(program.edit_counts.edges_added == 1);
+      }
+    }
+  }
+}
@@ -188,3 +188,47 @@ SCENARIO("Test double buffering memcpy", "[double-buffering]") {
     }
   }
 }
+SCENARIO("Test address interval map", "[dma]") {
+  GIVEN("A DMA sized range written by one node") {
+    AddressIntervalMap<unsigned> map;
+    map.assign(0x1000, 0x1000 + 4096, 1);
+    WHEN("Part of it is overwritten by a store and another DMA.") {
+      map.assign(0x1004, 0x1008, 2);
+      map.assign(0x1800, 0x3000, 3);
+      THEN("Each address should map to its last writer.") {
+        REQUIRE(*map.find(0x1000) == 1);
+        REQUIRE(*map.find(0x1004) == 2);
+        REQUIRE(*map.find(0x1007) == 2);
+        REQUIRE(*map.find(0x1008) == 1);
+        REQUIRE(*map.find(0x17ff) == 1);
+        REQUIRE(*map.find(0x2fff) == 3);
+        REQUIRE(map.find(0x3000) == nullptr);
+        REQUIRE(map.find(0xfff) == nullptr);
+        REQUIRE(map.num_ranges() == 4);
+      }
+      THEN("Overlapping writers should be visited in address order.") {
+        std::vector<unsigned> writers;
+        map.for_each(0x1002, 0x1900, [&](Addr start, Addr end, unsigned w) {
+          writers.push_back(w);
+        });
+        REQUIRE(writers == std::vector<unsigned>({ 1, 2, 1, 3 }));
+      }
+    }
+    WHEN("Adjacent ranges are given the same writer.") {
+      map.assign(0x1000 + 4096, 0x3000, 1);
+      THEN("They should be merged.") {
+        REQUIRE(map.num_ranges() == 1);
+      }
+    }
+    WHEN("The middle of the range is erased.") {
+      map.erase(0x1100, 0x1200);
+      THEN("Only the erased addresses should be removed.") {
+        REQUIRE(*map.find(0x10ff) == 1);
+        REQUIRE(map.find(0x1100) == nullptr);
+        REQUIRE(map.find(0x11ff) == nullptr);
+        REQUIRE(*map.find(0x1200) == 1);
+        REQUIRE(map.num_ranges() == 2);
+      }
+    }
+  }
+}
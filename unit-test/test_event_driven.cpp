@@ -0,0 +1,58 @@
+#include <vector>
+
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+
+// Schedule the whole graph, and return the start and completion cycles of each
+// node.
+static std::vector<std::pair<int, int>> schedule(ScratchpadDatapath* acc) {
+  acc->buildDddg();
+  acc->globalOptimizationPass();
+  acc->prepareForScheduling();
+  while (!acc->step()) {
+  }
+  std::vector<std::pair<int, int>> cycles;
+  const ExecNodeMap& nodes = acc->getProgram().nodes;
+  for (auto node_it = nodes.begin(); node_it != nodes.end(); ++node_it) {
+    ExecNode* node = node_it->second;
+    cycles.push_back(std::make_pair(node->get_start_execution_cycle(),
+                                    node->get_complete_execution_cycle()));
+  }
+  return cycles;
+}
+
+SCENARIO("Test event-driven scheduling w/ floating point Triad", "[triad]") {
+  GIVEN("Test Triad w/ Input Size 128 on floating point values, cyclic "
+        "partition with a factor of 2, loop unrolling with a factor of 2") {
+    std::string bench("outputs/triad-fp-128");
+    std::string trace_file("inputs/triad-fp-128-trace.gz");
+    std::string config_file("inputs/config-triad-fp");
+    std::string event_config_file("inputs/config-triad-fp-event");
+
+    ScratchpadDatapath* stepped =
+        new ScratchpadDatapath(bench, trace_file, config_file);
+    std::vector<std::pair<int, int>> stepped_cycles = schedule(stepped);
+    unsigned num_cycles = stepped->getCurrentCycle();
+    REQUIRE(stepped->getSkippedIdleCycles() == 0);
+    delete stepped;
+
+    ScratchpadDatapath* acc =
+        new ScratchpadDatapath(bench, trace_file, event_config_file);
+    WHEN("Cycles in which only FP operations are in flight are skipped.") {
+      std::vector<std::pair<int, int>> cycles = schedule(acc);
+      THEN("Some idle cycles are skipped.") {
+        REQUIRE(acc->getSkippedIdleCycles() > 0);
+        REQUIRE(acc->getSkippedIdleCycles() < num_cycles);
+      }
+      THEN("Every node starts and completes in the same cycles as when "
+           "stepping through every cycle.") {
+        REQUIRE(acc->getCurrentCycle() == num_cycles);
+        REQUIRE(cycles == stepped_cycles);
+      }
+    }
+    delete acc;
+  }
+}
@@ -0,0 +1,67 @@
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+
+SCENARIO("Test dense node storage", "[exec_node_map]") {
+  GIVEN("Nodes with nearly contiguous ids") {
+    ExecNodeMap nodes;
+    std::vector<ExecNode*> owned;
+    for (unsigned id : { 12, 13, 15, 10, 16 }) {
+      owned.push_back(new ExecNode(id, LLVM_IR_Add));
+      nodes.insert(id, owned.back());
+    }
+    WHEN("Some nodes are removed.") {
+      REQUIRE(nodes.erase(13) == 1);
+      REQUIRE(nodes.erase(10) == 1);
+      REQUIRE(nodes.erase(11) == 0);
+      THEN("Iteration should skip them, in either direction.") {
+        std::vector<unsigned> ids;
+        for (auto& node_pair : nodes) {
+          REQUIRE(node_pair.second->get_node_id() == node_pair.first);
+          ids.push_back(node_pair.first);
+        }
+        REQUIRE(ids == std::vector<unsigned>({ 12, 15, 16 }));
+        ids.clear();
+        for (auto it = nodes.rbegin(); it != nodes.rend(); ++it)
+          ids.push_back(it->first);
+        REQUIRE(ids == std::vector<unsigned>({ 16, 15, 12 }));
+        REQUIRE(nodes.size() == 3);
+        REQUIRE(nodes.begin()->first == 12);
+        REQUIRE((--nodes.end())->first == 16);
+      }
+      THEN("Lookups should only find the remaining nodes.") {
+        REQUIRE(nodes.find(13) == nodes.end());
+        REQUIRE(nodes.find(15)->second->get_node_id() == 15);
+        REQUIRE(nodes.get(10) == nullptr);
+        REQUIRE(nodes.get(100) == nullptr);
+        REQUIRE(nodes.count(16) == 1);
+        REQUIRE_THROWS_AS(nodes.at(13), std::out_of_range);
+      }
+    }
+    WHEN("Nodes are removed while iterating.") {
+      std::vector<unsigned> ids;
+      for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+        ids.push_back(it->first);
+        if (it->first != 15)
+          nodes.erase(it->first);
+      }
+      THEN("The iteration should still visit every node.") {
+        REQUIRE(ids == std::vector<unsigned>({ 10, 12, 13, 15, 16 }));
+        REQUIRE(nodes.size() == 1);
+        REQUIRE(nodes.begin()->first == 15);
+        REQUIRE((--nodes.end())->first == 15);
+      }
+      THEN("Compacting should keep the remaining node.") {
+        nodes.compact();
+        REQUIRE(nodes.size() == 1);
+        REQUIRE(nodes.begin()->first == 15);
+        REQUIRE(++nodes.begin() == nodes.end());
+        REQUIRE(nodes.at(15)->get_node_id() == 15);
+      }
+    }
+    for (ExecNode* node : owned)
+      delete node;
+  }
+}
@@ -0,0 +1,42 @@
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+
+SCENARIO("Test frozen graph for scheduling", "[frozen_graph]") {
+  GIVEN("Test Triad w/ Input Size 128") {
+    std::string bench("outputs/triad-128");
+    std::string trace_file("inputs/triad-128-trace.gz");
+    std::string config_file("inputs/config-triad-p2-u2-P1");
+
+    ScratchpadDatapath* acc;
+    WHEN("The graph is frozen before scheduling.") {
+      acc = new ScratchpadDatapath(bench, trace_file, config_file);
+      acc->buildDddg();
+      acc->globalOptimizationPass();
+      acc->prepareForScheduling();
+      const Program& prog = acc->getProgram();
+      const FrozenGraph& frozen = prog.frozen_graph;
+      THEN("It should have the same edges in the same order as the graph.") {
+        REQUIRE(frozen.numVertices() == boost::num_vertices(prog.graph));
+        REQUIRE(frozen.numEdges() == boost::num_edges(prog.graph));
+        for (unsigned v = 0; v < frozen.numVertices(); v++) {
+          REQUIRE(frozen.node(v) == prog.nodeAtVertex(v));
+          REQUIRE(frozen.inDegree(v) == boost::in_degree(v, prog.graph));
+          FrozenGraph::EdgeRange children = frozen.outEdges(v);
+          REQUIRE(children.size == boost::out_degree(v, prog.graph));
+          unsigned i = 0;
+          out_edge_iter out_i, out_end;
+          for (boost::tie(out_i, out_end) = out_edges(v, prog.graph);
+               out_i != out_end; ++out_i, ++i) {
+            REQUIRE(children.vertices[i] == target(*out_i, prog.graph));
+            REQUIRE(children.types[i] ==
+                    get(boost::edge_name, prog.graph, *out_i));
+          }
+        }
+      }
+      delete acc;
+    }
+  }
+}
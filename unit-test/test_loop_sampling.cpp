@@ -0,0 +1,68 @@
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+
+SCENARIO("Test loop sampling w/ Triad", "[triad]") {
+  GIVEN("Test Triad w/ Input Size 128, cyclic partition with a factor of 2, "
+        "loop unrolling with a factor of 2, enable loop pipelining, "
+        "sampling 4 out of every 16 iterations after 8 warm-up iterations") {
+    std::string bench("outputs/triad-128");
+    std::string trace_file("inputs/triad-128-trace.gz");
+    std::string config_file("inputs/config-triad-p2-u2-P1");
+    std::string sampling_config_file("inputs/config-triad-sampling");
+
+    // Simulate every iteration.
+    ScratchpadDatapath* full =
+        new ScratchpadDatapath(bench, trace_file, config_file);
+    full->buildDddg();
+    unsigned full_nodes = full->getProgram().getNumNodes();
+    full->globalOptimizationPass();
+    full->prepareForScheduling();
+    while (!full->step()) {
+    }
+    unsigned full_cycles = full->getCurrentCycle();
+    delete full;
+
+    ScratchpadDatapath* acc =
+        new ScratchpadDatapath(bench, trace_file, sampling_config_file);
+    WHEN("Only the sampled iterations are simulated.") {
+      REQUIRE(acc->isSampling());
+      acc->buildDddg();
+      const LoopSampler* sampler = acc->getSampler();
+      THEN("The warm-up iterations are followed by a window out of every "
+           "period.") {
+        REQUIRE(sampler->getIterations() == 128);
+        REQUIRE(sampler->getWindows().size() == 8);
+        REQUIRE(sampler->getSkippedIterations() == 88);
+        // The loop ends halfway through the last period.
+        const std::vector<LoopSampler::Window>& windows =
+            sampler->getWindows();
+        for (unsigned i = 0; i < windows.size(); i++) {
+          REQUIRE(windows[i].iterations == 4);
+          REQUIRE(windows[i].skipped == (i + 1 < windows.size() ? 12 : 4));
+        }
+      }
+      THEN("The skipped iterations are never built into the graph.") {
+        REQUIRE(sampler->getSkippedNodes() > 0);
+        REQUIRE(acc->getProgram().getNumNodes() ==
+                full_nodes - sampler->getSkippedNodes());
+      }
+      acc->globalOptimizationPass();
+      acc->prepareForScheduling();
+      while (!acc->step()) {
+      }
+      unsigned sampled_cycles = acc->getCurrentCycle();
+      acc->dumpStats();
+      THEN("The extrapolated cycles are within the confidence bound of the "
+           "full simulation.") {
+        LoopSampler::Estimate cycles = acc->getEstimatedCycles();
+        REQUIRE(sampled_cycles < full_cycles);
+        REQUIRE(cycles.bound >= 0);
+        REQUIRE(std::abs(cycles.value - full_cycles) <= cycles.bound + 1);
+      }
+    }
+    delete acc;
+  }
+}
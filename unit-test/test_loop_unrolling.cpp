@@ -22,6 +22,13 @@ SCENARIO("Test loopUnrolling w/ Triad", "[triad]") {
     acc->scratchpadPartition();
     WHEN("Test loopUnrolling()") {
       acc->loopUnrolling();
+      THEN("Loop branches should resolve to the unrolling directive.") {
+        const LoopConfig& config = prog.getLoopConfig(prog.nodes.at(24));
+        REQUIRE(config.unrolled);
+        REQUIRE(config.unroll_factor == 2);
+        REQUIRE(!config.pipelined);
+        REQUIRE(&prog.getLoopConfig(prog.nodes.at(12)) == &config);
+      }
       THEN("Unrolled loop boundary should match the expectations.") {
         REQUIRE(prog.loop_bounds.at(1).node_id == 24);
         REQUIRE(prog.loop_bounds.at(2).node_id == 48);
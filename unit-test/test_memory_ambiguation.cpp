@@ -1,6 +1,7 @@
 #include "catch.hpp"
 #include "DDDG.h"
 #include "file_func.h"
+#include "graph_opts/memory_ambiguation.h"
 #include "Scratchpad.h"
 #include "ScratchpadDatapath.h"
 
@@ -81,3 +82,62 @@ SCENARIO("Test memory ambiguation with independent stores", "[mem_amb_indep]") {
     }
   }
 }
+
+// Exposes the sources cache of the memory ambiguation pass.
+class CacheTestOpt : public MemoryAmbiguationOpt {
+ public:
+  using MemoryAmbiguationOpt::MemoryAmbiguationOpt;
+  using MemoryAmbiguationOpt::setMaxCachedSources;
+  using MemoryAmbiguationOpt::cacheSources;
+  using MemoryAmbiguationOpt::clearSourcesCache;
+
+  bool isCached(const ExecNode* node) const {
+    return sources_cache.find(node->get_node_id()) != sources_cache.end();
+  }
+  size_t numCachedNodes() const { return cached_nodes.size(); }
+};
+
+SCENARIO("Test bounding the memory ambiguation sources cache",
+         "[mem_amb_cache]") {
+  GIVEN("A sources cache bounded to four sources") {
+    Program program;
+    SrcTypes::SourceManager src_manager;
+    UserConfigParams user_params;
+    CacheTestOpt opt(program, src_manager, user_params);
+    opt.clearSourcesCache();
+    opt.setMaxCachedSources(4);
+
+    std::vector<std::unique_ptr<ExecNode>> nodes;
+    for (unsigned id = 0; id < 8; id++)
+      nodes.emplace_back(new ExecNode(id, LLVM_IR_Add));
+    MemoryAddrSources empty;
+    MemoryAddrSources two;
+    two.add_inductive(nodes[6].get());
+    two.add_noninductive(nodes[7].get());
+
+    WHEN("More empty entries are cached than the bound") {
+      for (unsigned id = 0; id < 6; id++)
+        opt.cacheSources(nodes[id].get(), empty);
+      THEN("Each counts towards the bound and the oldest are evicted") {
+        REQUIRE(opt.numCachedNodes() == 4);
+        REQUIRE_FALSE(opt.isCached(nodes[0].get()));
+        REQUIRE_FALSE(opt.isCached(nodes[1].get()));
+        for (unsigned id = 2; id < 6; id++)
+          REQUIRE(opt.isCached(nodes[id].get()));
+      }
+    }
+    WHEN("A larger entry is cached into a full cache") {
+      for (unsigned id = 0; id < 4; id++)
+        opt.cacheSources(nodes[id].get(), empty);
+      opt.cacheSources(nodes[4].get(), two);
+      THEN("Only as many of the oldest entries as needed are evicted") {
+        REQUIRE(opt.numCachedNodes() == 3);
+        REQUIRE_FALSE(opt.isCached(nodes[0].get()));
+        REQUIRE_FALSE(opt.isCached(nodes[1].get()));
+        REQUIRE(opt.isCached(nodes[2].get()));
+        REQUIRE(opt.isCached(nodes[3].get()));
+        REQUIRE(opt.isCached(nodes[4].get()));
+      }
+    }
+  }
+}
@@ -0,0 +1,80 @@
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+
+static std::string readFile(const std::string& file_name) {
+  std::ifstream file(file_name.c_str());
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+// The microop of every node and every edge of the graph, as text.
+static std::string describeGraph(const Program& program) {
+  std::stringstream desc;
+  for (auto& node_pair : program.nodes)
+    desc << node_pair.first << ":" << (int)node_pair.second->get_microop()
+         << "\n";
+  edge_iter edge_it, edge_end;
+  std::vector<std::string> edges;
+  for (boost::tie(edge_it, edge_end) = boost::edges(program.graph);
+       edge_it != edge_end; ++edge_it) {
+    std::stringstream edge;
+    edge << program.atVertex(source(*edge_it, program.graph)) << "->"
+         << program.atVertex(target(*edge_it, program.graph)) << ":"
+         << (int)get(boost::edge_name, program.graph, *edge_it);
+    edges.push_back(edge.str());
+  }
+  std::sort(edges.begin(), edges.end());
+  for (auto& edge : edges)
+    desc << edge << "\n";
+  return desc.str();
+}
+
+SCENARIO("Test parallel analysis of loop regions", "[parallel_opts]") {
+  GIVEN("Benchmarks with several loop regions") {
+    std::vector<std::pair<std::string, std::string>> benchmarks = {
+      { "triad-128", "config-triad-p2-u2-P1" },
+      { "reduction-128", "config-reduction-p4-u4-P1" },
+      { "pp_scan-128", "config-pp_scan-p4-u4-P1" },
+      { "aes", "config-aes-aes" },
+    };
+    mkdir("outputs", 0755);
+    for (auto& benchmark : benchmarks) {
+      std::string bench("outputs/" + benchmark.first);
+      std::string trace_file(
+          "inputs/" +
+          (benchmark.first == "aes" ? "aes-aes" : benchmark.first) +
+          "-trace.gz");
+      std::string config_file("inputs/" + benchmark.second);
+      std::string threaded_config_file("outputs/" + benchmark.second +
+                                       "-threads");
+      std::ofstream threaded_config(threaded_config_file.c_str());
+      threaded_config << readFile(config_file) << "graph_opt_threads,4\n";
+      threaded_config.close();
+
+      WHEN("The graph of " + benchmark.first +
+           " is optimized serially and on four threads.") {
+        std::string graphs[2];
+        std::string configs[2] = { config_file, threaded_config_file };
+        for (int i = 0; i < 2; i++) {
+          ScratchpadDatapath* acc =
+              new ScratchpadDatapath(bench, trace_file, configs[i]);
+          acc->buildDddg();
+          acc->globalOptimizationPass();
+          graphs[i] = describeGraph(acc->getProgram());
+          delete acc;
+        }
+        THEN("The optimized graphs should be identical.") {
+          REQUIRE(graphs[0] == graphs[1]);
+        }
+      }
+    }
+  }
+}
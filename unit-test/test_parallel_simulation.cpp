@@ -0,0 +1,102 @@
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "ParallelSimulator.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+#include "TraceIndex.h"
+
+// Read the uncompressed contents of @trace_file.
+static std::string readTrace(const std::string& trace_file) {
+  std::string contents;
+  gzFile trace = gzopen(trace_file.c_str(), "r");
+  char buf[4096];
+  int bytes;
+  while ((bytes = gzread(trace, buf, sizeof(buf))) > 0)
+    contents.append(buf, bytes);
+  gzclose(trace);
+  return contents;
+}
+
+static std::string readFile(const std::string& file_name) {
+  std::ifstream file(file_name.c_str());
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+SCENARIO("Test parallel simulation of invocations", "[parallel]") {
+  GIVEN("A trace with four invocations of Triad") {
+    std::string trace_file("outputs/triad-128-x4-trace.gz");
+    std::string config_file("inputs/config-triad-p2-u2-P1");
+    std::string parallel_config_file("outputs/config-triad-parallel");
+
+    std::string invocation = readTrace("inputs/triad-128-trace.gz");
+    if (invocation.back() != '\n')
+      invocation += '\n';
+    invocation += '\n';
+    mkdir("outputs", 0755);
+    remove(TraceIndex::indexFileName(trace_file).c_str());
+    gzFile out = gzopen(trace_file.c_str(), "w");
+    for (int i = 0; i < 4; i++)
+      gzwrite(out, invocation.data(), invocation.size());
+    gzclose(out);
+    std::ofstream parallel_config(parallel_config_file.c_str());
+    parallel_config << readFile(config_file) << "parallel_invocations,3\n";
+    parallel_config.close();
+
+    WHEN("The invocations are simulated serially and in parallel.") {
+      std::string serial_bench("outputs/triad-x4");
+      ScratchpadDatapath* acc =
+          new ScratchpadDatapath(serial_bench, trace_file, config_file);
+      while (acc->buildDddg()) {
+        acc->globalOptimizationPass();
+        acc->prepareForScheduling();
+        while (!acc->step()) {
+        }
+        acc->dumpStats();
+        acc->clearDatapath();
+        // The parallel workers only count the memory accesses of each
+        // invocation.
+        acc->getScratchpad()->resetStats();
+      }
+      delete acc;
+
+      std::string parallel_bench("outputs/triad-x4-parallel");
+      acc = new ScratchpadDatapath(
+          parallel_bench, trace_file, parallel_config_file);
+      REQUIRE(acc->getParallelInvocations() == 3);
+      ParallelSimulator simulator(
+          acc, parallel_bench, trace_file, parallel_config_file);
+      simulator.run();
+
+      THEN("The summaries should match and be in the same order.") {
+        std::string serial = readFile(serial_bench + "_summary");
+        std::string parallel = readFile(parallel_bench + "_summary");
+        size_t pos;
+        while ((pos = parallel.find(parallel_bench)) != std::string::npos)
+          parallel.replace(pos, parallel_bench.size(), serial_bench);
+        unsigned num_summaries = 0;
+        for (pos = serial.find("Running"); pos != std::string::npos;
+             pos = serial.find("Running", pos + 1))
+          num_summaries++;
+        REQUIRE(num_summaries == 4);
+        REQUIRE(parallel == serial);
+        REQUIRE(readFile(parallel_bench + "_stats") ==
+                readFile(serial_bench + "_stats"));
+      }
+      THEN("Each invocation reports its progress to a file of its own.") {
+        for (int i = 0; i < 4; i++) {
+          std::string progress_file =
+              "dddg_parse_progress." + std::to_string(i) + ".out";
+          REQUIRE(fileExists(progress_file));
+          remove(progress_file.c_str());
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,41 @@
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+
+SCENARIO("Test graph optimization pass profile", "[pass_manager]") {
+  GIVEN("Test Triad w/ Input Size 128") {
+    std::string bench("outputs/triad-128");
+    std::string trace_file("inputs/triad-128-trace.gz");
+    std::string config_file("inputs/config-triad-p2-u2-P1");
+
+    ScratchpadDatapath* acc;
+    WHEN("The graph optimizations are run.") {
+      acc = new ScratchpadDatapath(bench, trace_file, config_file);
+      acc->buildDddg();
+      unsigned initial_edges = acc->getProgram().getNumEdges();
+      acc->globalOptimizationPass();
+      THEN("Passes without their configuration should be skipped.") {
+        for (auto& pass : acc->getPassProfile()) {
+          bool expect_skipped = pass.name == "per_loop_pipelining";
+          REQUIRE(pass.skipped == expect_skipped);
+        }
+      }
+      THEN("The recorded edits should account for all edge changes.") {
+        GraphEditCounts total;
+        for (auto& pass : acc->getPassProfile()) {
+          total.nodes_removed += pass.edits.nodes_removed;
+          total.edges_added += pass.edits.edges_added;
+          total.edges_removed += pass.edits.edges_removed;
+        }
+        REQUIRE(total.edges_added > 0);
+        REQUIRE(total.nodes_removed > 0);
+        uint64_t final_edges =
+            initial_edges + total.edges_added - total.edges_removed;
+        REQUIRE(final_edges == acc->getProgram().getNumEdges());
+      }
+      delete acc;
+    }
+  }
+}
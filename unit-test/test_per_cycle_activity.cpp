@@ -0,0 +1,45 @@
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+
+SCENARIO("Test per cycle activity", "[activity]") {
+  GIVEN("Test Triad w/ Input Size 128") {
+    std::string bench("outputs/triad-128");
+    std::string trace_file("inputs/triad-128-trace.gz");
+    std::string config_file("inputs/config-triad-p2-u2-P1");
+
+    ScratchpadDatapath* acc;
+    WHEN("The graph is scheduled and rescheduled as late as possible.") {
+      acc = new ScratchpadDatapath(bench, trace_file, config_file);
+      acc->buildDddg();
+      acc->globalOptimizationPass();
+      acc->prepareForScheduling();
+      while (!acc->step()) {
+      }
+      acc->rescheduleNodesWhenNeeded();
+      THEN("Every adder and multiplier is counted in the cycle it starts "
+           "in.") {
+        unsigned num_cycles = acc->getCurrentCycle();
+        std::vector<unsigned> adds(num_cycles, 0), muls(num_cycles, 0);
+        const ExecNodeMap& nodes = acc->getProgram().nodes;
+        for (auto node_it = nodes.begin(); node_it != nodes.end(); ++node_it) {
+          ExecNode* node = node_it->second;
+          if (node->is_isolated())
+            continue;
+          if (node->is_int_add_op())
+            adds.at(node->get_start_execution_cycle())++;
+          else if (node->is_int_mul_op())
+            muls.at(node->get_start_execution_cycle())++;
+        }
+        for (unsigned cycle = 0; cycle < num_cycles; cycle++) {
+          funcActivity activity = acc->getCycleActivity(cycle);
+          REQUIRE(activity.add == adds[cycle]);
+          REQUIRE(activity.mul == muls[cycle]);
+        }
+      }
+      delete acc;
+    }
+  }
+}
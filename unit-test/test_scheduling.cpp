@@ -0,0 +1,32 @@
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+
+SCENARIO("Test executing queue scans", "[executing_queue]") {
+  GIVEN("Test Triad w/ Input Size 128") {
+    std::string bench("outputs/triad-128");
+    std::string trace_file("inputs/triad-128-trace.gz");
+    std::string config_file("inputs/config-triad-p2-u2-P1");
+
+    ScratchpadDatapath* acc;
+    WHEN("The graph is scheduled.") {
+      acc = new ScratchpadDatapath(bench, trace_file, config_file);
+      acc->buildDddg();
+      acc->globalOptimizationPass();
+      acc->prepareForScheduling();
+      while (!acc->step()) {
+      }
+      THEN("Every cycle scans the queue, and every node is visited.") {
+        REQUIRE(acc->getCurrentCycle() == 70);
+        REQUIRE(acc->getScannedCycles() == acc->getCurrentCycle());
+        REQUIRE(acc->getScannedNodes() >= acc->getTotalConnectedNodes());
+        REQUIRE(acc->getPeakExecutingQueue() > 0);
+        REQUIRE(acc->getPeakExecutingQueue() <=
+                acc->getTotalConnectedNodes());
+      }
+      delete acc;
+    }
+  }
+}
@@ -47,6 +47,18 @@ SCENARIO("Test scratchpadPartition w/ Triad", "[triad]") {
         REQUIRE(prog.nodes.at(1493)->get_partition_index() == 0);
         REQUIRE(prog.nodes.at(1497)->get_partition_index() == 0);
       }
+      THEN("Memory operations are routed to their partitions when they are "
+           "scheduled.") {
+        acc->prepareForScheduling();
+        spad = acc->getScratchpad();
+        ExecNode* node = prog.nodes.at(15);
+        REQUIRE(node->get_mem_register() == nullptr);
+        REQUIRE(node->get_mem_partition() ==
+                spad->getLogicalArray("a")->getPartition(1));
+        node = prog.nodes.at(1497);
+        REQUIRE(node->get_mem_partition() ==
+                spad->getLogicalArray("c")->getPartition(0));
+      }
     }
   }
 }
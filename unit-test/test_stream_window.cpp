@@ -0,0 +1,52 @@
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+
+SCENARIO("Test streaming scheduling w/ Triad", "[triad]") {
+  GIVEN("Test Triad w/ Input Size 128, cyclic partition with a factor of 2, "
+        "scheduled through a window of 128 nodes") {
+    std::string bench("outputs/triad-128");
+    std::string trace_file("inputs/triad-128-trace.gz");
+    std::string config_file("inputs/config-triad-stream");
+
+    // Schedule the whole graph without optimizing it.
+    ScratchpadDatapath* batch =
+        new ScratchpadDatapath(bench, trace_file, config_file);
+    batch->buildDddg();
+    unsigned num_nodes = batch->getProgram().getNumNodes();
+    batch->initBaseAddress();
+    batch->completePartition();
+    batch->scratchpadPartition();
+    batch->prepareForScheduling();
+    while (!batch->step()) {
+    }
+    unsigned batch_cycles = batch->getCurrentCycle();
+    delete batch;
+
+    ScratchpadDatapath* acc =
+        new ScratchpadDatapath(bench, trace_file, config_file);
+    WHEN("The trace is scheduled while it is parsed.") {
+      REQUIRE(acc->isStreaming());
+      REQUIRE(acc->streamDddg());
+      THEN("The schedule is the same as for the whole graph.") {
+        REQUIRE(acc->getLateNodes() == 0);
+        REQUIRE(acc->getCurrentCycle() == batch_cycles);
+      }
+      THEN("Only the edge from the first branch to the final return is "
+           "dropped, since that branch left the window long before.") {
+        REQUIRE(acc->getWindowMisses() == 1);
+      }
+      THEN("Only a window of nodes is kept in memory.") {
+        REQUIRE(acc->getPeakLiveNodes() < num_nodes / 4);
+        REQUIRE(acc->getProgram().nodes.size() < num_nodes / 4);
+      }
+      THEN("There is only one invocation.") {
+        acc->clearDatapath();
+        REQUIRE(acc->streamDddg() == false);
+      }
+    }
+    delete acc;
+  }
+}
@@ -0,0 +1,156 @@
+/* Microbenchmark for parsing text trace lines.
+ *
+ * Compares the sscanf based line parsing that DDDG used to do against
+ * TraceLineTokenizer. The trace is decompressed into memory up front, so only
+ * the cost of splitting lines into fields and parsing them is measured.
+ *
+ * Usage:
+ *   ./test_tokenizer_performance [trace] [repetitions]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <zlib.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TraceTokenizer.h"
+
+// Fold parsed values into a checksum so that the parsing isn't optimized out.
+static unsigned long checksum;
+
+static void consume(long value, const char* str) {
+  checksum += value + str[0];
+}
+
+static void parse_with_sscanf(const std::vector<std::string>& lines) {
+  char func[256], bblockid[256], instid[256];
+  char value[256], label[256], prev_bbid[256];
+  int line_num, microop, size, is_reg;
+  long node_id;
+  for (const std::string& l : lines) {
+    std::string wholeline(l);
+    size_t pos_end_tag = wholeline.find(",");
+    if (pos_end_tag == std::string::npos)
+      continue;
+    std::string tag = wholeline.substr(0, pos_end_tag);
+    std::string line_left = wholeline.substr(pos_end_tag + 1);
+    if (tag.compare("0") == 0) {
+      sscanf(line_left.c_str(),
+             "%d,%[^,],%[^,],%[^,],%d,%lu\n",
+             &line_num,
+             func,
+             bblockid,
+             instid,
+             &microop,
+             &node_id);
+      consume(line_num + microop + node_id, func);
+    } else if (tag.compare("f") == 0) {
+      sscanf(line_left.c_str(), "%d,%*[^,],%d,%[^,],\n", &size, &is_reg, label);
+      consume(size + is_reg, label);
+    } else if (tag.compare("entry") == 0) {
+      sscanf(line_left.c_str(), "%[^,],%d\n", func, &size);
+      consume(size, func);
+    } else {
+      sscanf(line_left.c_str(),
+             "%d,%[^,],%d,%[^,],%[^,],\n",
+             &size,
+             value,
+             &is_reg,
+             label,
+             prev_bbid);
+      consume(size + is_reg + strtol(value, NULL, 10), label);
+    }
+  }
+}
+
+static void parse_with_tokenizer(std::vector<char>& buffer,
+                                 const std::vector<std::string>& lines) {
+  for (const std::string& l : lines) {
+    // Copy the line into a reusable buffer, as the tokenizer modifies it.
+    // This stands in for the decompression buffer of TraceLineReader.
+    buffer.assign(l.c_str(), l.c_str() + l.size() + 1);
+    char* raw = buffer.data();
+    if (memchr(raw, ',', l.size()) == NULL)
+      continue;
+    TraceLineTokenizer line(raw, l.size());
+    const char* tag = line.next_field();
+    if (strcmp(tag, "0") == 0) {
+      int line_num = line.next_int();
+      char* func = line.next_field();
+      line.skip_field();
+      line.skip_field();
+      int microop = line.next_int();
+      long node_id = line.next_int();
+      consume(line_num + microop + node_id, func);
+    } else if (strcmp(tag, "f") == 0) {
+      int size = line.next_int();
+      line.skip_field();
+      int is_reg = line.next_int();
+      consume(size + is_reg, line.next_field());
+    } else if (strcmp(tag, "entry") == 0) {
+      char* func = line.next_field();
+      consume(line.next_int(), func);
+    } else {
+      int size = line.next_int();
+      char* value = line.next_field();
+      int is_reg = line.next_int();
+      char* label = line.next_field();
+      line.skip_field();
+      consume(size + is_reg + TraceLineTokenizer::parse_int(value), label);
+    }
+  }
+}
+
+static double elapsed(const struct timeval& start, const struct timeval& end) {
+  return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+  std::string trace_name = argc > 1 ? argv[1] : "inputs/aes-aes-trace.gz";
+  int reps = argc > 2 ? atoi(argv[2]) : 20;
+
+  gzFile trace = gzopen(trace_name.c_str(), "r");
+  if (!trace) {
+    std::cerr << "Cannot open " << trace_name << std::endl;
+    return 1;
+  }
+  std::vector<std::string> lines;
+  char buf[4096];
+  while (gzgets(trace, buf, sizeof(buf)) != NULL) {
+    size_t len = strlen(buf);
+    if (len > 0 && buf[len - 1] == '\n')
+      buf[--len] = '\0';
+    lines.push_back(std::string(buf, len));
+  }
+  gzclose(trace);
+
+  struct timeval start, end;
+  double total_lines = (double)lines.size() * reps;
+
+  gettimeofday(&start, NULL);
+  for (int i = 0; i < reps; i++)
+    parse_with_sscanf(lines);
+  gettimeofday(&end, NULL);
+  double sscanf_secs = elapsed(start, end);
+
+  std::vector<char> buffer;
+  gettimeofday(&start, NULL);
+  for (int i = 0; i < reps; i++)
+    parse_with_tokenizer(buffer, lines);
+  gettimeofday(&end, NULL);
+  double tokenizer_secs = elapsed(start, end);
+
+  std::cout << trace_name << ": " << lines.size() << " lines x " << reps
+            << std::endl;
+  std::cout << "sscanf :\t" << total_lines / sscanf_secs << " lines/sec."
+            << std::endl;
+  std::cout << "tokenizer :\t" << total_lines / tokenizer_secs
+            << " lines/sec." << std::endl;
+  std::cout << "speedup :\t" << sscanf_secs / tokenizer_secs << "x"
+            << " (checksum " << checksum << ")" << std::endl;
+  return 0;
+}
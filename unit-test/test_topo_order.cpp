@@ -0,0 +1,91 @@
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+
+SCENARIO("Test cached topological order", "[topo_order]") {
+  GIVEN("A graph whose vertices are added in order") {
+    Graph graph;
+    TopologicalOrder topo_order;
+    for (unsigned v = 0; v < 4; v++)
+      topo_order.addVertex(add_vertex(graph));
+    WHEN("Only forward edges are added") {
+      add_edge(0, 2, graph);
+      topo_order.addEdge(0, 2);
+      add_edge(1, 3, graph);
+      topo_order.addEdge(1, 3);
+      THEN("The insertion order is kept without sorting.") {
+        const std::vector<Vertex>& order = topo_order.get(graph);
+        REQUIRE(order == std::vector<Vertex>({ 0, 1, 2, 3 }));
+        REQUIRE(topo_order.getNumSorts() == 0);
+      }
+    }
+    WHEN("A backward edge is added") {
+      add_edge(3, 0, graph);
+      topo_order.addEdge(3, 0);
+      add_edge(2, 1, graph);
+      topo_order.addEdge(2, 1);
+      THEN("The order is sorted once and respects every edge.") {
+        std::vector<Vertex> order = topo_order.get(graph);
+        REQUIRE(topo_order.getNumSorts() == 1);
+        std::vector<unsigned> position(order.size());
+        for (unsigned i = 0; i < order.size(); i++)
+          position[order[i]] = i;
+        REQUIRE(position[3] < position[0]);
+        REQUIRE(position[2] < position[1]);
+        REQUIRE(topo_order.get(graph) == order);
+        REQUIRE(topo_order.getNumSorts() == 1);
+      }
+      THEN("The frozen graph is sorted the same way.") {
+        std::vector<ExecNode> exec_nodes;
+        ExecNodeMap nodes;
+        for (unsigned v = 0; v < 4; v++)
+          exec_nodes.push_back(ExecNode(v, LLVM_IR_Add));
+        for (unsigned v = 0; v < 4; v++) {
+          put(boost::vertex_node_id, graph, v, v);
+          nodes.insert(v, &exec_nodes[v]);
+        }
+        FrozenGraph frozen;
+        frozen.build(graph, nodes);
+        std::vector<Vertex> order = topo_order.get(frozen);
+        REQUIRE(topo_order.getNumSorts() == 1);
+        REQUIRE(order.size() == 4);
+        std::vector<unsigned> position(order.size());
+        for (unsigned i = 0; i < order.size(); i++)
+          position[order[i]] = i;
+        REQUIRE(position[3] < position[0]);
+        REQUIRE(position[2] < position[1]);
+      }
+    }
+  }
+  GIVEN("Test Triad w/ Input Size 128") {
+    std::string bench("outputs/triad-128");
+    std::string trace_file("inputs/triad-128-trace.gz");
+    std::string config_file("inputs/config-triad-p2-u2-P1");
+
+    ScratchpadDatapath* acc;
+    WHEN("The graph optimizations are run.") {
+      acc = new ScratchpadDatapath(bench, trace_file, config_file);
+      acc->buildDddg();
+      acc->globalOptimizationPass();
+      const Program& prog = acc->getProgram();
+      THEN("Every vertex should come before its children in the cached "
+           "order.") {
+        TopologicalOrder topo_order = prog.topo_order;
+        const std::vector<Vertex>& order = topo_order.get(prog.graph);
+        REQUIRE(order.size() == boost::num_vertices(prog.graph));
+        std::vector<unsigned> position(order.size());
+        for (unsigned i = 0; i < order.size(); i++)
+          position[order[i]] = i;
+        edge_iter edge_i, edge_end;
+        for (boost::tie(edge_i, edge_end) = edges(prog.graph);
+             edge_i != edge_end; ++edge_i) {
+          REQUIRE(position[source(*edge_i, prog.graph)] <
+                  position[target(*edge_i, prog.graph)]);
+        }
+      }
+      delete acc;
+    }
+  }
+}
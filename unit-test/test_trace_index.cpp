@@ -0,0 +1,113 @@
+#include <sys/stat.h>
+
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+#include "TraceIndex.h"
+#include "TraceReader.h"
+
+// Read the uncompressed contents of @trace_file.
+static std::string readTrace(const std::string& trace_file) {
+  std::string contents;
+  gzFile trace = gzopen(trace_file.c_str(), "r");
+  char buf[4096];
+  int bytes;
+  while ((bytes = gzread(trace, buf, sizeof(buf))) > 0)
+    contents.append(buf, bytes);
+  gzclose(trace);
+  return contents;
+}
+
+SCENARIO("Test trace invocation index", "[trace_index]") {
+  GIVEN("A trace with three invocations of Triad, as separate gzip members") {
+    std::string bench("outputs/triad-128-x3");
+    std::string trace_file("outputs/triad-128-x3-trace.gz");
+    std::string config_file("inputs/config-triad-p2-u2-P1");
+
+    std::string invocation = readTrace("inputs/triad-128-trace.gz");
+    // Each invocation ends at the first line without a comma after the
+    // function returns.
+    if (invocation.back() != '\n')
+      invocation += '\n';
+    invocation += '\n';
+    std::string labelmap("%%%% LABEL MAP START %%%%\n"
+                         "triad/unused_label 999\n"
+                         "%%%% LABEL MAP END %%%%\n\n");
+
+    mkdir("outputs", 0755);
+    remove(TraceIndex::indexFileName(trace_file).c_str());
+    for (int i = 0; i < 3; i++) {
+      gzFile out = gzopen(trace_file.c_str(), i == 0 ? "w" : "a");
+      if (i == 0)
+        gzwrite(out, labelmap.data(), labelmap.size());
+      // Flush regularly so that each member has many deflate blocks.
+      for (size_t pos = 0; pos < invocation.size(); pos += 8192) {
+        gzwrite(out, invocation.data() + pos,
+                std::min<size_t>(8192, invocation.size() - pos));
+        gzflush(out, Z_SYNC_FLUSH);
+      }
+      gzclose(out);
+    }
+    std::string expected = labelmap + invocation + invocation + invocation;
+
+    WHEN("The trace is indexed with small access point spans.") {
+      TraceIndex index;
+      REQUIRE(index.build(trace_file, 4096));
+      THEN("Every invocation should be found.") {
+        REQUIRE(index.isGzipped());
+        REQUIRE(index.getUncompressedSize() == expected.size());
+        REQUIRE(index.getNumAccessPoints() > 6);
+        REQUIRE(index.getNumInvocations() == 3);
+        REQUIRE(index.getLabelmapStart() == 0);
+        REQUIRE(index.getLabelmapEnd() == labelmap.size() - 1);
+        // The first invocation includes the labelmap.
+        REQUIRE(index.getInvocation(0).offset == 0);
+        for (unsigned i = 1; i < 3; i++) {
+          REQUIRE(index.getInvocation(i).offset ==
+                  labelmap.size() + i * invocation.size());
+        }
+        REQUIRE(index.getInvocationEnd(2) == TraceIndex::kEndOfTrace);
+      }
+      THEN("Any range of the trace should be readable.") {
+        std::vector<std::pair<uint64_t, uint64_t>> ranges = {
+          { index.getInvocation(2).offset, index.getInvocation(2).offset + 100 },
+          { 0, 50 },
+          { index.getInvocation(1).offset + 5000,
+            index.getInvocation(2).offset + 7000 },
+          { expected.size() - 10, TraceIndex::kEndOfTrace },
+        };
+        IndexedTraceStream stream(index, trace_file);
+        char buf[4096];
+        int bytes;
+        REQUIRE(stream.isOpen());
+        std::string expected_data;
+        for (auto& range : ranges) {
+          stream.addRange(range.first, range.second);
+          expected_data += expected.substr(range.first,
+                                           range.second - range.first);
+        }
+        std::string data;
+        while ((bytes = stream.read(buf, 1000)) > 0)
+          data.append(buf, bytes);
+        REQUIRE(bytes == 0);
+        REQUIRE(data == expected_data);
+      }
+    }
+    WHEN("Only the last invocation is simulated.") {
+      ScratchpadDatapath* acc =
+          new ScratchpadDatapath(bench, trace_file, config_file);
+      REQUIRE(acc->selectInvocations(2, 2));
+      REQUIRE(acc->buildDddg());
+      THEN("Its graph and the labelmap should be built.") {
+        REQUIRE(acc->getProgram().getNumNodes() == 1538);
+        REQUIRE(acc->getProgram().getNumEdges() == 3328);
+        REQUIRE(acc->getProgram().labelmap.size() == 1);
+      }
+      acc->clearDatapath();
+      REQUIRE(!acc->buildDddg());
+      delete acc;
+    }
+  }
+}
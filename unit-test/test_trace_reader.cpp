@@ -0,0 +1,69 @@
+#include <string.h>
+
+#include "catch.hpp"
+#include "DDDG.h"
+#include "file_func.h"
+#include "Scratchpad.h"
+#include "ScratchpadDatapath.h"
+#include "TraceReader.h"
+
+SCENARIO("Test pipelined trace line reader", "[trace_reader]") {
+  GIVEN("The text trace of Triad w/ Input Size 128") {
+    std::string trace_file_name("inputs/triad-128-trace.gz");
+    WHEN("The trace is read with buffers smaller than some lines.") {
+      gzFile expected_file = gzopen(trace_file_name.c_str(), "r");
+      gzFile trace_file = gzopen(trace_file_name.c_str(), "r");
+      TraceLineReader* reader = new TraceLineReader(trace_file, 16, 2);
+      THEN("Every line should match the one read by gzgets.") {
+        char expected[4096];
+        char* line;
+        size_t len;
+        unsigned long num_lines = 0;
+        while (gzgets(expected_file, expected, sizeof(expected)) != NULL) {
+          expected[strcspn(expected, "\n")] = '\0';
+          line = reader->getline(&len);
+          REQUIRE(line != NULL);
+          REQUIRE(len == strlen(expected));
+          REQUIRE(std::string(line) == std::string(expected));
+          num_lines++;
+        }
+        REQUIRE(reader->getline(&len) == NULL);
+        REQUIRE(num_lines > 0);
+      }
+      delete reader;
+      gzclose(trace_file);
+      gzclose(expected_file);
+    }
+  }
+}
+SCENARIO("Test trace line tokenizer", "[trace_reader]") {
+  GIVEN("A parameter line of a PHI node") {
+    char buffer[] = "2,64,-42,1,phi.val,for.body,";
+    TraceLineTokenizer line(buffer, strlen(buffer));
+    WHEN("The line is tokenized.") {
+      THEN("The fields should be split in place and parsed.") {
+        REQUIRE(line.next_int() == 2);
+        REQUIRE(line.next_int() == 64);
+        REQUIRE(line.next_int() == -42);
+        REQUIRE(line.next_int() == 1);
+        size_t len;
+        REQUIRE(std::string(line.next_field(&len)) == "phi.val");
+        REQUIRE(len == 7);
+        REQUIRE(std::string(line.next_field()) == "for.body");
+        REQUIRE(std::string(line.next_field()) == "");
+        REQUIRE(line.at_end());
+        // Missing fields are empty.
+        REQUIRE(std::string(line.next_field()) == "");
+        REQUIRE(line.next_int() == 0);
+      }
+    }
+  }
+  GIVEN("Hexadecimal values") {
+    THEN("They should be parsed with or without a prefix.") {
+      REQUIRE(TraceLineTokenizer::parse_hex("0x7ffc1a2b3c4d") ==
+              0x7ffc1a2b3c4dULL);
+      REQUIRE(TraceLineTokenizer::parse_hex("ffffffffffffffff") ==
+              0xffffffffffffffffULL);
+    }
+  }
+}